@@ -52,7 +52,11 @@
         int numDirLights;
     };
 
-    uniform samplerCube irradianceMap;
+    // L2 spherical harmonics of the environment's irradiance / PI, see SphericalHarmonics.h
+    layout (std140, binding=2) uniform IrradianceSH {
+        vec4 irradianceSH[9];
+    };
+
     uniform samplerCube prefilterMap;
     uniform sampler2D brdfLUT;  
 
@@ -123,6 +127,15 @@
         return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
     }  
 
+    vec3 EvaluateIrradianceSH(vec3 n)
+    {
+        vec3 irradiance = irradianceSH[0].rgb
+            + irradianceSH[1].rgb * n.y + irradianceSH[2].rgb * n.z + irradianceSH[3].rgb * n.x
+            + irradianceSH[4].rgb * (n.x * n.y) + irradianceSH[5].rgb * (n.y * n.z) + irradianceSH[6].rgb * (3.0 * n.z * n.z - 1.0)
+            + irradianceSH[7].rgb * (n.x * n.z) + irradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+        return max(irradiance, 0.0);
+    }
+
 #endif // HAS_NORMALS || FLAT_SHADING
 
 in VS_OUT {
@@ -157,8 +170,10 @@ void main()
 #ifdef HAS_NORMALS
     #ifdef HAS_TANGENTS
         mat3 normalizedTBN = mat3(normalize(fsIn.TBN[0]), normalize(fsIn.TBN[1]), normalize(fsIn.TBN[2]));
-        vec3 unitNormal = texture(material.normalTexture, fsIn.texCoords).rgb;
-        unitNormal = unitNormal * 2.0 - 1.0;
+        // Normal maps are stored as two channels (BC5), so z is reconstructed
+        vec3 unitNormal;
+        unitNormal.xy = texture(material.normalTexture, fsIn.texCoords).rg * 2.0 - 1.0;
+        unitNormal.z = sqrt(max(1.0 - dot(unitNormal.xy, unitNormal.xy), 0.0));
         unitNormal *= vec3(material.normalScale, material.normalScale, 1.0);
         unitNormal = normalize(normalizedTBN * unitNormal);
     #else
@@ -283,13 +298,13 @@ void main()
         finalColor += color;
     }
 
-    // ambient lighting using irradiance map
+    // ambient lighting using irradiance SH
     vec3 F = FresnelSchlickRoughness(max(dot(unitNormal, surfaceToCamera), 0.0), F0, roughness);
     vec3 kS = F;
     vec3 kD = 1.0 - kS;
     kD *= 1.0 - metallic;
     vec3 normalWS = vec3(viewToWorld * vec4(unitNormal, 0.0));
-    vec3 irradiance = texture(irradianceMap, normalWS).rgb;
+    vec3 irradiance = EvaluateIrradianceSH(normalize(normalWS));
     vec3 diffuse = irradiance * baseColor.rgb;
 
     vec3 R = reflect(-surfaceToCamera, unitNormal);   
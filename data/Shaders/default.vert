@@ -5,7 +5,11 @@ layout(location = 1) in vec2 aTexcoords;
 #endif // HAS_TEXCOORD
 
 #ifdef HAS_NORMALS
-layout(location = 2) in vec3 aBaseNormal;
+    #ifdef COMPACT_VERTICES
+        layout(location = 2) in vec2 aBaseNormalOct; // octahedral
+    #else
+        layout(location = 2) in vec3 aBaseNormal;
+    #endif // COMPACT_VERTICES
 #endif // HAS_NORMALS
 
 #ifdef HAS_JOINTS
@@ -13,25 +17,16 @@ layout(location = 3) in vec4 aWeights;
 layout(location = 4) in uint aJoints;
 #endif // HAS_JOINTS
 
-#ifdef HAS_MORPH_TARGETS
-layout(location = 5) in vec3 aMorphBasePosDifference1;
-layout(location = 6) in vec3 aMorphBasePosDifference2;
-    #ifdef HAS_NORMALS
-        layout(location = 7) in vec3 aMorphBaseNormalDifference1;
-        layout(location = 8) in vec3 aMorphBaseNormalDifference2;
-    #endif // HAS_NORMALS
-    #ifdef HAS_TANGENTS
-        layout(location = 10) in vec3 aMorphBaseTangentDifference1;
-        layout(location = 11) in vec3 aMorphBaseTangentDifference2;
-    #endif // HAS_TANGENTS
-#endif // HAS_MORPH_TARGETS
-
 #ifdef HAS_TANGENTS
-layout(location = 9) in vec4 aBaseTangent;
+    #ifdef COMPACT_VERTICES
+        layout(location = 6) in ivec2 aBaseTangentOct; // octahedral 16 bit snorm, bitangent sign in the lowest bit of y
+    #else
+        layout(location = 6) in vec4 aBaseTangent;
+    #endif // COMPACT_VERTICES
 #endif // HAS_TANGENTS
 
 #ifdef HAS_VERTEX_COLORS
-    layout(location=12) in vec4 aVertexColor;
+    layout(location = 7) in vec4 aVertexColor;
 #endif // HAS_VERTEX_COLORS
 
 uniform mat4 world;
@@ -46,11 +41,6 @@ uniform mat3 normalMatrixVS;
 uniform mat4 skinningMatrices[128];
 #endif // HAS_JOINTS
 
-#ifdef HAS_MORPH_TARGETS
-uniform float morph1Weight; 
-uniform float morph2Weight;
-#endif // HAS_MORPH_TARGETS
-
 #if defined(HAS_NORMALS) || defined(FLAT_SHADING)
 uniform mat4 worldToShadowMapUVSpace[MAX_NUM_SPOT_LIGHTS + MAX_NUM_DIR_LIGHTS];
 #endif
@@ -81,12 +71,28 @@ out VS_OUT {
 
 } vsOut;
 
+#ifdef COMPACT_VERTICES
+// Inverse of OctahedralEncode in Mesh.cpp
+vec3 OctahedralDecode(vec2 encoded)
+{
+    vec3 v = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -fold : fold;
+    v.y += v.y >= 0.0 ? -fold : fold;
+    return normalize(v);
+}
+#endif // COMPACT_VERTICES
+
 void main()
 {
     vec3 surfacePos = aBasePos;
 
 #ifdef HAS_NORMALS
-    vec3 normal = aBaseNormal;
+    #ifdef COMPACT_VERTICES
+        vec3 normal = OctahedralDecode(aBaseNormalOct);
+    #else
+        vec3 normal = aBaseNormal;
+    #endif // COMPACT_VERTICES
 #endif // HAS_NORMALS
 
 // TODO: make sure skeletal animation is independent of morph target animation
@@ -100,11 +106,10 @@ void main()
 #endif // HAS_JOINTS
 
 #ifdef HAS_MORPH_TARGETS
-    surfacePos += morph1Weight * aMorphBasePosDifference1 +
-                    morph2Weight * aMorphBasePosDifference2;
-    #ifdef HAS_NORMALS               
-        normal += morph1Weight * aMorphBaseNormalDifference1 +
-                  morph2Weight * aMorphBaseNormalDifference2;
+    MorphDeltas morphDeltas = SumMorphDeltas(true);
+    surfacePos += morphDeltas.position;
+    #ifdef HAS_NORMALS
+        normal += morphDeltas.normal;
     #endif // HAS_NORMALS
 #endif // HAS_MORPH_TARGETS
 
@@ -129,13 +134,17 @@ void main()
     normal = normalize(finalNormalMatrix * normal);
 
     #ifdef HAS_TANGENTS
-        vsOut.TBN[0] = vec3(aBaseTangent);
+        #ifdef COMPACT_VERTICES
+            vec4 baseTangent = vec4(OctahedralDecode(vec2(aBaseTangentOct.x, aBaseTangentOct.y & ~1) / 32767.0), (aBaseTangentOct.y & 1) != 0 ? -1.0 : 1.0);
+        #else
+            vec4 baseTangent = aBaseTangent;
+        #endif // COMPACT_VERTICES
+        vsOut.TBN[0] = vec3(baseTangent);
         #ifdef HAS_MORPH_TARGETS
-        vsOut.TBN[0] += morph1Weight * aMorphBaseTangentDifference1 +
-                morph2Weight * aMorphBaseTangentDifference2;
+        vsOut.TBN[0] += morphDeltas.tangent;
         #endif
         vsOut.TBN[0] = finalNormalMatrix * vsOut.TBN[0];
-        vsOut.TBN[1] = cross(normal, vsOut.TBN[0]) * aBaseTangent.w; // w (-1 or 1) determines bitangent direction
+        vsOut.TBN[1] = cross(normal, vsOut.TBN[0]) * baseTangent.w; // w (-1 or 1) determines bitangent direction
         vsOut.TBN[2] = normal;
     #else
         vsOut.surfaceNormalVS = normal;
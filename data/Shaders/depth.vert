@@ -6,22 +6,12 @@ layout(location = 3) in vec4 aWeights;
 layout(location = 4) in uint aJoints;
 #endif // HAS_JOINTS
 
-#ifdef HAS_MORPH_TARGETS
-layout(location = 5) in vec3 aMorphBasePosDifference1;
-layout(location = 6) in vec3 aMorphBasePosDifference2;
-#endif // HAS_MORPH_TARGETS
-
 uniform mat4 worldLightProjection;
 
 #ifdef HAS_JOINTS
 uniform mat4 skinningMatrices[128];
 #endif // HAS_JOINTS
 
-#ifdef HAS_MORPH_TARGETS
-uniform float morph1Weight; 
-uniform float morph2Weight;
-#endif // HAS_MORPH_TARGETS
-
 void main()
 {
     vec3 surfacePos = aBasePos;
@@ -36,8 +26,7 @@ void main()
 #endif // HAS_JOINTS
 
 #ifdef HAS_MORPH_TARGETS
-    surfacePos += morph1Weight * aMorphBasePosDifference1 +
-                    morph2Weight * aMorphBasePosDifference2;
+    surfacePos += SumMorphDeltas(false).position;
 #endif // HAS_MORPH_TARGETS
 
     gl_Position = worldLightProjection * vec4(surfacePos, 1.0);
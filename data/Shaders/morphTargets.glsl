@@ -0,0 +1,49 @@
+// Shared by every vertex shader that draws morphed meshes, Shader puts it in front of their code. The one place that
+// knows the morph target buffer layout described in Mesh.h.
+#ifdef HAS_MORPH_TARGETS
+layout(location = 5) in uint aMorphVertex;
+
+// Deltas of every target and their indices laid out as described in Mesh.h, and the weights of every entity, this one's
+// starting at morphWeightOffset
+uniform samplerBuffer morphTargetDeltas;
+uniform usamplerBuffer morphTargetIndices;
+uniform samplerBuffer morphWeights;
+uniform int morphDenseTargetCount;
+uniform int morphVertexCount;
+uniform int morphDeltaStride;
+uniform int morphWeightOffset;
+
+struct MorphDeltas
+{
+    vec3 position;
+    vec3 normal;  // zero unless withShading and the mesh has normals
+    vec3 tangent; // zero unless withShading and the mesh has glTF tangents, generated ones have no deltas
+};
+
+// Weighted sum of the deltas of every target that moves this vertex, with or without the ones only shading needs
+MorphDeltas SumMorphDeltas(bool withShading)
+{
+    MorphDeltas deltas = MorphDeltas(vec3(0.0), vec3(0.0), vec3(0.0));
+    int morphVertex = int(aMorphVertex);
+    int firstSparseEntry = int(texelFetch(morphTargetIndices, morphDenseTargetCount + morphVertex).r);
+    int sparseEntryCount = int(texelFetch(morphTargetIndices, morphDenseTargetCount + morphVertex + 1).r) - firstSparseEntry;
+    // Every dense target, then the sparse entries of this vertex
+    for (int i = 0; i < morphDenseTargetCount + sparseEntryCount; i++)
+    {
+        bool dense = i < morphDenseTargetCount;
+        int entry = firstSparseEntry + i - morphDenseTargetCount;
+        int target = int(texelFetch(morphTargetIndices, dense ? i : morphDenseTargetCount + morphVertexCount + 1 + entry).r);
+        float weight = texelFetch(morphWeights, morphWeightOffset + target).r;
+        if (weight == 0.0)
+        {
+            continue;
+        }
+
+        int texel = (dense ? i * morphVertexCount + morphVertex : morphDenseTargetCount * morphVertexCount + entry) * morphDeltaStride;
+        deltas.position += weight * texelFetch(morphTargetDeltas, texel).xyz;
+        if (withShading && morphDeltaStride > 1) deltas.normal += weight * texelFetch(morphTargetDeltas, texel + 1).xyz;
+        if (withShading && morphDeltaStride > 2) deltas.tangent += weight * texelFetch(morphTargetDeltas, texel + 2).xyz;
+    }
+    return deltas;
+}
+#endif // HAS_MORPH_TARGETS
\ No newline at end of file
@@ -4,9 +4,23 @@ in vec3 localPos;
   
 uniform samplerCube environmentMap;
 uniform float levelOfDetail;
+uniform bool showIrradiance;
+
+layout (std140, binding=2) uniform IrradianceSH {
+    vec4 irradianceSH[9];
+};
+
+vec3 EvaluateIrradianceSH(vec3 n)
+{
+    vec3 irradiance = irradianceSH[0].rgb
+        + irradianceSH[1].rgb * n.y + irradianceSH[2].rgb * n.z + irradianceSH[3].rgb * n.x
+        + irradianceSH[4].rgb * (n.x * n.y) + irradianceSH[5].rgb * (n.y * n.z) + irradianceSH[6].rgb * (3.0 * n.z * n.z - 1.0)
+        + irradianceSH[7].rgb * (n.x * n.z) + irradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(irradiance, 0.0);
+}
   
 void main()
 {
-    vec3 envColor = textureLod(environmentMap, localPos, levelOfDetail).rgb;  
+    vec3 envColor = showIrradiance ? EvaluateIrradianceSH(normalize(localPos)) : textureLod(environmentMap, localPos, levelOfDetail).rgb;  
     fragColor = vec4(envColor, 1.0);
 }
\ No newline at end of file
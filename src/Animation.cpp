@@ -1,4 +1,6 @@
 #include "Animation.h"
+
+#include <algorithm>
 #include "GLTFHelpers.h"
 
 double GetAnimationDurationSeconds(const tinygltf::Animation& animation, const tinygltf::Model& model)
@@ -17,60 +19,152 @@ double GetAnimationDurationSeconds(const tinygltf::Animation& animation, const t
 	return animationDuration;
 }
 
-std::vector<float> SampleWeightsAt(const PropertyAnimation<float>& animation, float normalizedTime, int numMorphTargets)
+Animation LoadAnimation(const tinygltf::Animation& gltfAnimation, const GLTFAsset& asset)
 {
-	assert(animation.method == InterpolationType::LINEAR); // for now, too lazy
-
-	std::vector<float> samples(numMorphTargets);
+	const tinygltf::Model& model = asset.model;
+	Animation animation;
+	animation.durationSeconds = (float)GetAnimationDurationSeconds(gltfAnimation, model);
+	animation.name = gltfAnimation.name;
 
-	if (normalizedTime <= animation.times.front())
+	for (const auto& channel : gltfAnimation.channels)
 	{
-		for (int i = 0; i < numMorphTargets; i++)
+		// Entity might already have another animated channel in this animation, check if so
+		auto entityAnimationIter = std::find_if(animation.entityAnimations.begin(), animation.entityAnimations.end(),
+			[&channel](const EntityAnimation& entityAnimation)
+			{
+				return entityAnimation.entityIdx == channel.target_node;
+			});
+		EntityAnimation* entityAnimation;
+		if (entityAnimationIter != animation.entityAnimations.end())
 		{
-			samples[i] = animation.values[i];
+			entityAnimation = &(*entityAnimationIter);
 		}
-		return samples;
-	}
-	else if (normalizedTime >= animation.times.back())
-	{
-		for (int i = 0; i < numMorphTargets; i++)
+		else
+		{
+			animation.entityAnimations.emplace_back();
+			entityAnimation = &animation.entityAnimations.back();
+		}
+			
+		entityAnimation->entityIdx = channel.target_node;
+
+		const auto& sampler = gltfAnimation.samplers[channel.sampler];
+		InterpolationType method = InterpolationType::LINEAR;
+		if (sampler.interpolation == "STEP") method = InterpolationType::STEP;
+		else if (sampler.interpolation == "CUBICSPLINE") method = InterpolationType::CUBICSPLINE;
+		const auto& keyframeTimesAccessor = model.accessors[sampler.input];
+		const auto& keyframeValuesAccessor = model.accessors[sampler.output];
+		if (channel.target_path == "translation")
+		{
+			entityAnimation->translations.values = AccessorView(keyframeValuesAccessor, asset).ToVector<glm::vec3>();
+			entityAnimation->translations.times = AccessorView(keyframeTimesAccessor, asset).ToVector<float>();
+			entityAnimation->translations.method = method;
+		}
+		else if (channel.target_path == "scale")
+		{
+			entityAnimation->scales.values = AccessorView(keyframeValuesAccessor, asset).ToVector<glm::vec3>();
+			entityAnimation->scales.times = AccessorView(keyframeTimesAccessor, asset).ToVector<float>();
+			entityAnimation->scales.method = method;
+		}
+		else if (channel.target_path == "rotation")
+		{
+			entityAnimation->rotations.values = AccessorView(keyframeValuesAccessor, asset).ToVector<glm::quat>();
+			entityAnimation->rotations.times = AccessorView(keyframeTimesAccessor, asset).ToVector<float>();
+			entityAnimation->rotations.method = method;
+		}
+		else
 		{
-			samples[i] = animation.values[animation.values.size() - numMorphTargets + i];
+			entityAnimation->weights.values = AccessorView(keyframeValuesAccessor, asset).ToVector<float>();
+			entityAnimation->weights.times = AccessorView(keyframeTimesAccessor, asset).ToVector<float>();
+			entityAnimation->weights.method = method;
 		}
-		return samples;
 	}
 
-	int nextKeyframeTimeIndex = 0;
+	return animation;
+}
+
+int FindNextKeyframe(const std::vector<float>& times, float time, KeyframeCursor* cursor)
+{
+	assert(times.size() >= 2);
+	const int lastKeyframe = (int)times.size() - 1;
 
-	while (animation.times[nextKeyframeTimeIndex] <= normalizedTime)
+	if (cursor)
 	{
-		nextKeyframeTimeIndex++;
+		// A frame rarely moves more than a couple of keyframes ahead, even for dense mocap clips
+		constexpr int maxSteps = 4;
+		int next = std::clamp(cursor->nextKeyframe, 1, lastKeyframe);
+		if (times[next - 1] <= time)
+		{
+			for (int step = 0; step < maxSteps && next < lastKeyframe && times[next] <= time; step++)
+			{
+				next++;
+			}
+			if (next == lastKeyframe || time < times[next])
+			{
+				cursor->nextKeyframe = next;
+				return next;
+			}
+		}
 	}
 
-	float previousKeyframeTime = animation.times[nextKeyframeTimeIndex - 1];
-	float nextKeyframeTime = animation.times[nextKeyframeTimeIndex];
-	float t = (normalizedTime - previousKeyframeTime) / (nextKeyframeTime - previousKeyframeTime);
+	const int next = std::clamp((int)(std::upper_bound(times.begin(), times.end(), time) - times.begin()), 1, lastKeyframe);
+	if (cursor) cursor->nextKeyframe = next;
+	return next;
+}
 
-	int indexA = nextKeyframeTimeIndex - 1;
-	std::vector<float> weightsA(numMorphTargets);
-	for (int i = 0; i < numMorphTargets; i++)
+void SampleWeightsAt(const PropertyAnimation<float>& animation, float normalizedTime, std::span<float> weights, KeyframeCursor* cursor)
+{
+	const std::size_t count = weights.size();
+	// Cubic splines keep in-tangents, values and out-tangents of every target per keyframe, in that order
+	const std::size_t slots = animation.method == InterpolationType::CUBICSPLINE ? 3 : 1;
+	const std::size_t valueSlot = animation.method == InterpolationType::CUBICSPLINE ? 1 : 0;
+	assert(animation.values.size() == animation.times.size() * slots * count);
+	auto values = [&](std::size_t keyframe, std::size_t slot) { return animation.values.data() + (keyframe * slots + slot) * count; };
+
+	if (normalizedTime <= animation.times.front() || normalizedTime >= animation.times.back())
 	{
-		weightsA[i] = animation.values[numMorphTargets * indexA + i];
+		const float* nearest = values(normalizedTime <= animation.times.front() ? 0 : animation.times.size() - 1, valueSlot);
+		std::copy(nearest, nearest + count, weights.begin());
+		return;
 	}
 
-	int indexB = nextKeyframeTimeIndex;
-	std::vector<float> weightsB(numMorphTargets);
-	for (int i = 0; i < numMorphTargets; i++)
+	const int nextKeyframe = FindNextKeyframe(animation.times, normalizedTime, cursor);
+	if (animation.method == InterpolationType::STEP)
 	{
-		weightsB[i] = animation.values[numMorphTargets * indexB + i];
+		const float* previous = values(nextKeyframe - 1, 0);
+		std::copy(previous, previous + count, weights.begin());
+		return;
 	}
 
-	for (int i = 0; i < numMorphTargets; i++)
+	float previousTime = animation.times[nextKeyframe - 1];
+	float deltaTime = animation.times[nextKeyframe] - previousTime;
+	float t = (normalizedTime - previousTime) / deltaTime;
+	if (animation.method == InterpolationType::LINEAR)
 	{
-		samples[i] = weightsA[i] + (weightsB[i] - weightsA[i]) * t;
+		const float* previous = values(nextKeyframe - 1, 0);
+		const float* next = values(nextKeyframe, 0);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			weights[i] = previous[i] + (next[i] - previous[i]) * t;
+		}
+		return;
 	}
 
-	return samples;
+	// Same Hermite basis as SampleGroup in AnimationClip.cpp
+	float t2 = t * t;
+	float t3 = t2 * t;
+	const float previousValueWeight = 2 * t3 - 3 * t2 + 1;
+	const float previousOutTangentWeight = (t3 - 2 * t2 + t) * deltaTime;
+	const float nextValueWeight = -2 * t3 + 3 * t2;
+	const float nextInTangentWeight = (t3 - t2) * deltaTime;
+	const float* previousValue = values(nextKeyframe - 1, 1);
+	const float* previousOutTangent = values(nextKeyframe - 1, 2);
+	const float* nextInTangent = values(nextKeyframe, 0);
+	const float* nextValue = values(nextKeyframe, 1);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		weights[i] = previousValue[i] * previousValueWeight + previousOutTangent[i] * previousOutTangentWeight + nextValue[i] * nextValueWeight +
+			nextInTangent[i] * nextInTangentWeight;
+	}
 }
 
 std::vector<glm::mat4> ComputeGlobalMatrices(const Skeleton& skeleton, const std::vector<Entity>& entities)
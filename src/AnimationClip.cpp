@@ -0,0 +1,727 @@
+#include "AnimationClip.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include "Hash.h"
+#include <map>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANIMATION_SSE2
+#include <emmintrin.h>
+#endif
+
+// 4 lanes of floats, one per channel. The interpolation below is written once against it, with SSE2 doing the lanes at
+// once where it's available.
+#ifdef ANIMATION_SSE2
+struct Float4
+{
+	__m128 v;
+
+	static Float4 Load(const float* lanes) { return { _mm_loadu_ps(lanes) }; }
+	static Float4 Load(const std::uint16_t* lanes)
+	{
+		return { _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)lanes), _mm_setzero_si128())) };
+	}
+	static Float4 Broadcast(float value) { return { _mm_set1_ps(value) }; }
+	void Store(float* lanes) const { _mm_storeu_ps(lanes, v); }
+};
+
+static Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+static Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+static Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+static Float4 InverseSqrt(Float4 a) { return { _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(a.v)) }; }
+static Float4 Abs(Float4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+// a negated in the lanes where sign is negative
+static Float4 FlipSign(Float4 a, Float4 sign) { return { _mm_xor_ps(a.v, _mm_and_ps(sign.v, _mm_set1_ps(-0.0f))) }; }
+#else
+struct Float4
+{
+	float v[4];
+
+	static Float4 Load(const float* lanes) { return { lanes[0], lanes[1], lanes[2], lanes[3] }; }
+	static Float4 Load(const std::uint16_t* lanes) { return { (float)lanes[0], (float)lanes[1], (float)lanes[2], (float)lanes[3] }; }
+	static Float4 Broadcast(float value) { return { value, value, value, value }; }
+	void Store(float* lanes) const { for (int i = 0; i < 4; i++) lanes[i] = v[i]; }
+};
+
+template<typename Op>
+static Float4 PerLane(Float4 a, Float4 b, Op op) { return { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) }; }
+static Float4 operator+(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return x + y; }); }
+static Float4 operator-(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return x - y; }); }
+static Float4 operator*(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return x * y; }); }
+static Float4 InverseSqrt(Float4 a) { return PerLane(a, a, [](float x, float) { return 1.0f / std::sqrt(x); }); }
+static Float4 Abs(Float4 a) { return PerLane(a, a, [](float x, float) { return std::abs(x); }); }
+static Float4 FlipSign(Float4 a, Float4 sign) { return PerLane(a, sign, [](float x, float s) { return std::signbit(s) ? -x : x; }); }
+#endif
+
+static void NormalizeQuaternions(Float4 q[4])
+{
+	const Float4 inverseLength = InverseSqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	for (int c = 0; c < 4; c++) q[c] = q[c] * inverseLength;
+}
+
+// Slerp approximated by an nlerp with a corrected t (Arseny Kapoulkine, "Approximating slerp"), within about 1e-3 radians
+// of the real thing but free of trigonometry, so it vectorizes. Takes the shortest path like glm::slerp.
+static void SlerpQuaternions(const Float4 a[4], const Float4 b[4], float t, Float4 out[4])
+{
+	const Float4 cosAngle = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	const Float4 d = Abs(cosAngle);
+
+	const Float4 tMinusHalf = Float4::Broadcast(t - 0.5f);
+	const Float4 ca = Float4::Broadcast(1.0904f) + d * (Float4::Broadcast(-3.2452f) + d * (Float4::Broadcast(3.55645f) - d * Float4::Broadcast(1.43519f)));
+	const Float4 cb = Float4::Broadcast(0.848013f) + d * (Float4::Broadcast(-1.06021f) + d * Float4::Broadcast(0.215638f));
+	const Float4 k = ca * tMinusHalf * tMinusHalf + cb;
+	const Float4 correctedT = Float4::Broadcast(t) + Float4::Broadcast(t * (t - 0.5f) * (t - 1.0f)) * k;
+
+	for (int c = 0; c < 4; c++)
+	{
+		const Float4 bShortestPath = FlipSign(b[c], cosAngle);
+		out[c] = a[c] + (bShortestPath - a[c]) * correctedT;
+	}
+	NormalizeQuaternions(out);
+}
+
+// Linear interpolation of 4 lanes, slerp for rotations
+static void Interpolate(AnimatedProperty property, int componentCount, const Float4 a[4], const Float4 b[4], float t, Float4 out[4])
+{
+	if (property == AnimatedProperty::Rotation)
+	{
+		SlerpQuaternions(a, b, t, out);
+		return;
+	}
+	const Float4 lerpT = Float4::Broadcast(t);
+	for (int c = 0; c < componentCount; c++) out[c] = a[c] + (b[c] - a[c]) * lerpT;
+}
+
+// Every component but a unit quaternion's largest is within +-1/sqrt(2)
+constexpr float smallestThreeRange = 0.70710678f;
+
+static void EncodeSmallestThree(const float q[4], std::uint16_t words[3])
+{
+	int largest = 0;
+	for (int c = 1; c < 4; c++)
+	{
+		if (std::abs(q[c]) > std::abs(q[largest])) largest = c;
+	}
+	const float sign = q[largest] < 0.0f ? -1.0f : 1.0f; // q and -q are the same rotation, so the largest is stored positive
+
+	int word = 0;
+	for (int c = 0; c < 4; c++)
+	{
+		if (c == largest) continue;
+		const float normalized = std::clamp(q[c] * sign / smallestThreeRange * 0.5f + 0.5f, 0.0f, 1.0f);
+		words[word++] = (std::uint16_t)std::lround(normalized * 32767.0f);
+	}
+	// The largest one's index goes in the spare top bits
+	words[0] |= (std::uint16_t)((largest & 1) << 15);
+	words[1] |= (std::uint16_t)((largest >> 1) << 15);
+}
+
+static void DecodeSmallestThree(const std::uint16_t words[3], float q[4])
+{
+	const int largest = (words[0] >> 15) | ((words[1] >> 15) << 1);
+	float sumSquares = 0.0f;
+	int word = 0;
+	for (int c = 0; c < 4; c++)
+	{
+		if (c == largest) continue;
+		q[c] = ((words[word++] & 0x7FFF) / 32767.0f * 2.0f - 1.0f) * smallestThreeRange;
+		sumSquares += q[c] * q[c];
+	}
+	q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSquares));
+}
+
+// q as it reads back after QuantizeGroup stored it with SmallestThree
+static void RoundTripSmallestThree(float q[4])
+{
+	const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	float normalized[4];
+	for (int c = 0; c < 4; c++) normalized[c] = q[c] / length;
+	std::uint16_t words[3];
+	EncodeSmallestThree(normalized, words);
+	DecodeSmallestThree(words, q);
+}
+
+// Decodes one slot of a keyframe for the 4 lanes starting at lane
+static void LoadKeyframe(const AnimationClip::ChannelGroup& group, int keyframe, int slot, int lane, Float4 out[4])
+{
+	switch (group.encoding)
+	{
+	case AnimationClip::ChannelGroup::Encoding::Float:
+		for (int c = 0; c < group.componentCount; c++) out[c] = Float4::Load(group.Lanes(keyframe, slot, c) + lane);
+		break;
+	case AnimationClip::ChannelGroup::Encoding::Range16:
+		for (int c = 0; c < group.componentCount; c++)
+		{
+			const std::size_t rangeIdx = ((std::size_t)slot * group.componentCount + c) * group.laneCount + lane;
+			const Float4 words = Float4::Load(group.QuantizedLanes(keyframe, slot, c) + lane);
+			out[c] = Float4::Load(&group.rangeMin[rangeIdx]) + words * Float4::Load(&group.rangeScale[rangeIdx]);
+		}
+		break;
+	case AnimationClip::ChannelGroup::Encoding::SmallestThree:
+	{
+		float components[4][4];
+		for (int i = 0; i < 4; i++)
+		{
+			const std::uint16_t words[3] = { group.QuantizedLanes(keyframe, slot, 0)[lane + i], group.QuantizedLanes(keyframe, slot, 1)[lane + i],
+				group.QuantizedLanes(keyframe, slot, 2)[lane + i] };
+			float q[4];
+			DecodeSmallestThree(words, q);
+			for (int c = 0; c < 4; c++) components[c][i] = q[c];
+		}
+		for (int c = 0; c < 4; c++) out[c] = Float4::Load(components[c]);
+		break;
+	}
+	}
+}
+
+static void WriteLane(AnimatedProperty property, const float components[4][4], int lane, Transform& transform)
+{
+	switch (property)
+	{
+	case AnimatedProperty::Translation:
+		transform.translation = glm::vec3(components[0][lane], components[1][lane], components[2][lane]);
+		break;
+	case AnimatedProperty::Scale:
+		transform.scale = glm::vec3(components[0][lane], components[1][lane], components[2][lane]);
+		break;
+	case AnimatedProperty::Rotation:
+		transform.rotation = glm::quat(components[3][lane], components[0][lane], components[1][lane], components[2][lane]);
+		break;
+	}
+}
+
+static void SampleGroup(const AnimationClip::ChannelGroup& group, const std::vector<float>& times, float time, KeyframeCursor& cursor,
+	std::vector<Entity>& entities)
+{
+	const bool cubic = group.method == InterpolationType::CUBICSPLINE;
+	const int valueSlot = cubic ? 1 : 0; // cubic splines have the value between the in and out tangents
+
+	// Outside the keyframes and for steps every lane is a copy of one keyframe
+	int constantKeyframe = -1;
+	int nextKeyframe = 0;
+	float t = 0.0f, deltaTime = 0.0f;
+	if (time < times.front() || times.size() == 1)
+	{
+		constantKeyframe = 0;
+	}
+	else if (time > times.back())
+	{
+		constantKeyframe = (int)times.size() - 1;
+	}
+	else
+	{
+		nextKeyframe = FindNextKeyframe(times, time, &cursor);
+		deltaTime = times[nextKeyframe] - times[nextKeyframe - 1];
+		t = (time - times[nextKeyframe - 1]) / deltaTime;
+		if (group.method == InterpolationType::STEP) constantKeyframe = nextKeyframe - 1;
+	}
+
+	// Hermite basis, the same for every lane
+	const float t2 = t * t, t3 = t2 * t;
+	const Float4 h00 = Float4::Broadcast(2 * t3 - 3 * t2 + 1);
+	const Float4 h10 = Float4::Broadcast((t3 - 2 * t2 + t) * deltaTime);
+	const Float4 h01 = Float4::Broadcast(-2 * t3 + 3 * t2);
+	const Float4 h11 = Float4::Broadcast((t3 - t2) * deltaTime);
+
+	const int channelCount = (int)group.entities.size();
+	for (int lane = 0; lane < channelCount; lane += 4)
+	{
+		Float4 out[4];
+		if (constantKeyframe >= 0)
+		{
+			LoadKeyframe(group, constantKeyframe, valueSlot, lane, out);
+		}
+		else if (!cubic)
+		{
+			Float4 a[4], b[4];
+			LoadKeyframe(group, nextKeyframe - 1, 0, lane, a);
+			LoadKeyframe(group, nextKeyframe, 0, lane, b);
+			Interpolate(group.property, group.componentCount, a, b, t, out);
+		}
+		else
+		{
+			Float4 previousValue[4], previousOutTangent[4], nextInTangent[4], nextValue[4];
+			LoadKeyframe(group, nextKeyframe - 1, 1, lane, previousValue);
+			LoadKeyframe(group, nextKeyframe - 1, 2, lane, previousOutTangent);
+			LoadKeyframe(group, nextKeyframe, 0, lane, nextInTangent);
+			LoadKeyframe(group, nextKeyframe, 1, lane, nextValue);
+			for (int c = 0; c < group.componentCount; c++)
+			{
+				out[c] = previousValue[c] * h00 + previousOutTangent[c] * h10 + nextValue[c] * h01 + nextInTangent[c] * h11;
+			}
+			if (group.property == AnimatedProperty::Rotation) NormalizeQuaternions(out);
+		}
+
+		float components[4][4];
+		for (int c = 0; c < group.componentCount; c++) out[c].Store(components[c]);
+		for (int i = 0; i < 4 && lane + i < channelCount; i++)
+		{
+			WriteLane(group.property, components, i, entities[group.entities[lane + i]].transform);
+		}
+	}
+}
+
+void SampleAnimationClip(const AnimationClip& clip, float time, std::span<KeyframeCursor> cursors, std::vector<Entity>& entities)
+{
+	assert(cursors.size() == clip.CursorCount());
+
+	for (int i = 0; i < clip.groups.size(); i++)
+	{
+		const AnimationClip::ChannelGroup& group = clip.groups[i];
+		SampleGroup(group, clip.timeTracks[group.timeTrack], time, cursors[i], entities);
+	}
+
+	for (int i = 0; i < clip.weightChannels.size(); i++)
+	{
+		const AnimationClip::WeightChannel& channel = clip.weightChannels[i];
+		SampleWeightsAt(channel.weights, time, entities[channel.entity].morphTargetWeights, &cursors[clip.groups.size() + i]);
+	}
+}
+
+// Keyframe time arrays, each stored once
+struct TimeTrackSet
+{
+	std::vector<std::vector<float>>& tracks;
+	std::unordered_map<std::uint64_t, std::vector<int>> tracksByHash;
+
+	int Find(const std::vector<float>& times)
+	{
+		std::vector<int>& candidates = tracksByHash[HashBytes({ (const std::uint8_t*)times.data(), times.size() * sizeof(float) })];
+		for (int candidate : candidates)
+		{
+			if (tracks[candidate] == times) return candidate;
+		}
+		candidates.push_back((int)tracks.size());
+		tracks.push_back(times);
+		return candidates.back();
+	}
+};
+
+// How far the joints below entityIdx reach from it in its own space, going by the rest pose. A bound rather than exact,
+// each child adds its own reach to its distance.
+static float DescendantReach(const std::vector<Entity>& entities, int entityIdx, std::vector<float>& reach)
+{
+	if (reach[entityIdx] >= 0.0f) return reach[entityIdx];
+
+	float result = 0.0f;
+	for (int child : entities[entityIdx].children)
+	{
+		const glm::vec3& scale = entities[child].transform.scale;
+		const float maxScale = std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z) });
+		result = std::max(result, glm::length(entities[child].transform.translation) + maxScale * DescendantReach(entities, child, reach));
+	}
+	return reach[entityIdx] = result;
+}
+
+// Error a channel may have, as a distance for translations, a per component difference for scales and an angle for
+// rotations, so that nothing below the joint it animates moves by more than the positional error
+static float ChannelTolerance(AnimatedProperty property, int entityIdx, const std::vector<Entity>& entities, std::vector<float>& reach,
+	const AnimationCompression& compression)
+{
+	// Whatever hangs off a joint, like a mesh or the bones of a leaf joint, is assumed to reach at least this far
+	constexpr float minimumReach = 0.1f;
+	const bool known = entityIdx < entities.size();
+	const float ownReach = std::max(known ? DescendantReach(entities, entityIdx, reach) : 0.0f, minimumReach);
+
+	switch (property)
+	{
+	case AnimatedProperty::Translation:
+		return compression.positionalError;
+	case AnimatedProperty::Scale:
+		return compression.positionalError / ownReach;
+	case AnimatedProperty::Rotation:
+	{
+		// Rotation applies after the joint's own scale
+		const glm::vec3 scale = known ? entities[entityIdx].transform.scale : glm::vec3(1.0f);
+		const float maxScale = std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z), 1e-6f });
+		return std::min(compression.angularError, compression.positionalError / (maxScale * ownReach));
+	}
+	}
+	return 0.0f;
+}
+
+// How far apart two values of a channel are, in the units ChannelTolerance uses
+static float ValueError(AnimatedProperty property, const float a[4], const float b[4])
+{
+	switch (property)
+	{
+	case AnimatedProperty::Translation:
+		return std::sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+	case AnimatedProperty::Scale:
+		return std::max({ std::abs(a[0] - b[0]), std::abs(a[1] - b[1]), std::abs(a[2] - b[2]) });
+	case AnimatedProperty::Rotation:
+	{
+		// From the chord between the quaternions rather than their dot product, whose acos can't resolve the small angles
+		// tolerances are made of in float
+		const float sign = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.0f ? -1.0f : 1.0f;
+		float chordSquared = 0.0f;
+		for (int c = 0; c < 4; c++) chordSquared += (a[c] - sign * b[c]) * (a[c] - sign * b[c]);
+		return 4.0f * std::asin(std::min(std::sqrt(chordSquared) * 0.5f, 1.0f));
+	}
+	}
+	return 0.0f;
+}
+
+// Whether each of the 4 lanes of values starting at lane is within its tolerance of expected
+static bool LanesWithinTolerance(const AnimationClip::ChannelGroup& group, int lane, const Float4 expected[4], const Float4 values[4],
+	const std::vector<float>& tolerances)
+{
+	float expectedComponents[4][4], valueComponents[4][4];
+	for (int c = 0; c < group.componentCount; c++)
+	{
+		expected[c].Store(expectedComponents[c]);
+		values[c].Store(valueComponents[c]);
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		float expectedValue[4], value[4];
+		for (int c = 0; c < group.componentCount; c++)
+		{
+			expectedValue[c] = expectedComponents[c][i];
+			value[c] = valueComponents[c][i];
+		}
+		if (ValueError(group.property, expectedValue, value) > tolerances[lane + i]) return false;
+	}
+	return true;
+}
+
+// Whether every keyframe value of group, which may be quantized, is within tolerance of the same keyframe of the Float
+// group source
+static bool KeyframesWithinTolerance(const AnimationClip::ChannelGroup& group, const AnimationClip::ChannelGroup& source,
+	int keyframeCount, const std::vector<float>& tolerances)
+{
+	const int valueSlot = group.method == InterpolationType::CUBICSPLINE ? 1 : 0;
+	for (int keyframe = 0; keyframe < keyframeCount; keyframe++)
+	{
+		for (int lane = 0; lane < group.laneCount; lane += 4)
+		{
+			Float4 expected[4], value[4];
+			LoadKeyframe(source, keyframe, valueSlot, lane, expected);
+			LoadKeyframe(group, keyframe, valueSlot, lane, value);
+			if (!LanesWithinTolerance(group, lane, expected, value, tolerances)) return false;
+		}
+	}
+	return true;
+}
+
+// Whether every lane of group, interpolated straight from keyframe first to keyframe last the way the sampler would,
+// stays within its tolerance of the Float group source at each keyframe in between. group is decoded like the sampler
+// decodes it, so its quantization error counts against the tolerance as well.
+static bool SpanWithinTolerance(const AnimationClip::ChannelGroup& group, const AnimationClip::ChannelGroup& source, const std::vector<float>& times,
+	int first, int last, const std::vector<float>& tolerances)
+{
+	const float spanTime = times[last] - times[first];
+	for (int keyframe = first + 1; keyframe < last; keyframe++)
+	{
+		const float t = spanTime > 0.0f ? (times[keyframe] - times[first]) / spanTime : 0.0f;
+		for (int lane = 0; lane < group.laneCount; lane += 4)
+		{
+			Float4 a[4], b[4], expected[4], sampled[4];
+			LoadKeyframe(group, first, 0, lane, a);
+			LoadKeyframe(source, keyframe, 0, lane, expected);
+			if (group.method == InterpolationType::STEP)
+			{
+				std::copy(a, a + 4, sampled);
+			}
+			else
+			{
+				LoadKeyframe(group, last, 0, lane, b);
+				Interpolate(group.property, group.componentCount, a, b, t, sampled);
+			}
+			if (!LanesWithinTolerance(group, lane, expected, sampled, tolerances)) return false;
+		}
+	}
+	return true;
+}
+
+// Keyframes of a linear or step group to keep, greedily skipping as many as stay within tolerance of source. Spans are
+// capped so long holds don't make this quadratic.
+static std::vector<int> ReduceKeyframes(const AnimationClip::ChannelGroup& group, const AnimationClip::ChannelGroup& source,
+	const std::vector<float>& times, const std::vector<float>& tolerances)
+{
+	constexpr int maxSpan = 256;
+	const int lastKeyframe = (int)times.size() - 1;
+	std::vector<int> kept = { 0 };
+	if (lastKeyframe == 0) return kept;
+
+	int anchor = 0;
+	int end = 1;
+	while (end < lastKeyframe)
+	{
+		if (end + 1 - anchor <= maxSpan && SpanWithinTolerance(group, source, times, anchor, end + 1, tolerances))
+		{
+			end++;
+		}
+		else
+		{
+			kept.push_back(end);
+			anchor = end++;
+		}
+	}
+	kept.push_back(lastKeyframe);
+	return kept;
+}
+
+// Replaces a Float group's values with their quantized words
+static void QuantizeGroup(AnimationClip::ChannelGroup& group)
+{
+	using Encoding = AnimationClip::ChannelGroup::Encoding;
+	const int keyframeCount = (int)(group.values.size() / ((std::size_t)group.slotCount * group.componentCount * group.laneCount));
+	// Cubic tangents aren't unit quaternions
+	group.encoding = group.property == AnimatedProperty::Rotation && group.method != InterpolationType::CUBICSPLINE ? Encoding::SmallestThree :
+		Encoding::Range16;
+	const int wordCount = group.WordCount();
+	group.quantizedValues.resize((std::size_t)keyframeCount * group.slotCount * wordCount * group.laneCount);
+	auto word = [&](int keyframe, int slot, int word, int lane) -> std::uint16_t&
+	{
+		return group.quantizedValues[(((std::size_t)keyframe * group.slotCount + slot) * wordCount + word) * group.laneCount + lane];
+	};
+
+	if (group.encoding == Encoding::SmallestThree)
+	{
+		for (int keyframe = 0; keyframe < keyframeCount; keyframe++)
+		{
+			for (int slot = 0; slot < group.slotCount; slot++)
+			{
+				for (int lane = 0; lane < group.laneCount; lane++)
+				{
+					float q[4];
+					for (int c = 0; c < 4; c++) q[c] = group.Lanes(keyframe, slot, c)[lane];
+					const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+					for (int c = 0; c < 4; c++) q[c] /= length;
+
+					std::uint16_t words[3];
+					EncodeSmallestThree(q, words);
+					for (int w = 0; w < 3; w++) word(keyframe, slot, w, lane) = words[w];
+				}
+			}
+		}
+	}
+	else
+	{
+		group.rangeMin.resize((std::size_t)group.slotCount * group.componentCount * group.laneCount);
+		group.rangeScale.resize(group.rangeMin.size());
+		for (int slot = 0; slot < group.slotCount; slot++)
+		{
+			for (int c = 0; c < group.componentCount; c++)
+			{
+				for (int lane = 0; lane < group.laneCount; lane++)
+				{
+					float min = INFINITY, max = -INFINITY;
+					for (int keyframe = 0; keyframe < keyframeCount; keyframe++)
+					{
+						min = std::min(min, group.Lanes(keyframe, slot, c)[lane]);
+						max = std::max(max, group.Lanes(keyframe, slot, c)[lane]);
+					}
+
+					const std::size_t rangeIdx = ((std::size_t)slot * group.componentCount + c) * group.laneCount + lane;
+					group.rangeMin[rangeIdx] = min;
+					group.rangeScale[rangeIdx] = (max - min) / 65535.0f;
+					for (int keyframe = 0; keyframe < keyframeCount; keyframe++)
+					{
+						const float normalized = max > min ? (group.Lanes(keyframe, slot, c)[lane] - min) / (max - min) : 0.0f;
+						word(keyframe, slot, c, lane) = (std::uint16_t)std::lround(normalized * 65535.0f);
+					}
+				}
+			}
+		}
+	}
+
+	group.values.clear();
+	group.values.shrink_to_fit();
+}
+
+AnimationClip CompileAnimationClip(const Animation& animation, const std::vector<Entity>& entities, const AnimationCompression& compression)
+{
+	AnimationClip clip;
+	clip.durationSeconds = animation.durationSeconds;
+	clip.name = animation.name;
+
+	// Groups start out on the channels' own time tracks, compression may then drop keyframes from them
+	std::vector<std::vector<float>> sourceTimeTracks;
+	TimeTrackSet sourceTracks{ sourceTimeTracks };
+	TimeTrackSet clipTracks{ clip.timeTracks };
+
+	std::vector<float> reach(entities.size(), -1.0f);
+
+	// Channels are gathered per group first, their lanes are laid out once each group's size is known
+	struct PendingChannel
+	{
+		int entity;
+		std::vector<float> values; // the channel's keyframe values with their components in xyzw order
+	};
+	std::map<std::tuple<AnimatedProperty, InterpolationType, int>, int> groupIndices;
+	std::vector<std::vector<PendingChannel>> pendingChannels;
+
+	auto addChannel = [&](int entity, AnimatedProperty property, InterpolationType method, const std::vector<float>& times, std::vector<float> values,
+		int componentCount)
+	{
+		const int slotCount = method == InterpolationType::CUBICSPLINE ? 3 : 1;
+		if (times.empty() || values.size() != times.size() * slotCount * componentCount)
+		{
+			assert(false && "Keyframe value count doesn't match the keyframe times");
+			return;
+		}
+
+		// Channels that hold still within tolerance, like most of the joints mocap records, are cut to one keyframe and then
+		// share a group with every other such channel. The keyframe is checked both as it is and as SmallestThree would
+		// store it, since its group may end up either way. Range16 stores a single keyframe exactly.
+		int timeTrack = -1;
+		if (compression.enabled && method != InterpolationType::CUBICSPLINE && times.size() > 1)
+		{
+			const float tolerance = ChannelTolerance(property, entity, entities, reach, compression);
+			float quantized[4];
+			std::copy(values.begin(), values.begin() + componentCount, quantized);
+			if (property == AnimatedProperty::Rotation) RoundTripSmallestThree(quantized);
+			bool constant = true;
+			for (std::size_t keyframe = 1; keyframe < times.size() && constant; keyframe++)
+			{
+				const float* value = values.data() + keyframe * componentCount;
+				constant = ValueError(property, values.data(), value) <= tolerance && ValueError(property, quantized, value) <= tolerance;
+			}
+			if (constant)
+			{
+				values.resize(componentCount);
+				timeTrack = sourceTracks.Find({ times.front() });
+			}
+		}
+		if (timeTrack < 0) timeTrack = sourceTracks.Find(times);
+
+		auto [groupIter, inserted] = groupIndices.try_emplace({ property, method, timeTrack }, (int)clip.groups.size());
+		if (inserted)
+		{
+			AnimationClip::ChannelGroup& group = clip.groups.emplace_back();
+			group.property = property;
+			group.method = method;
+			group.timeTrack = timeTrack;
+			group.componentCount = componentCount;
+			group.slotCount = slotCount;
+			pendingChannels.emplace_back();
+		}
+		clip.groups[groupIter->second].entities.push_back(entity);
+		pendingChannels[groupIter->second].push_back({ entity, std::move(values) });
+	};
+
+	for (const EntityAnimation& entityAnimation : animation.entityAnimations)
+	{
+		const int entity = entityAnimation.entityIdx;
+		for (const auto& [property, vec3Animation] : { std::pair{ AnimatedProperty::Translation, &entityAnimation.translations },
+			std::pair{ AnimatedProperty::Scale, &entityAnimation.scales } })
+		{
+			if (vec3Animation->values.empty()) continue;
+			std::vector<float> values;
+			values.reserve(vec3Animation->values.size() * 3);
+			for (const glm::vec3& value : vec3Animation->values) values.insert(values.end(), { value.x, value.y, value.z });
+			addChannel(entity, property, vec3Animation->method, vec3Animation->times, std::move(values), 3);
+		}
+
+		if (!entityAnimation.rotations.values.empty())
+		{
+			std::vector<float> values;
+			values.reserve(entityAnimation.rotations.values.size() * 4);
+			for (const glm::quat& value : entityAnimation.rotations.values) values.insert(values.end(), { value.x, value.y, value.z, value.w });
+			addChannel(entity, AnimatedProperty::Rotation, entityAnimation.rotations.method, entityAnimation.rotations.times, std::move(values), 4);
+		}
+
+		if (!entityAnimation.weights.values.empty())
+		{
+			clip.weightChannels.push_back({ entity, entityAnimation.weights });
+		}
+	}
+
+	for (int groupIdx = 0; groupIdx < clip.groups.size(); groupIdx++)
+	{
+		AnimationClip::ChannelGroup& group = clip.groups[groupIdx];
+		const std::vector<PendingChannel>& channels = pendingChannels[groupIdx];
+		const int keyframeCount = (int)sourceTimeTracks[group.timeTrack].size();
+		group.laneCount = ((int)channels.size() + 3) / 4 * 4;
+		group.values.resize((std::size_t)keyframeCount * group.slotCount * group.componentCount * group.laneCount);
+
+		for (int lane = 0; lane < group.laneCount; lane++)
+		{
+			const std::vector<float>& values = channels[lane < channels.size() ? lane : 0].values;
+			for (int keyframe = 0; keyframe < keyframeCount; keyframe++)
+			{
+				for (int slot = 0; slot < group.slotCount; slot++)
+				{
+					for (int c = 0; c < group.componentCount; c++)
+					{
+						const std::size_t valueIdx = ((std::size_t)keyframe * group.slotCount + slot) * group.componentCount + c;
+						group.values[valueIdx * group.laneCount + lane] = values[valueIdx];
+					}
+				}
+			}
+		}
+
+		std::vector<float> times = sourceTimeTracks[group.timeTrack];
+		if (compression.enabled)
+		{
+			std::vector<float> tolerances(group.laneCount);
+			for (int lane = 0; lane < group.laneCount; lane++)
+			{
+				tolerances[lane] = ChannelTolerance(group.property, channels[lane < channels.size() ? lane : 0].entity, entities, reach, compression);
+			}
+
+			// Quantized before keyframes are dropped, so the error the dropped ones are checked against is the one the
+			// clip ends up with. Groups whose tolerance is finer than quantization, like joints high up a large hierarchy,
+			// stay Float. Only the keyframe values of cubic splines are checked, not their tangents.
+			const AnimationClip::ChannelGroup source = group;
+			QuantizeGroup(group);
+			if (!KeyframesWithinTolerance(group, source, keyframeCount, tolerances))
+			{
+				group = source;
+			}
+
+			const std::vector<int> kept = group.method != InterpolationType::CUBICSPLINE ? ReduceKeyframes(group, source, times, tolerances) :
+				std::vector<int>();
+			if (!kept.empty() && kept.size() < times.size())
+			{
+				// Quantized groups keep their ranges, which were fit to every keyframe
+				auto keepKeyframes = [&](auto& keyframeData)
+				{
+					std::remove_reference_t<decltype(keyframeData)> keptData;
+					const std::size_t keyframeSize = keyframeData.size() / times.size();
+					keptData.reserve(kept.size() * keyframeSize);
+					for (int keyframe : kept)
+					{
+						keptData.insert(keptData.end(), keyframeData.begin() + keyframe * keyframeSize, keyframeData.begin() + (keyframe + 1) * keyframeSize);
+					}
+					keyframeData = std::move(keptData);
+				};
+				if (group.encoding == AnimationClip::ChannelGroup::Encoding::Float) keepKeyframes(group.values);
+				else keepKeyframes(group.quantizedValues);
+
+				std::vector<float> keptTimes;
+				keptTimes.reserve(kept.size());
+				for (int keyframe : kept) keptTimes.push_back(times[keyframe]);
+				times = std::move(keptTimes);
+			}
+		}
+		group.timeTrack = clipTracks.Find(times);
+	}
+
+	return clip;
+}
+
+std::size_t AnimationClip::Bytes() const
+{
+	std::size_t bytes = sizeof(AnimationClip) + name.capacity() + timeTracks.capacity() * sizeof(timeTracks[0]) +
+		groups.capacity() * sizeof(ChannelGroup) + weightChannels.capacity() * sizeof(WeightChannel);
+	for (const std::vector<float>& times : timeTracks) bytes += times.capacity() * sizeof(float);
+	for (const ChannelGroup& group : groups)
+	{
+		bytes += group.values.capacity() * sizeof(float) + group.quantizedValues.capacity() * sizeof(std::uint16_t) +
+			(group.rangeMin.capacity() + group.rangeScale.capacity()) * sizeof(float) + group.entities.capacity() * sizeof(int);
+	}
+	for (const WeightChannel& channel : weightChannels)
+	{
+		bytes += channel.weights.values.capacity() * sizeof(float) + channel.weights.times.capacity() * sizeof(float);
+	}
+	return bytes;
+}
\ No newline at end of file
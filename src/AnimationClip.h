@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Animation.h"
+#include <cstddef>
+#include <cstdint>
+#include "Entity.h"
+#include <span>
+#include <string>
+#include <vector>
+
+enum class AnimatedProperty
+{
+	Translation,
+	Scale,
+	Rotation,
+};
+
+// Lossy settings for CompileAnimationClip. Errors are measured in the space of the parent of the joint a channel animates,
+// and a joint's rotation or scale error counts as far as it moves the joints below it.
+struct AnimationCompression
+{
+	bool enabled = false;
+	float positionalError = 0.001f; // how far any joint may end up from where the raw keyframes put it, in scene units
+	float angularError = 0.001f;    // radians, how far any joint's own rotation may end up from the raw keyframes'
+};
+
+// An Animation compiled for sampling many channels at once. Channels animating the same property with the same
+// interpolation and keyframe times are grouped, so a group finds its keyframe once and then interpolates all of its
+// channels side by side, 4 at a time. Identical keyframe time arrays, which exporters usually write once per clip
+// anyway, are only stored once.
+struct AnimationClip
+{
+	struct ChannelGroup
+	{
+		AnimatedProperty property;
+		InterpolationType method;
+		int timeTrack;
+		int componentCount; // 3 for translation and scale, 4 (xyzw) for rotation
+		int slotCount;      // values per keyframe, 3 for cubic splines (in-tangent, value, out-tangent), 1 otherwise
+		int laneCount;      // channels rounded up to a multiple of 4, padding lanes repeat the first channel
+		std::vector<int> entities; // the entity each channel animates
+
+		enum class Encoding
+		{
+			Float,
+			Range16,       // 16 bits per component, normalized to the channel's range for that component and slot
+			SmallestThree, // unit quaternions in 48 bits, the 3 smallest components at 15 bits and the largest one's index
+		};
+		Encoding encoding = Encoding::Float;
+
+		// Structure of arrays, [keyframe][slot][component][lane], so a component of 4 neighbouring channels is one load.
+		// Quantized groups keep words in quantizedValues instead, with 3 words per slot for SmallestThree.
+		std::vector<float> values;
+		std::vector<std::uint16_t> quantizedValues;
+		// Range16 only, [slot][component][lane]. A word w decodes to rangeMin + w * rangeScale.
+		std::vector<float> rangeMin, rangeScale;
+
+		int WordCount() const { return encoding == Encoding::SmallestThree ? 3 : componentCount; }
+		const float* Lanes(int keyframe, int slot, int component) const
+		{
+			return values.data() + (((std::size_t)keyframe * slotCount + slot) * componentCount + component) * laneCount;
+		}
+		const std::uint16_t* QuantizedLanes(int keyframe, int slot, int word) const
+		{
+			return quantizedValues.data() + (((std::size_t)keyframe * slotCount + slot) * WordCount() + word) * laneCount;
+		}
+	};
+
+	// Morph weights have a variable number of components per channel, they're sampled one channel at a time
+	struct WeightChannel
+	{
+		int entity;
+		PropertyAnimation<float> weights;
+	};
+
+	std::vector<std::vector<float>> timeTracks;
+	std::vector<ChannelGroup> groups;
+	std::vector<WeightChannel> weightChannels;
+	float durationSeconds = 0.0f;
+	std::string name;
+
+	// One cursor per group followed by one per weight channel
+	std::size_t CursorCount() const { return groups.size() + weightChannels.size(); }
+	std::size_t Bytes() const;
+};
+
+// With compression enabled, groups are quantized unless that alone breaks the error bounds, and then keyframes are
+// dropped as long as the quantized values interpolated over them stay within the bounds. entities are needed for their
+// hierarchy and rest pose, to know how far below each joint its errors reach. Cubic splines are quantized but keep all
+// of their keyframes.
+AnimationClip CompileAnimationClip(const Animation& animation, const std::vector<Entity>& entities = {}, const AnimationCompression& compression = {});
+
+// Samples every channel of clip at time, which should be within [0, durationSeconds], and writes the results into the
+// transforms and morph target weights of the entities they animate
+void SampleAnimationClip(const AnimationClip& clip, float time, std::span<KeyframeCursor> cursors, std::vector<Entity>& entities);
\ No newline at end of file
@@ -0,0 +1,129 @@
+// gltf-anim-compress: compiles every animation of a glTF file with and without compression and reports how much smaller
+// the compressed clips are and how far they move any joint from where the raw clips put it.
+#include <algorithm>
+#include <cmath>
+#include "Animation.h"
+#include "AnimationClip.h"
+#include "GLTFAsset.h"
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Sampled this often to measure errors, well above the rate of most keyframes so errors between them show up too
+constexpr float errorSampleRate = 240.0f;
+
+static void ComputeGlobalTransforms(const std::vector<Entity>& entities, int entityIdx, const glm::mat4& parentTransform, std::vector<glm::mat4>& globalTransforms)
+{
+	globalTransforms[entityIdx] = parentTransform * entities[entityIdx].transform.GetMatrix();
+	for (int child : entities[entityIdx].children)
+	{
+		ComputeGlobalTransforms(entities, child, globalTransforms[entityIdx], globalTransforms);
+	}
+}
+
+static std::vector<glm::mat4> ComputeGlobalTransforms(const std::vector<Entity>& entities)
+{
+	std::vector<glm::mat4> globalTransforms(entities.size());
+	for (int i = 0; i < entities.size(); i++)
+	{
+		if (entities[i].parent < 0) ComputeGlobalTransforms(entities, i, glm::mat4(1.0f), globalTransforms);
+	}
+	return globalTransforms;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: gltf-anim-compress <model.gltf|.glb> [positional error] [angular error in radians]\n";
+		return 1;
+	}
+
+	AnimationCompression compression;
+	compression.enabled = true;
+	if (argc > 2) compression.positionalError = std::stof(argv[2]);
+	if (argc > 3) compression.angularError = std::stof(argv[3]);
+
+	GLTFAsset asset;
+	std::string err, warn;
+	if (!LoadGLTFAsset(argv[1], asset, &err, &warn))
+	{
+		std::cout << "Failed to load " << argv[1] << ": " << err << '\n';
+		return 1;
+	}
+	if (asset.model.animations.empty())
+	{
+		std::cout << "No animations\n";
+		return 1;
+	}
+
+	// Just the hierarchy, rest pose and morph weights, which is all the clips need
+	std::vector<Entity> entities(asset.model.nodes.size());
+	for (int i = 0; i < entities.size(); i++)
+	{
+		const tinygltf::Node& node = asset.model.nodes[i];
+		entities[i].transform = GetNodeTransform(node);
+		entities[i].children = node.children;
+		if (node.mesh >= 0) entities[i].morphTargetWeights.resize(asset.model.meshes[node.mesh].primitives[0].targets.size());
+		for (int child : entities[i].children) entities[child].parent = i;
+	}
+
+	std::size_t totalRawBytes = 0, totalCompressedBytes = 0;
+	float totalMaxPositionError = 0.0f, totalMaxAngularError = 0.0f;
+	for (int animationIdx = 0; animationIdx < asset.model.animations.size(); animationIdx++)
+	{
+		const Animation animation = LoadAnimation(asset.model.animations[animationIdx], asset);
+		const AnimationClip raw = CompileAnimationClip(animation);
+		const AnimationClip compressed = CompileAnimationClip(animation, entities, compression);
+
+		// Position error is measured on every joint in world space, so errors that add up down the hierarchy count.
+		// Angular error is measured on each joint's own rotation.
+		std::vector<KeyframeCursor> rawCursors(raw.CursorCount()), compressedCursors(compressed.CursorCount());
+		std::vector<Entity> rawPose = entities, compressedPose = entities;
+		float maxPositionError = 0.0f, maxAngularError = 0.0f;
+		const int sampleCount = (int)std::ceil(animation.durationSeconds * errorSampleRate) + 1;
+		for (int sample = 0; sample < sampleCount; sample++)
+		{
+			const float time = std::min(sample / errorSampleRate, animation.durationSeconds);
+			SampleAnimationClip(raw, time, rawCursors, rawPose);
+			SampleAnimationClip(compressed, time, compressedCursors, compressedPose);
+
+			const std::vector<glm::mat4> rawGlobals = ComputeGlobalTransforms(rawPose);
+			const std::vector<glm::mat4> compressedGlobals = ComputeGlobalTransforms(compressedPose);
+			for (int i = 0; i < entities.size(); i++)
+			{
+				maxPositionError = std::max(maxPositionError, glm::length(glm::vec3(rawGlobals[i][3]) - glm::vec3(compressedGlobals[i][3])));
+
+				// From the chord rather than the dot product, which can't resolve small angles in float
+				const glm::quat a = rawPose[i].transform.rotation;
+				const glm::quat b = glm::dot(a, compressedPose[i].transform.rotation) < 0.0f ? -compressedPose[i].transform.rotation :
+					compressedPose[i].transform.rotation;
+				const float chord = glm::length(glm::vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w));
+				maxAngularError = std::max(maxAngularError, 4.0f * std::asin(std::min(chord * 0.5f, 1.0f)));
+			}
+		}
+
+		std::size_t rawKeyframes = 0, compressedKeyframes = 0;
+		for (const AnimationClip::ChannelGroup& group : raw.groups) rawKeyframes += raw.timeTracks[group.timeTrack].size() * group.entities.size();
+		for (const AnimationClip::ChannelGroup& group : compressed.groups)
+		{
+			compressedKeyframes += compressed.timeTracks[group.timeTrack].size() * group.entities.size();
+		}
+
+		const std::string name = animation.name.empty() ? "Anim " + std::to_string(animationIdx) : animation.name;
+		std::cout << name << ": " << raw.Bytes() << " -> " << compressed.Bytes() << " bytes (" << (float)raw.Bytes() / compressed.Bytes() << "x), "
+			<< rawKeyframes << " -> " << compressedKeyframes << " channel keyframes, max position error " << maxPositionError
+			<< ", max angular error " << maxAngularError << " rad\n";
+
+		totalRawBytes += raw.Bytes();
+		totalCompressedBytes += compressed.Bytes();
+		totalMaxPositionError = std::max(totalMaxPositionError, maxPositionError);
+		totalMaxAngularError = std::max(totalMaxAngularError, maxAngularError);
+	}
+
+	std::cout << "Total: " << totalRawBytes << " -> " << totalCompressedBytes << " bytes (" << (float)totalRawBytes / totalCompressedBytes
+		<< "x), max position error " << totalMaxPositionError << ", max angular error " << totalMaxAngularError << " rad\n";
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "Cubemap.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "Hash.h"
+#include <type_traits>
+
+static constexpr std::uint32_t cubemapMagic = 'C' | 'B' << 8 | 'M' << 16 | 'P' << 24; // "CBMP" at the start of the file
+static constexpr std::uint32_t cubemapVersion = 2;
+
+struct CubemapHeader
+{
+	std::uint32_t magic = cubemapMagic;
+	std::uint32_t version = cubemapVersion;
+	std::uint32_t format;
+	std::uint32_t resolution;
+	std::uint32_t mipCount;
+	std::uint32_t padding = 0;
+	std::uint64_t checksum;
+};
+static_assert(std::is_trivially_copyable_v<CubemapHeader> && std::is_trivially_copyable_v<CubemapFile::Mip>);
+
+// Face directions at s, t in [-1, 1] follow the major axis table in the GL spec
+static glm::vec3 FaceDirection(int face, float s, float t)
+{
+	switch (face)
+	{
+	case 0: return glm::vec3(1.0f, -t, -s);
+	case 1: return glm::vec3(-1.0f, -t, s);
+	case 2: return glm::vec3(s, 1.0f, t);
+	case 3: return glm::vec3(s, -1.0f, -t);
+	case 4: return glm::vec3(s, -t, 1.0f);
+	default: return glm::vec3(-s, -t, -1.0f);
+	}
+}
+
+glm::vec3 CubemapTexelDirection(int face, int x, int y, int resolution)
+{
+	const float s = 2.0f * (x + 0.5f) / resolution - 1.0f;
+	const float t = 2.0f * (y + 0.5f) / resolution - 1.0f;
+	return glm::normalize(FaceDirection(face, s, t));
+}
+
+static float AreaElement(float x, float y)
+{
+	return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f));
+}
+
+float CubemapTexelSolidAngle(int x, int y, int resolution)
+{
+	const float s = 2.0f * (x + 0.5f) / resolution - 1.0f;
+	const float t = 2.0f * (y + 0.5f) / resolution - 1.0f;
+	const float halfTexel = 1.0f / resolution;
+	return AreaElement(s - halfTexel, t - halfTexel) - AreaElement(s - halfTexel, t + halfTexel) -
+		AreaElement(s + halfTexel, t - halfTexel) + AreaElement(s + halfTexel, t + halfTexel);
+}
+
+bool IsCompressed(CubemapFormat format)
+{
+	return format != CubemapFormat::RGBA16F;
+}
+
+std::size_t GetCubemapFaceSize(CubemapFormat format, int resolution)
+{
+	if (IsCompressed(format))
+	{
+		const std::size_t blocks = (resolution + 3) / 4;
+		return blocks * blocks * 16;
+	}
+	return (std::size_t)resolution * resolution * 8;
+}
+
+bool ReadCubemapFile(const std::string& path, CubemapFile& cubemap)
+{
+	cubemap.file = MappedFile(path);
+	const MappedFile& file = cubemap.file;
+	if (!file.IsOpen() || file.Size() < sizeof(CubemapHeader))
+	{
+		return false;
+	}
+
+	CubemapHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+	const std::size_t tableSize = (std::size_t)header.mipCount * sizeof(CubemapFile::Mip);
+	if (header.magic != cubemapMagic || header.version != cubemapVersion || header.format > (std::uint32_t)CubemapFormat::RGBA16F ||
+		header.resolution == 0 || header.mipCount == 0 || header.mipCount > 32 || (1ull << (header.mipCount - 1)) > header.resolution ||
+		file.Size() - sizeof(CubemapHeader) < tableSize)
+	{
+		return false;
+	}
+
+	if (HashBytes(file.Bytes(sizeof(CubemapHeader), file.Size() - sizeof(CubemapHeader))) != header.checksum)
+	{
+		return false;
+	}
+
+	cubemap.format = (CubemapFormat)header.format;
+	cubemap.resolution = (int)header.resolution;
+	cubemap.mips.resize(header.mipCount);
+	std::memcpy(cubemap.mips.data(), file.Data() + sizeof(CubemapHeader), tableSize);
+	for (int i = 0; i < cubemap.mips.size(); i++)
+	{
+		const CubemapFile::Mip& mip = cubemap.mips[i];
+		const int mipResolution = std::max(cubemap.resolution >> i, 1);
+		if (mip.faceSize != GetCubemapFaceSize(cubemap.format, mipResolution) || mip.offset > file.Size() || 6 * mip.faceSize > file.Size() - mip.offset)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool WriteCubemapFile(const std::string& path, CubemapFormat format, int resolution, const std::vector<std::vector<std::uint8_t>>& mips)
+{
+	CubemapHeader header;
+	header.format = (std::uint32_t)format;
+	header.resolution = (std::uint32_t)resolution;
+	header.mipCount = (std::uint32_t)mips.size();
+
+	// The header goes in front of the offset table and pixels once the checksum over them is known
+	std::vector<std::uint8_t> bytes(sizeof(CubemapHeader) + mips.size() * sizeof(CubemapFile::Mip));
+	for (int i = 0; i < mips.size(); i++)
+	{
+		CubemapFile::Mip mip;
+		mip.offset = bytes.size();
+		mip.faceSize = GetCubemapFaceSize(format, std::max(resolution >> i, 1));
+		assert(mips[i].size() == 6 * mip.faceSize);
+		std::memcpy(bytes.data() + sizeof(CubemapHeader) + i * sizeof(mip), &mip, sizeof(mip));
+		bytes.insert(bytes.end(), mips[i].begin(), mips[i].end());
+	}
+	header.checksum = HashBytes(std::span(bytes).subspan(sizeof(CubemapHeader)));
+	std::memcpy(bytes.data(), &header, sizeof(header));
+
+	return WriteFileAtomically(path, bytes);
+}
\ No newline at end of file
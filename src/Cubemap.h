@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "MappedFile.h"
+#include <span>
+#include <string>
+#include <vector>
+
+// .cbmp v2 files: a header, then one entry per mip in the offset table, then the pixels. All 6 faces of a mip are stored
+// back to back starting at the mip's offset. The checksum covers everything after the header.
+enum class CubemapFormat : std::uint32_t
+{
+	BC6H_UFloat,
+	BC6H_SFloat,
+	RGBA16F,
+};
+
+struct CubemapFile
+{
+	struct Mip
+	{
+		std::uint64_t offset;
+		std::uint64_t faceSize;
+	};
+
+	CubemapFormat format;
+	int resolution;
+	std::vector<Mip> mips;
+	MappedFile file;
+
+	// face is 0-5 in GL_TEXTURE_CUBE_MAP_POSITIVE_X order
+	std::span<const std::uint8_t> Face(int mip, int face) const { return file.Bytes(mips[mip].offset + face * mips[mip].faceSize, mips[mip].faceSize); }
+};
+
+// BC6H formats are stored in 4x4 blocks, RGBA16F as plain texels
+bool IsCompressed(CubemapFormat format);
+// Normalized direction through the center of texel x, y (row 0 at t = 0) of a face in GL_TEXTURE_CUBE_MAP_POSITIVE_X order
+glm::vec3 CubemapTexelDirection(int face, int x, int y, int resolution);
+// Solid angle covered by texel x, y of any face, they sum to 4 pi over the whole cubemap
+float CubemapTexelSolidAngle(int x, int y, int resolution);
+std::size_t GetCubemapFaceSize(CubemapFormat format, int resolution);
+
+// Maps the file and validates its header, offset table and checksum
+bool ReadCubemapFile(const std::string& path, CubemapFile& cubemap);
+// mips[i] holds the 6 faces of mip i back to back
+bool WriteCubemapFile(const std::string& path, CubemapFormat format, int resolution, const std::vector<std::vector<std::uint8_t>>& mips);
\ No newline at end of file
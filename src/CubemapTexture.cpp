@@ -0,0 +1,69 @@
+#include "CubemapTexture.h"
+
+#include <algorithm>
+#include <cassert>
+#include "StagingUploader.h"
+
+GLenum GetGLInternalFormat(CubemapFormat format)
+{
+	switch (format)
+	{
+	case CubemapFormat::BC6H_UFloat: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+	case CubemapFormat::BC6H_SFloat: return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+	case CubemapFormat::RGBA16F: return GL_RGBA16F;
+	}
+	assert(false);
+	return GL_NONE;
+}
+
+GLuint CreateStreamedCubemap(const CubemapFile& cubemap, StagingUploader& uploader)
+{
+	const GLenum internalFormat = GetGLInternalFormat(cubemap.format);
+	const int lastMip = (int)cubemap.mips.size() - 1;
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, lastMip + 1, internalFormat, cubemap.resolution, cubemap.resolution);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, lastMip > 0 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, lastMip);
+
+	for (int mip = lastMip; mip >= 0; mip--)
+	{
+		const int mipResolution = std::max(cubemap.resolution >> mip, 1);
+		for (int face = 0; face < 6; face++)
+		{
+			const GLenum imageTarget = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+			const std::span<const std::uint8_t> pixels = cubemap.Face(mip, face);
+			if (mip == lastMip)
+			{
+				// Tiny, and it makes the texture complete before the first frame
+				if (IsCompressed(cubemap.format)) glCompressedTexSubImage2D(imageTarget, mip, 0, 0, mipResolution, mipResolution, internalFormat, (GLsizei)pixels.size(), pixels.data());
+				else glTexSubImage2D(imageTarget, mip, 0, 0, mipResolution, mipResolution, GL_RGBA, GL_HALF_FLOAT, pixels.data());
+			}
+			else if (IsCompressed(cubemap.format))
+			{
+				uploader.UploadCompressedTexture2D(texture, mip, mipResolution, mipResolution, internalFormat, pixels, imageTarget);
+			}
+			else
+			{
+				uploader.UploadTexture2D(texture, mipResolution, mipResolution, GL_RGBA, GL_HALF_FLOAT, 8, pixels, false, mip, imageTarget);
+			}
+		}
+
+		if (mip != lastMip)
+		{
+			uploader.OnUploaded([texture, mip]()
+			{
+				glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, mip);
+			});
+		}
+	}
+
+	return texture;
+}
\ No newline at end of file
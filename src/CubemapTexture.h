@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Cubemap.h"
+#include <glad/glad.h>
+
+class StagingUploader;
+
+// GL side of .cbmp files, only the viewer needs it
+GLenum GetGLInternalFormat(CubemapFormat format);
+// Uploads the smallest mip right away and queues the others on uploader, smallest first. GL_TEXTURE_BASE_LEVEL follows the
+// uploads down, so the cubemap can be sampled immediately at whatever detail has arrived. cubemap must stay alive until
+// the uploader is idle.
+GLuint CreateStreamedCubemap(const CubemapFile& cubemap, StagingUploader& uploader);
\ No newline at end of file
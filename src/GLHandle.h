@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <utility>
+
+// Move-only owner of a single GL object name, deleted when the handle is destroyed or reset. Converts to GLuint so it can
+// be passed straight to GL calls. Must be destroyed on the GL context thread while the context is alive.
+template<typename Traits>
+class GLHandle
+{
+public:
+	GLHandle() = default;
+	explicit GLHandle(GLuint id) : id(id) {}
+	~GLHandle() { Reset(); }
+	GLHandle(const GLHandle&) = delete;
+	GLHandle& operator=(const GLHandle&) = delete;
+	GLHandle(GLHandle&& other) noexcept : id(std::exchange(other.id, 0)) {}
+	GLHandle& operator=(GLHandle&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			id = std::exchange(other.id, 0);
+		}
+		return *this;
+	}
+
+	static GLHandle Create() { return GLHandle(Traits::Create()); }
+
+	GLuint Get() const { return id; }
+	operator GLuint() const { return id; }
+	explicit operator bool() const { return id != 0; }
+
+	void Reset()
+	{
+		if (id) Traits::Delete(id);
+		id = 0;
+	}
+	// Gives up ownership without deleting
+	GLuint Release() { return std::exchange(id, 0); }
+private:
+	GLuint id = 0;
+};
+
+struct GLBufferTraits
+{
+	static GLuint Create() { GLuint id; glGenBuffers(1, &id); return id; }
+	static void Delete(GLuint id) { glDeleteBuffers(1, &id); }
+};
+
+struct GLVertexArrayTraits
+{
+	static GLuint Create() { GLuint id; glGenVertexArrays(1, &id); return id; }
+	static void Delete(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+
+struct GLTextureTraits
+{
+	static GLuint Create() { GLuint id; glGenTextures(1, &id); return id; }
+	static void Delete(GLuint id) { glDeleteTextures(1, &id); }
+};
+
+struct GLFramebufferTraits
+{
+	static GLuint Create() { GLuint id; glGenFramebuffers(1, &id); return id; }
+	static void Delete(GLuint id) { glDeleteFramebuffers(1, &id); }
+};
+
+struct GLProgramTraits
+{
+	static GLuint Create() { return glCreateProgram(); }
+	static void Delete(GLuint id) { glDeleteProgram(id); }
+};
+
+using GLBuffer = GLHandle<GLBufferTraits>;
+using GLVertexArray = GLHandle<GLVertexArrayTraits>;
+using GLTexture = GLHandle<GLTextureTraits>;
+using GLFramebuffer = GLHandle<GLFramebufferTraits>;
+using GLProgram = GLHandle<GLProgramTraits>;
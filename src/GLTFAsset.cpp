@@ -0,0 +1,763 @@
+#include "GLTFAsset.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include "JsonReader.h"
+#include <limits>
+#include <map>
+#include "MeshoptDecoder.h"
+#include <tiny_gltf/stb_image.h>
+#include "ThreadPool.h"
+#include <tiny_gltf/json.hpp>
+
+static constexpr std::uint32_t glbMagic = 0x46546C67; // "glTF"
+static constexpr std::uint32_t glbChunkTypeJSON = 0x4E4F534A;
+static constexpr std::uint32_t glbChunkTypeBIN = 0x004E4942;
+
+static std::uint32_t ReadU32(const std::uint8_t* bytes)
+{
+	std::uint32_t value;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static std::string DecodeURI(const std::string& uri)
+{
+	std::string decoded;
+	decoded.reserve(uri.size());
+	for (std::size_t i = 0; i < uri.size(); i++)
+	{
+		// A malformed escape is kept as it is
+		if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit((unsigned char)uri[i + 1]) && std::isxdigit((unsigned char)uri[i + 2]))
+		{
+			decoded += (char)std::stoi(uri.substr(i + 1, 2), nullptr, 16);
+			i += 2;
+		}
+		else
+		{
+			decoded += uri[i];
+		}
+	}
+	return decoded;
+}
+
+// Splits a GLB container into its JSON and (optional) BIN chunks without copying either of them
+static bool ParseGLB(std::span<const std::uint8_t> file, std::span<const std::uint8_t>& jsonChunk, std::span<const std::uint8_t>& binChunk, std::string* err)
+{
+	constexpr std::size_t headerSize = 12;
+	constexpr std::size_t chunkHeaderSize = 8;
+	if (file.size() < headerSize + chunkHeaderSize || ReadU32(file.data()) != glbMagic)
+	{
+		*err = "Invalid GLB header";
+		return false;
+	}
+
+	const std::size_t length = std::min<std::size_t>(ReadU32(file.data() + 8), file.size());
+	std::size_t offset = headerSize;
+	while (offset + chunkHeaderSize <= length)
+	{
+		const std::uint32_t chunkLength = ReadU32(file.data() + offset);
+		const std::uint32_t chunkType = ReadU32(file.data() + offset + 4);
+		offset += chunkHeaderSize;
+		if (offset + chunkLength > length)
+		{
+			*err = "GLB chunk exceeds file size";
+			return false;
+		}
+
+		if (chunkType == glbChunkTypeJSON && jsonChunk.empty())
+		{
+			jsonChunk = file.subspan(offset, chunkLength);
+		}
+		else if (chunkType == glbChunkTypeBIN && binChunk.empty())
+		{
+			binChunk = file.subspan(offset, chunkLength);
+		}
+		offset += chunkLength;
+	}
+
+	if (jsonChunk.empty())
+	{
+		*err = "GLB is missing its JSON chunk";
+		return false;
+	}
+	return true;
+}
+
+// tinygltf::Value built the way tinygltf builds extras and extensions, nulls and empty arrays and objects are dropped.
+// Anything nested deeper than tinygltf would reasonably need is skipped rather than recursed into.
+static tinygltf::Value ReadValue(JsonReader& reader, int depth = 0)
+{
+	constexpr int maxDepth = 64;
+	switch (reader.Peek())
+	{
+	case JsonReader::Type::Object:
+	{
+		if (depth >= maxDepth) break;
+		tinygltf::Value::Object object;
+		reader.ReadObject([&](std::string_view key)
+		{
+			tinygltf::Value value = ReadValue(reader, depth + 1);
+			if (value.Type() != tinygltf::NULL_TYPE) object.emplace(std::string(key), std::move(value));
+		});
+		return object.empty() ? tinygltf::Value() : tinygltf::Value(std::move(object));
+	}
+	case JsonReader::Type::Array:
+	{
+		if (depth >= maxDepth) break;
+		tinygltf::Value::Array array;
+		reader.ReadArray([&]()
+		{
+			tinygltf::Value value = ReadValue(reader, depth + 1);
+			if (value.Type() != tinygltf::NULL_TYPE) array.push_back(std::move(value));
+		});
+		return array.empty() ? tinygltf::Value() : tinygltf::Value(std::move(array));
+	}
+	case JsonReader::Type::String:
+	{
+		std::string string;
+		reader.ReadString(string);
+		return tinygltf::Value(std::move(string));
+	}
+	case JsonReader::Type::Boolean:
+	{
+		bool boolean = false;
+		reader.ReadBool(boolean);
+		return tinygltf::Value(boolean);
+	}
+	case JsonReader::Type::Number:
+	{
+		double number = 0.0;
+		reader.ReadNumber(number);
+		// Integers past the int range, like the offsets into a multi-GB buffer, stay doubles which hold them exactly
+		const bool fitsInt = number >= std::numeric_limits<int>::min() && number <= std::numeric_limits<int>::max();
+		return reader.LastNumberWasInteger() && fitsInt ? tinygltf::Value((int)number) : tinygltf::Value(number);
+	}
+	default:
+		break;
+	}
+	reader.SkipValue();
+	return tinygltf::Value();
+}
+
+// Only object valued extensions are kept, like tinygltf does
+static void ReadExtensions(JsonReader& reader, tinygltf::ExtensionMap& extensions)
+{
+	if (reader.Peek() != JsonReader::Type::Object)
+	{
+		reader.SkipValue();
+		return;
+	}
+	reader.ReadObject([&](std::string_view key)
+	{
+		if (reader.Peek() != JsonReader::Type::Object)
+		{
+			reader.SkipValue();
+			return;
+		}
+		tinygltf::Value value = ReadValue(reader);
+		extensions[std::string(key)] = value.IsObject() ? std::move(value) : tinygltf::Value(tinygltf::Value::Object());
+	});
+}
+
+template<typename T>
+static void ReadNumberArray(JsonReader& reader, std::vector<T>& values)
+{
+	values.clear();
+	reader.ReadArray([&]()
+	{
+		double value;
+		if (reader.ReadNumber(value)) values.push_back((T)value);
+	});
+}
+
+static std::map<std::string, int> ReadAttributeMap(JsonReader& reader)
+{
+	std::map<std::string, int> attributes;
+	reader.ReadObject([&](std::string_view key)
+	{
+		int accessor;
+		if (reader.ReadInt(accessor)) attributes.emplace(std::string(key), accessor);
+	});
+	return attributes;
+}
+
+// The Read* functions below fill the same fields tinygltf's parsers do, with the same defaults. They return false if a
+// required property is missing or has an invalid value, malformed JSON fails the reader instead.
+static bool ReadBufferView(JsonReader& reader, tinygltf::BufferView& bufferView)
+{
+	bool hasBuffer = false, hasByteLength = false;
+	reader.ReadObject([&](std::string_view key)
+	{
+		if (key == "buffer") hasBuffer = reader.ReadInt(bufferView.buffer);
+		else if (key == "byteOffset") reader.ReadSize(bufferView.byteOffset);
+		else if (key == "byteLength") hasByteLength = reader.ReadSize(bufferView.byteLength);
+		else if (key == "byteStride") reader.ReadSize(bufferView.byteStride);
+		else if (key == "target") reader.ReadInt(bufferView.target);
+		else if (key == "name") reader.ReadString(bufferView.name);
+		else if (key == "extensions") ReadExtensions(reader, bufferView.extensions);
+		else if (key == "extras") bufferView.extras = ReadValue(reader);
+		else reader.SkipValue();
+	});
+
+	if (bufferView.target != TINYGLTF_TARGET_ARRAY_BUFFER && bufferView.target != TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER)
+	{
+		bufferView.target = 0;
+	}
+	return hasBuffer && hasByteLength && bufferView.byteStride <= 252 && bufferView.byteStride % 4 == 0;
+}
+
+static bool ReadSparse(JsonReader& reader, tinygltf::Accessor& accessor)
+{
+	accessor.sparse.isSparse = true;
+	bool hasCount = false, hasIndicesView = false, hasComponentType = false, hasValuesView = false;
+	reader.ReadObject([&](std::string_view key)
+	{
+		if (key == "count")
+		{
+			hasCount = reader.ReadInt(accessor.sparse.count);
+		}
+		else if (key == "indices")
+		{
+			reader.ReadObject([&](std::string_view key)
+			{
+				if (key == "bufferView") hasIndicesView = reader.ReadInt(accessor.sparse.indices.bufferView);
+				else if (key == "byteOffset") reader.ReadInt(accessor.sparse.indices.byteOffset);
+				else if (key == "componentType") hasComponentType = reader.ReadInt(accessor.sparse.indices.componentType);
+				else reader.SkipValue();
+			});
+		}
+		else if (key == "values")
+		{
+			reader.ReadObject([&](std::string_view key)
+			{
+				if (key == "bufferView") hasValuesView = reader.ReadInt(accessor.sparse.values.bufferView);
+				else if (key == "byteOffset") reader.ReadInt(accessor.sparse.values.byteOffset);
+				else reader.SkipValue();
+			});
+		}
+		else
+		{
+			reader.SkipValue();
+		}
+	});
+	return hasCount && hasIndicesView && hasComponentType && hasValuesView;
+}
+
+static bool ReadAccessor(JsonReader& reader, tinygltf::Accessor& accessor)
+{
+	static const std::pair<std::string_view, int> types[] = {
+		{ "SCALAR", TINYGLTF_TYPE_SCALAR }, { "VEC2", TINYGLTF_TYPE_VEC2 }, { "VEC3", TINYGLTF_TYPE_VEC3 }, { "VEC4", TINYGLTF_TYPE_VEC4 },
+		{ "MAT2", TINYGLTF_TYPE_MAT2 }, { "MAT3", TINYGLTF_TYPE_MAT3 }, { "MAT4", TINYGLTF_TYPE_MAT4 } };
+
+	bool hasComponentType = false, hasCount = false, hasType = false, validSparse = true;
+	std::string type;
+	reader.ReadObject([&](std::string_view key)
+	{
+		if (key == "bufferView") reader.ReadInt(accessor.bufferView);
+		else if (key == "byteOffset") reader.ReadSize(accessor.byteOffset);
+		else if (key == "normalized") reader.ReadBool(accessor.normalized);
+		else if (key == "componentType") hasComponentType = reader.ReadInt(accessor.componentType);
+		else if (key == "count") hasCount = reader.ReadSize(accessor.count);
+		else if (key == "type") hasType = reader.ReadString(type);
+		else if (key == "name") reader.ReadString(accessor.name);
+		else if (key == "min") ReadNumberArray(reader, accessor.minValues);
+		else if (key == "max") ReadNumberArray(reader, accessor.maxValues);
+		else if (key == "sparse") validSparse = ReadSparse(reader, accessor);
+		else if (key == "extensions") ReadExtensions(reader, accessor.extensions);
+		else if (key == "extras") accessor.extras = ReadValue(reader);
+		else reader.SkipValue();
+	});
+
+	auto typeIter = std::find_if(std::begin(types), std::end(types), [&](const auto& entry) { return entry.first == type; });
+	if (!hasType || typeIter == std::end(types))
+	{
+		return false;
+	}
+	accessor.type = typeIter->second;
+	return hasComponentType && hasCount && validSparse &&
+		accessor.componentType >= TINYGLTF_COMPONENT_TYPE_BYTE && accessor.componentType <= TINYGLTF_COMPONENT_TYPE_DOUBLE;
+}
+
+static bool ReadPrimitive(JsonReader& reader, tinygltf::Primitive& primitive)
+{
+	bool hasAttributes = false;
+	primitive.mode = TINYGLTF_MODE_TRIANGLES;
+	reader.ReadObject([&](std::string_view key)
+	{
+		if (key == "attributes")
+		{
+			primitive.attributes = ReadAttributeMap(reader);
+			hasAttributes = true;
+		}
+		else if (key == "indices") reader.ReadInt(primitive.indices);
+		else if (key == "material") reader.ReadInt(primitive.material);
+		else if (key == "mode") reader.ReadInt(primitive.mode);
+		else if (key == "targets") reader.ReadArray([&]() { primitive.targets.push_back(ReadAttributeMap(reader)); });
+		else if (key == "extensions") ReadExtensions(reader, primitive.extensions);
+		else if (key == "extras") primitive.extras = ReadValue(reader);
+		else reader.SkipValue();
+	});
+	return hasAttributes;
+}
+
+static bool ReadMesh(JsonReader& reader, tinygltf::Mesh& mesh)
+{
+	reader.ReadObject([&](std::string_view key)
+	{
+		if (key == "primitives")
+		{
+			// Like tinygltf, primitives without attributes are dropped rather than failing the mesh
+			reader.ReadArray([&]()
+			{
+				if (!ReadPrimitive(reader, mesh.primitives.emplace_back())) mesh.primitives.pop_back();
+			});
+		}
+		else if (key == "name") reader.ReadString(mesh.name);
+		else if (key == "weights") ReadNumberArray(reader, mesh.weights);
+		else if (key == "extensions") ReadExtensions(reader, mesh.extensions);
+		else if (key == "extras") mesh.extras = ReadValue(reader);
+		else reader.SkipValue();
+	});
+	return true;
+}
+
+static bool ReadNode(JsonReader& reader, tinygltf::Node& node)
+{
+	reader.ReadObject([&](std::string_view key)
+	{
+		if (key == "name") reader.ReadString(node.name);
+		else if (key == "mesh") reader.ReadInt(node.mesh);
+		else if (key == "children") ReadNumberArray(reader, node.children);
+		else if (key == "matrix") ReadNumberArray(reader, node.matrix);
+		else if (key == "translation") ReadNumberArray(reader, node.translation);
+		else if (key == "rotation") ReadNumberArray(reader, node.rotation);
+		else if (key == "scale") ReadNumberArray(reader, node.scale);
+		else if (key == "skin") reader.ReadInt(node.skin);
+		else if (key == "camera") reader.ReadInt(node.camera);
+		else if (key == "weights") ReadNumberArray(reader, node.weights);
+		else if (key == "extensions") ReadExtensions(reader, node.extensions);
+		else if (key == "extras") node.extras = ReadValue(reader);
+		else reader.SkipValue();
+	});
+
+	// The matrix wins over T/R/S, they're mutually exclusive
+	if (!node.matrix.empty())
+	{
+		node.translation.clear();
+		node.rotation.clear();
+		node.scale.clear();
+	}
+	return true;
+}
+
+// The sections that can have hundreds of thousands of entries, read straight into tinygltf's structs in one pass over the
+// JSON text. Everything else is small and still goes through a DOM and tinygltf, so it's kept as raw text.
+struct StreamedSections
+{
+	std::vector<tinygltf::BufferView> bufferViews;
+	std::vector<tinygltf::Accessor> accessors;
+	std::vector<tinygltf::Mesh> meshes;
+	std::vector<tinygltf::Node> nodes;
+	std::string rest; // a JSON object with the document's other members
+};
+
+static bool StreamSections(std::string_view json, StreamedSections& sections, std::string* err)
+{
+	JsonReader reader(json);
+	std::string invalidElement;
+	auto readSection = [&](auto& elements, bool (*readElement)(JsonReader&, typename std::remove_reference_t<decltype(elements)>::value_type&), const char* name)
+	{
+		reader.ReadArray([&]()
+		{
+			if (!readElement(reader, elements.emplace_back()) && invalidElement.empty())
+			{
+				invalidElement = std::string(name) + "[" + std::to_string(elements.size() - 1) + "]";
+			}
+		});
+	};
+
+	sections.rest = "{";
+	reader.ReadObject([&](std::string_view key)
+	{
+		if (key == "bufferViews") readSection(sections.bufferViews, ReadBufferView, "bufferViews");
+		else if (key == "accessors") readSection(sections.accessors, ReadAccessor, "accessors");
+		else if (key == "meshes") readSection(sections.meshes, ReadMesh, "meshes");
+		else if (key == "nodes") readSection(sections.nodes, ReadNode, "nodes");
+		else
+		{
+			if (sections.rest.size() > 1) sections.rest += ',';
+			sections.rest += nlohmann::json(key).dump();
+			sections.rest += ':';
+			sections.rest += reader.SkipValue();
+		}
+	});
+	sections.rest += '}';
+	reader.ReadEnd();
+
+	if (reader.Failed())
+	{
+		*err = "Failed to parse glTF JSON: " + reader.Error();
+		return false;
+	}
+	if (!invalidElement.empty())
+	{
+		*err = "glTF " + invalidElement + " is missing a required property or has an invalid one";
+		return false;
+	}
+	return true;
+}
+
+// tinygltf checked these when it parsed the streamed sections itself
+static bool ValidateStreamedReferences(const tinygltf::Model& model, std::string* err)
+{
+	auto validBufferView = [&](int bufferView) { return bufferView >= 0 && bufferView < (int)model.bufferViews.size(); };
+	auto validAccessor = [&](int accessor) { return accessor >= 0 && accessor < (int)model.accessors.size(); };
+
+	for (int i = 0; i < (int)model.accessors.size(); i++)
+	{
+		const tinygltf::Accessor& accessor = model.accessors[i];
+		if ((accessor.bufferView != -1 && !validBufferView(accessor.bufferView)) ||
+			(accessor.sparse.isSparse && (!validBufferView(accessor.sparse.indices.bufferView) || !validBufferView(accessor.sparse.values.bufferView))))
+		{
+			*err = "Accessor " + std::to_string(i) + " references a missing buffer view";
+			return false;
+		}
+	}
+
+	for (const tinygltf::Mesh& mesh : model.meshes)
+	{
+		for (const tinygltf::Primitive& primitive : mesh.primitives)
+		{
+			bool valid = primitive.indices == -1 || validAccessor(primitive.indices);
+			for (const auto& [name, accessor] : primitive.attributes) valid = valid && validAccessor(accessor);
+			for (const auto& target : primitive.targets)
+			{
+				for (const auto& [name, accessor] : target) valid = valid && validAccessor(accessor);
+			}
+			if (!valid)
+			{
+				*err = "Mesh " + mesh.name + " references a missing accessor";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Where an EXT_meshopt_compression buffer view's compressed bytes are and what they decode to
+struct MeshoptBufferView
+{
+	int bufferView;
+	int buffer;
+	std::size_t byteOffset;
+	std::size_t byteLength;
+	std::size_t byteStride;
+	std::size_t count;
+	MeshoptMode mode;
+	MeshoptFilter filter = MeshoptFilter::None;
+};
+
+static const nlohmann::json* FindMeshoptExtension(const nlohmann::json& object)
+{
+	auto extensions = object.find("extensions");
+	if (extensions == object.end() || !extensions->is_object()) return nullptr;
+	auto extension = extensions->find("EXT_meshopt_compression");
+	return extension != extensions->end() && extension->is_object() ? &*extension : nullptr;
+}
+
+static bool ParseMeshoptBufferViews(const std::vector<tinygltf::BufferView>& bufferViews, const GLTFAsset& asset, std::vector<MeshoptBufferView>& views,
+	std::string* err)
+{
+	for (int i = 0; i < (int)bufferViews.size(); i++)
+	{
+		auto extensionIter = bufferViews[i].extensions.find("EXT_meshopt_compression");
+		if (extensionIter == bufferViews[i].extensions.end()) continue;
+		const tinygltf::Value& extension = extensionIter->second;
+
+		auto number = [&](const char* key, double fallback)
+		{
+			return extension.Has(key) && extension.Get(key).IsNumber() ? extension.Get(key).GetNumberAsDouble() : fallback;
+		};
+		auto string = [&](const char* key, const char* fallback)
+		{
+			return extension.Has(key) && extension.Get(key).IsString() ? extension.Get(key).Get<std::string>() : std::string(fallback);
+		};
+
+		MeshoptBufferView& view = views.emplace_back();
+		view.bufferView = i;
+		view.buffer = (int)number("buffer", -1);
+		view.byteOffset = (std::size_t)number("byteOffset", 0);
+		view.byteLength = (std::size_t)number("byteLength", 0);
+		view.byteStride = (std::size_t)number("byteStride", 0);
+		view.count = (std::size_t)number("count", 0);
+		if (!ParseMeshoptMode(string("mode", ""), view.mode) || !ParseMeshoptFilter(string("filter", "NONE"), view.filter))
+		{
+			*err = "Buffer view " + std::to_string(i) + " has an unknown EXT_meshopt_compression mode or filter";
+			return false;
+		}
+		if (view.buffer < 0 || view.buffer >= (int)asset.buffers.size() || view.byteOffset + view.byteLength > asset.buffers[view.buffer].size())
+		{
+			*err = "Buffer view " + std::to_string(i) + " has out of range EXT_meshopt_compression data";
+			return false;
+		}
+	}
+	return true;
+}
+
+std::span<const std::uint8_t> GLTFAsset::BufferViewBytes(int bufferViewIdx) const
+{
+	if (!decodedBufferViews[bufferViewIdx].empty())
+	{
+		return decodedBufferViews[bufferViewIdx];
+	}
+	const tinygltf::BufferView& bufferView = model.bufferViews[bufferViewIdx];
+	return buffers[bufferView.buffer].subspan(bufferView.byteOffset, bufferView.byteLength);
+}
+
+GLTFAsset::~GLTFAsset()
+{
+	for (const std::shared_future<DecodedImage>& decode : imageDecodes)
+	{
+		decode.wait();
+	}
+}
+
+bool LoadGLTFAsset(const std::string& path, GLTFAsset& asset, std::string* err, std::string* warn)
+{
+	namespace fs = std::filesystem;
+
+	asset.path = path;
+	asset.baseDir = fs::path(path).parent_path().string();
+
+	std::span<const std::uint8_t> fileBytes;
+	{
+		const MappedFile& file = asset.mappedFiles.emplace_back(path);
+		if (!file.IsOpen())
+		{
+			*err = "Failed to open " + path;
+			return false;
+		}
+		fileBytes = file.Bytes();
+	}
+
+	const bool isBinary = fileBytes.size() >= 4 && ReadU32(fileBytes.data()) == glbMagic;
+	std::span<const std::uint8_t> jsonBytes = fileBytes;
+	std::span<const std::uint8_t> binChunk;
+	if (isBinary && !ParseGLB(fileBytes, jsonBytes, binChunk, err))
+	{
+		return false;
+	}
+
+	StreamedSections sections;
+	if (!StreamSections({ (const char*)jsonBytes.data(), jsonBytes.size() }, sections, err))
+	{
+		*err += " in " + path;
+		return false;
+	}
+
+	nlohmann::json document = nlohmann::json::parse(sections.rest, nullptr, false);
+	if (document.is_discarded() || !document.is_object())
+	{
+		*err = "Failed to parse glTF JSON in " + path;
+		return false;
+	}
+
+	// Resolve buffers ourselves and hide them from tinygltf, which would otherwise read each one into a std::vector
+	auto buffersIter = document.find("buffers");
+	if (buffersIter != document.end())
+	{
+		for (const nlohmann::json& bufferJson : *buffersIter)
+		{
+			const std::size_t byteLength = bufferJson.value("byteLength", (std::size_t)0);
+			const std::string uri = bufferJson.value("uri", std::string());
+			const nlohmann::json* meshoptExtension = FindMeshoptExtension(bufferJson);
+			if (meshoptExtension && meshoptExtension->value("fallback", false))
+			{
+				// Only there for loaders without EXT_meshopt_compression, every view into it is decoded instead
+				asset.buffers.emplace_back();
+			}
+			else if (uri.empty())
+			{
+				if (!isBinary || binChunk.size() < byteLength)
+				{
+					*err = "Buffer without uri doesn't fit in the GLB BIN chunk";
+					return false;
+				}
+				asset.buffers.push_back(binChunk.first(byteLength));
+			}
+			else if (tinygltf::IsDataURI(uri))
+			{
+				std::string mimeType;
+				std::vector<std::uint8_t>& decoded = asset.ownedBuffers.emplace_back();
+				if (!tinygltf::DecodeDataURI(&decoded, mimeType, uri, byteLength, true))
+				{
+					*err = "Failed to decode data URI buffer";
+					return false;
+				}
+				asset.buffers.emplace_back(decoded.data(), decoded.size());
+			}
+			else
+			{
+				const std::string bufferPath = (fs::path(asset.baseDir) / DecodeURI(uri)).string();
+				const MappedFile& bufferFile = asset.mappedFiles.emplace_back(bufferPath);
+				if (!bufferFile.IsOpen() || bufferFile.Size() < byteLength)
+				{
+					*err = "Failed to map buffer " + bufferPath;
+					return false;
+				}
+				asset.buffers.push_back(bufferFile.Bytes(0, byteLength));
+			}
+		}
+		document.erase(buffersIter);
+	}
+
+	// Images can live in buffer views, which tinygltf can no longer see, so they're decoded here too. model.images only gets
+	// the metadata, the pixels come from asset.imageDecodes.
+	std::vector<tinygltf::Image> images;
+	auto imagesIter = document.find("images");
+	if (imagesIter != document.end())
+	{
+		int imageIdx = 0;
+		for (const nlohmann::json& imageJson : *imagesIter)
+		{
+			tinygltf::Image& image = images.emplace_back();
+			image.name = imageJson.value("name", std::string());
+			image.mimeType = imageJson.value("mimeType", std::string());
+			image.uri = imageJson.value("uri", std::string());
+			image.bufferView = imageJson.value("bufferView", -1);
+
+			std::span<const std::uint8_t> encoded;
+			std::vector<std::uint8_t> decodedURI;
+			MappedFile imageFile;
+			if (image.bufferView >= 0)
+			{
+				if (image.bufferView >= (int)sections.bufferViews.size())
+				{
+					*err = "Image " + std::to_string(imageIdx) + " references a missing buffer view";
+					return false;
+				}
+				const tinygltf::BufferView& bufferView = sections.bufferViews[image.bufferView];
+				if (bufferView.buffer < 0 || bufferView.buffer >= (int)asset.buffers.size() ||
+					bufferView.byteOffset + bufferView.byteLength > asset.buffers[bufferView.buffer].size())
+				{
+					*err = "Image " + std::to_string(imageIdx) + " has an out of range buffer view";
+					return false;
+				}
+				encoded = asset.buffers[bufferView.buffer].subspan(bufferView.byteOffset, bufferView.byteLength);
+			}
+			else if (tinygltf::IsDataURI(image.uri))
+			{
+				if (!tinygltf::DecodeDataURI(&decodedURI, image.mimeType, image.uri, 0, false))
+				{
+					*err = "Failed to decode data URI image " + std::to_string(imageIdx);
+					return false;
+				}
+				encoded = decodedURI;
+			}
+			else
+			{
+				const std::string imagePath = (fs::path(asset.baseDir) / DecodeURI(image.uri)).string();
+				imageFile = MappedFile(imagePath);
+				if (!imageFile.IsOpen())
+				{
+					*err = "Failed to map image " + imagePath;
+					return false;
+				}
+				encoded = imageFile.Bytes();
+			}
+
+			// Only the header is read here, for the metadata materials look at. Pixels are decoded on the thread pool.
+			int channels;
+			if (!stbi_info_from_memory(encoded.data(), (int)encoded.size(), &image.width, &image.height, &channels))
+			{
+				*err = "Unsupported format for image " + std::to_string(imageIdx);
+				return false;
+			}
+			const bool is16Bit = stbi_is_16_bit_from_memory(encoded.data(), (int)encoded.size());
+			image.component = 4; // LoadImageData always expands to RGBA unless asked to preserve channels
+			image.bits = is16Bit ? 16 : 8;
+			image.pixel_type = is16Bit ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+
+			// The task owns whatever keeps the encoded bytes alive, except for buffer views, which the asset's destructor waits for
+			auto decode = [imageIdx, image, encoded, decodedURI = std::move(decodedURI), imageFile = std::move(imageFile)]()
+			{
+				std::span<const std::uint8_t> bytes = encoded;
+				if (!decodedURI.empty()) bytes = decodedURI;
+				else if (imageFile.IsOpen()) bytes = imageFile.Bytes();
+
+				DecodedImage decoded;
+				decoded.image = image;
+				std::string decodeWarn;
+				if (!tinygltf::LoadImageData(&decoded.image, imageIdx, &decoded.error, &decodeWarn, 0, 0, bytes.data(), (int)bytes.size(), nullptr) && decoded.error.empty())
+				{
+					decoded.error = "Failed to decode image " + std::to_string(imageIdx);
+				}
+				return decoded;
+			};
+			asset.imageDecodes.push_back(ThreadPool::Get().Submit(std::move(decode)).share());
+			imageIdx++;
+		}
+		document.erase(imagesIter);
+	}
+
+	std::vector<MeshoptBufferView> meshoptViews;
+	if (!ParseMeshoptBufferViews(sections.bufferViews, asset, meshoptViews, err))
+	{
+		return false;
+	}
+
+	const std::string json = document.dump();
+	tinygltf::TinyGLTF loader;
+	if (!loader.LoadASCIIFromString(&asset.model, err, warn, json.c_str(), (unsigned int)json.size(), asset.baseDir))
+	{
+		return false;
+	}
+	asset.model.images = std::move(images);
+	asset.model.bufferViews = std::move(sections.bufferViews);
+	asset.model.accessors = std::move(sections.accessors);
+	asset.model.meshes = std::move(sections.meshes);
+	asset.model.nodes = std::move(sections.nodes);
+	if (!ValidateStreamedReferences(asset.model, err))
+	{
+		return false;
+	}
+
+	// Compressed views have to decode to exactly byteLength bytes instead, their buffer is usually an empty fallback
+	std::vector<bool> compressed(asset.model.bufferViews.size(), false);
+	for (const MeshoptBufferView& view : meshoptViews) compressed[view.bufferView] = true;
+	for (int i = 0; i < (int)asset.model.bufferViews.size(); i++)
+	{
+		const tinygltf::BufferView& bufferView = asset.model.bufferViews[i];
+		if (!compressed[i] && (bufferView.buffer < 0 || bufferView.buffer >= (int)asset.buffers.size() ||
+			bufferView.byteOffset + bufferView.byteLength > asset.buffers[bufferView.buffer].size()))
+		{
+			*err = "Buffer view out of range of its buffer";
+			return false;
+		}
+	}
+
+	// One task per view, the decoders are single threaded
+	asset.decodedBufferViews.resize(asset.model.bufferViews.size());
+	std::vector<std::uint8_t> decoded(meshoptViews.size(), false);
+	ThreadPool::Get().ParallelFor((int)meshoptViews.size(), [&](int i)
+	{
+		const MeshoptBufferView& view = meshoptViews[i];
+		std::vector<std::uint8_t>& destination = asset.decodedBufferViews[view.bufferView];
+		destination.resize(view.count * view.byteStride);
+		decoded[i] = asset.model.bufferViews[view.bufferView].byteLength == destination.size() &&
+			DecodeMeshoptBufferView(destination, view.count, view.byteStride, view.mode, view.filter, asset.buffers[view.buffer].subspan(view.byteOffset, view.byteLength));
+	});
+	for (int i = 0; i < (int)meshoptViews.size(); i++)
+	{
+		if (!decoded[i])
+		{
+			*err = "Failed to decode EXT_meshopt_compression buffer view " + std::to_string(meshoptViews[i].bufferView);
+			return false;
+		}
+	}
+
+	return true;
+}
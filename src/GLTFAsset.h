@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include "MappedFile.h"
+#include <span>
+#include <string>
+#include <tiny_gltf/tiny_gltf.h>
+#include <vector>
+
+struct DecodedImage
+{
+	tinygltf::Image image;
+	std::string error; // empty if decoding succeeded
+};
+
+// A loaded .gltf/.glb file. The bufferViews, accessors, meshes and nodes sections, the ones that get huge in CAD exports,
+// are streamed straight into the model without a JSON DOM, tinygltf only parses the rest. The model's buffers are left
+// empty and their contents are views into the memory mapped .glb/.bin files instead, so accessor data is not copied (or
+// even paged in) until it's used. Images are decoded straight from the mapped bytes as well, on the thread pool, while the
+// rest of the scene is being built. EXT_meshopt_compression buffer views are the exception, they're decoded up front into
+// decodedBufferViews.
+struct GLTFAsset
+{
+	GLTFAsset() = default;
+	GLTFAsset(const GLTFAsset&) = delete;
+	GLTFAsset& operator=(const GLTFAsset&) = delete;
+	~GLTFAsset(); // Decodes may still be reading from mappedFiles
+
+	// Blocks until that image, and only that image, is decoded
+	const DecodedImage& WaitForImage(int imageIdx) const { return imageDecodes[imageIdx].get(); }
+	// All of the buffer view's bytes, decoded if it was compressed
+	std::span<const std::uint8_t> BufferViewBytes(int bufferViewIdx) const;
+
+	tinygltf::Model model;
+	std::vector<std::span<const std::uint8_t>> buffers; // parallel to the glTF buffers array
+	std::vector<MappedFile> mappedFiles;
+	std::vector<std::vector<std::uint8_t>> ownedBuffers; // only used for data URI buffers, which have to be decoded
+	std::vector<std::vector<std::uint8_t>> decodedBufferViews; // parallel to model.bufferViews, empty unless compressed
+	std::vector<std::shared_future<DecodedImage>> imageDecodes; // parallel to model.images, which only has the metadata
+	std::string path;
+	std::string baseDir;
+};
+
+bool LoadGLTFAsset(const std::string& path, GLTFAsset& asset, std::string* err, std::string* warn);
@@ -1,97 +1,66 @@
 #include "GLTFHelpers.h"
 
+#include <cstring>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 
-std::vector<std::uint8_t> GetAccessorBytes(const tinygltf::Accessor& accessor, const tinygltf::Model& model)
+static std::uint32_t ReadIndex(const std::uint8_t* ptr, int componentType)
 {
-	int accessorTypeSize = GetAccessorTypeSizeInBytes(accessor);
-	int numBytes = GetAccessorTypeSizeInBytes(accessor) * accessor.count;
-
-	std::vector<std::uint8_t> data(numBytes);
-
-	// Could be missing for sparse accessors
-	if (accessor.bufferView < 0)
+	switch (componentType)
 	{
-		std::memset(&data[0], 0, numBytes);
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		return *ptr;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		return *reinterpret_cast<const std::uint16_t*>(ptr);
+	default:
+		assert(componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
+		return *reinterpret_cast<const std::uint32_t*>(ptr);
 	}
-	else
-	{
-		const auto& bv = model.bufferViews[accessor.bufferView];
-		const auto& buffer = model.buffers[bv.buffer];
+}
 
-		const std::uint8_t* gltfBufferPtr = buffer.data.data() + accessor.byteOffset + bv.byteOffset;
-		const int stride = accessor.ByteStride(bv);
+AccessorView::AccessorView(const tinygltf::Accessor& accessor, const GLTFAsset& asset)
+	:elementSize(GetAccessorTypeSizeInBytes(accessor)), count((int)accessor.count)
+{
+	const tinygltf::Model& model = asset.model;
 
-		std::uint8_t* dataPtr = &data[0];
+	if (accessor.bufferView >= 0)
+	{
+		const auto& bv = model.bufferViews[accessor.bufferView];
+		data = asset.BufferViewBytes(accessor.bufferView).data() + accessor.byteOffset;
+		stride = accessor.ByteStride(bv);
+		assert(stride > 0);
 
-		if (stride == accessorTypeSize || stride == 0) // tightly packed, simple copy
+		if (!accessor.sparse.isSparse)
 		{
-			std::memcpy(&data[0], gltfBufferPtr, numBytes);
+			return;
 		}
-		else
+	}
+
+	// Sparse (or bufferView-less, which means all zeros) accessors are the only ones that get copied
+	storage.resize((std::size_t)elementSize * count);
+	if (data != nullptr)
+	{
+		for (int i = 0; i < count; i++)
 		{
-			for (int i = 0; i < accessor.count; i++)
-			{
-				std::memcpy(dataPtr, gltfBufferPtr, accessorTypeSize);
-				gltfBufferPtr += stride;
-				dataPtr += accessorTypeSize;
-			}
+			std::memcpy(&storage[(std::size_t)i * elementSize], (*this)[i], elementSize);
 		}
-
 	}
+	data = storage.data();
+	stride = elementSize;
 
 	if (accessor.sparse.isSparse)
 	{
-		const auto& valuesBufferView = model.bufferViews[accessor.sparse.values.bufferView];
-		const auto& valuesBuffer = model.buffers[valuesBufferView.buffer];
-		std::span<std::uint8_t> sparseValues((std::uint8_t*)(valuesBuffer.data.data() + accessor.sparse.values.byteOffset + valuesBufferView.byteOffset), 
-												accessor.sparse.count);
+		const std::uint8_t* indicesPtr = asset.BufferViewBytes(accessor.sparse.indices.bufferView).data() + accessor.sparse.indices.byteOffset;
+		const int indexSize = tinygltf::GetComponentSizeInBytes(accessor.sparse.indices.componentType);
 
-		const auto& indicesBufferView = model.bufferViews[accessor.sparse.indices.bufferView];
-		const auto& indicesBuffer = model.buffers[indicesBufferView.buffer];
-		std::vector<std::uint32_t> sparseIndices(accessor.sparse.count);
+		const std::uint8_t* valuesPtr = asset.BufferViewBytes(accessor.sparse.values.bufferView).data() + accessor.sparse.values.byteOffset;
 
-		if (accessor.sparse.indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-		{
-			std::span<std::uint8_t> indices((std::uint8_t*)(indicesBuffer.data.data() + accessor.sparse.indices.byteOffset + indicesBufferView.byteOffset),
-				accessor.sparse.count);
-			std::transform(indices.begin(), indices.end(), sparseIndices.begin(),
-				[](std::uint8_t index)
-				{
-					return (std::uint32_t)index;
-				});
-		}
-		else if (accessor.sparse.indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-		{
-			std::span<std::uint16_t> indices((std::uint16_t*)(indicesBuffer.data.data() + accessor.sparse.indices.byteOffset + indicesBufferView.byteOffset),
-				accessor.sparse.count);
-			std::transform(indices.begin(), indices.end(), sparseIndices.begin(),
-				[](std::uint16_t index)
-				{
-					return (std::uint32_t)index;
-				});
-		}
-		else
-		{
-			assert(accessor.sparse.indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
-
-			std::span<std::uint32_t> indices((std::uint32_t*)(indicesBuffer.data.data() + accessor.sparse.indices.byteOffset + indicesBufferView.byteOffset),
-				accessor.sparse.count);
-			std::copy(indices.begin(), indices.end(), sparseIndices.begin());
-		}
-
-		const std::uint8_t* sparseValuesPtr = &sparseValues[0];
 		for (int i = 0; i < accessor.sparse.count; i++)
 		{
-			int dataByteIndex = sparseIndices[i];
-			std::uint8_t* dataPtr = &data[dataByteIndex * accessorTypeSize];
-			std::memcpy(dataPtr, sparseValuesPtr, accessorTypeSize);
-			sparseValuesPtr += accessorTypeSize;
+			std::uint32_t index = ReadIndex(indicesPtr + i * indexSize, accessor.sparse.indices.componentType);
+			assert(index < (std::uint32_t)count);
+			std::memcpy(&storage[(std::size_t)index * elementSize], valuesPtr, elementSize);
+			valuesPtr += elementSize;
 		}
-
-		return data;
 	}
-
-	return data;
-}
\ No newline at end of file
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <cstdint>
+#include "GLTFAsset.h"
 #include <glm/gtc/quaternion.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
@@ -16,4 +18,47 @@ inline int GetAccessorTypeSizeInBytes(const tinygltf::Accessor& accessor)
 	return tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
 }
 
-std::vector<std::uint8_t> GetAccessorBytes(const tinygltf::Accessor& accessor, const tinygltf::Model& model);
+// Strided view of an accessor's elements. Points straight into the (memory mapped) glTF buffer, so interleaved and
+// packed accessors alike are read in place. Only sparse accessors, and accessors without a buffer view, are densified
+// into storage owned by the view.
+struct AccessorView
+{
+	AccessorView(const tinygltf::Accessor& accessor, const GLTFAsset& asset);
+
+	const std::uint8_t* data = nullptr;
+	int stride = 0;
+	int elementSize = 0;
+	int count = 0;
+
+	const std::uint8_t* operator[](int i) const { return data + (std::size_t)i * stride; }
+
+	template<typename T>
+	const T& Get(int i) const
+	{
+		assert((int)sizeof(T) <= elementSize);
+		return *reinterpret_cast<const T*>((*this)[i]);
+	}
+
+	bool IsTightlyPacked() const { return stride == elementSize; }
+
+	// Only valid for tightly packed views
+	std::span<const std::uint8_t> Bytes() const
+	{
+		assert(IsTightlyPacked());
+		return { data, (std::size_t)elementSize * count };
+	}
+
+	// Contiguous copy of the elements, for consumers that keep the data around after the asset is released
+	template<typename T>
+	std::vector<T> ToVector() const
+	{
+		std::vector<T> elements(count);
+		for (int i = 0; i < count; i++)
+		{
+			elements[i] = Get<T>(i);
+		}
+		return elements;
+	}
+private:
+	std::vector<std::uint8_t> storage;
+};
@@ -1,8 +1,12 @@
 #include "GLTFResources.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <glad/glad.h>
 #include <string>
+#include "GeometryCache.h"
+#include "ThreadPool.h"
 #include <tuple>
 #include <vector>
 
@@ -22,7 +26,7 @@ static std::vector<std::string> GetShaderDefines(VertexAttribute flags, bool fla
 	{
 		defines.emplace_back("HAS_JOINTS");
 	}
-	if (HasFlag(flags, VertexAttribute::MORPH_TARGET0_POSITION))
+	if (HasFlag(flags, VertexAttribute::MORPH_VERTEX))
 	{
 		defines.emplace_back("HAS_MORPH_TARGETS");
 	}
@@ -38,6 +42,10 @@ static std::vector<std::string> GetShaderDefines(VertexAttribute flags, bool fla
 	{
 		defines.emplace_back("HAS_VERTEX_COLORS");
 	}
+	if (HasFlag(flags, VertexAttribute::COMPACT))
+	{
+		defines.emplace_back("COMPACT_VERTICES");
+	}
 
 
 	return defines;
@@ -56,20 +64,167 @@ static bool IsLinearSpaceTexture(int textureIdx, const std::vector<tinygltf::Mat
 			return true;
 		}
 	}
-	assert(false && "Should not be here");
-	return false;
+	return false; // no material uses it, so nothing says it isn't color
+}
+
+// Picks a block format from how materials use the texture. Textures with more than one role keep every channel (BC7).
+static BlockFormat GetTextureBlockFormat(int textureIdx, const tinygltf::Model& model)
+{
+	bool color = false, normal = false, occlusion = false, metallicRoughness = false;
+	for (const tinygltf::Material& material : model.materials)
+	{
+		color |= textureIdx == material.pbrMetallicRoughness.baseColorTexture.index || textureIdx == material.emissiveTexture.index;
+		normal |= textureIdx == material.normalTexture.index;
+		occlusion |= textureIdx == material.occlusionTexture.index;
+		metallicRoughness |= textureIdx == material.pbrMetallicRoughness.metallicRoughnessTexture.index;
+	}
+
+	const int roles = color + normal + occlusion + metallicRoughness;
+	if (roles == 1 && normal) return BlockFormat::BC5;
+	if (roles == 1 && occlusion) return BlockFormat::BC4;
+	return IsLinearSpaceTexture(textureIdx, model.materials) ? BlockFormat::BC7 : BlockFormat::BC7_SRGB;
+}
+
+// Each set of options gets its own cache so switching between them doesn't keep rebuilding
+static std::string GetGeometryCachePath(const GLTFAsset& asset, const MeshBuildOptions& options)
+{
+	std::string path = asset.path;
+	if (options.compactVertices) path += ".compact";
+	if (!options.splitForShortIndices) path += ".unsplit";
+	if (!options.weldVertices) path += ".unwelded";
+	if (!options.optimizeIndices) path += ".unoptimized";
+	if (options.tangentGenerator == TangentGenerator::Fast) path += ".fasttangents";
+	return path + ".gvcache";
+}
+
+static void BuildMeshData(const GLTFAsset& asset, GLTFResourceData& data, std::atomic<int>* itemsBuilt, const std::atomic<bool>* cancelled,
+	const MeshBuildOptions& options)
+{
+	const tinygltf::Model& model = asset.model;
+
+	const std::string cachePath = GetGeometryCachePath(asset, options);
+	const std::uint64_t sourceHash = HashAssetSources(asset);
+	if (ReadGeometryCache(cachePath, sourceHash, data.geometryCache, data.meshes))
+	{
+		if (itemsBuilt)
+		{
+			for (const tinygltf::Mesh& mesh : model.meshes) (*itemsBuilt) += mesh.primitives.size();
+		}
+		return;
+	}
+
+	// Build every primitive on the thread pool, one task each, so a few huge meshes don't serialize on their primitives.
+	// A primitive can turn into several submeshes when it's split.
+	std::vector<std::pair<int, int>> primitiveTasks; // (mesh, primitive)
+	for (int meshIdx = 0; meshIdx < model.meshes.size(); meshIdx++)
+	{
+		for (int primitiveIdx = 0; primitiveIdx < model.meshes[meshIdx].primitives.size(); primitiveIdx++)
+		{
+			primitiveTasks.emplace_back(meshIdx, primitiveIdx);
+		}
+	}
+
+	// Shared by every option variant of the geometry cache and kept when only non-geometry parts of the asset change
+	TangentCache tangentCache(asset.path + ".gvtangents");
+
+	std::vector<std::vector<SubmeshData>> primitiveSubmeshes(primitiveTasks.size());
+	std::vector<std::pair<VertexCacheStats, VertexCacheStats>> primitiveCacheStats(primitiveTasks.size()); // (before, after)
+	ThreadPool::Get().ParallelFor(primitiveTasks.size(), [&](int taskIdx)
+	{
+		if (cancelled && *cancelled) return;
+		const auto [meshIdx, primitiveIdx] = primitiveTasks[taskIdx];
+		SubmeshData built = BuildSubmeshData(model.meshes[meshIdx].primitives[primitiveIdx], asset, options, &tangentCache);
+		primitiveCacheStats[taskIdx] = { built.cacheStatsBefore, built.cacheStatsAfter };
+		if (options.splitForShortIndices)
+		{
+			primitiveSubmeshes[taskIdx] = SplitForShortIndices(std::move(built));
+		}
+		else
+		{
+			primitiveSubmeshes[taskIdx].push_back(std::move(built));
+		}
+		if (itemsBuilt) (*itemsBuilt)++;
+	});
+
+	data.meshes.resize(model.meshes.size());
+	VertexCacheStats before, after;
+	for (int taskIdx = 0; taskIdx < primitiveTasks.size(); taskIdx++)
+	{
+		std::vector<SubmeshData>& submeshes = data.meshes[primitiveTasks[taskIdx].first];
+		std::move(primitiveSubmeshes[taskIdx].begin(), primitiveSubmeshes[taskIdx].end(), std::back_inserter(submeshes));
+		before += primitiveCacheStats[taskIdx].first;
+		after += primitiveCacheStats[taskIdx].second;
+	}
+
+	if (options.optimizeIndices && before.triangleCount > 0)
+	{
+		std::cout << asset.path << ": ACMR " << before.ACMR() << " -> " << after.ACMR() << ", ATVR " << before.ATVR() << " -> " << after.ATVR() << '\n';
+	}
+
+	if (!(cancelled && *cancelled) && !tangentCache.Save())
+	{
+		std::cout << "Failed to write tangent cache " << asset.path << ".gvtangents\n";
+	}
+	if (!(cancelled && *cancelled) && !WriteGeometryCache(cachePath, sourceHash, data.meshes))
+	{
+		std::cout << "Failed to write geometry cache " << cachePath << '\n';
+	}
+}
+
+static void CompressTextures(const GLTFAsset& asset, GLTFResourceData& data, std::atomic<int>* itemsBuilt, const std::atomic<bool>* cancelled)
+{
+	const tinygltf::Model& model = asset.model;
+	const std::string cacheDir = asset.path + ".texcache";
+
+	// One texture per task, each of them also splits its blocks over the pool
+	data.textures.resize(model.textures.size());
+	ThreadPool::Get().ParallelFor(model.textures.size(), [&](int textureIdx)
+	{
+		if (cancelled && *cancelled) return;
+		const tinygltf::Texture& texture = model.textures[textureIdx];
+		const DecodedImage& decoded = asset.WaitForImage(texture.source);
+		if (decoded.error.empty() && !CompressTexture(decoded.image, GetTextureBlockFormat(textureIdx, model), cacheDir, data.textures[textureIdx]))
+		{
+			data.textures[textureIdx] = CompressedTexture(); // uploaded uncompressed instead
+		}
+		if (itemsBuilt) (*itemsBuilt)++;
+	});
+}
+
+GLTFResourceData BuildGLTFResourceData(const GLTFAsset& asset, std::atomic<int>* itemsBuilt, const std::atomic<bool>* cancelled, const MeshBuildOptions& meshOptions)
+{
+	GLTFResourceData data;
+	BuildMeshData(asset, data, itemsBuilt, cancelled, meshOptions);
+	CompressTextures(asset, data, itemsBuilt, cancelled);
+	return data;
+}
+
+GLTFResources::GLTFResources(const GLTFAsset& asset)
+	:GLTFResources(asset, BuildGLTFResourceData(asset), nullptr)
+{
 }
 
-GLTFResources::GLTFResources(const tinygltf::Model& model)
+GLTFResources::GLTFResources(const GLTFAsset& asset, const GLTFResourceData& data, StagingUploader* uploader)
 {
+	const tinygltf::Model& model = asset.model;
+
 	for (const auto& extension : model.extensionsUsed)
 	{
 		std::cout << extension << '\n';
 	}
 
-	for (const tinygltf::Mesh& mesh : model.meshes)
+	geometryArena = std::make_unique<GeometryArena>();
+	for (const std::vector<SubmeshData>& submeshData : data.meshes)
 	{
-		meshes.emplace_back(mesh, model);
+		for (const SubmeshData& submesh : submeshData)
+		{
+			geometryArena->Reserve(submesh.submesh.layout, submesh.VertexBytes().size() / submesh.submesh.layout.stride, submesh.IndexBytes().size());
+		}
+	}
+	meshes.reserve(data.meshes.size());
+	for (const std::vector<SubmeshData>& submeshData : data.meshes)
+	{
+		meshes.emplace_back(submeshData, *geometryArena, uploader);
 	}
 
 	for (int i = 0; i < model.textures.size(); i++)
@@ -77,41 +232,82 @@ GLTFResources::GLTFResources(const tinygltf::Model& model)
 		const tinygltf::Texture& texture = model.textures[i];
 		assert(texture.source >= 0);
 
-		const tinygltf::Image& image = model.images[texture.source];
-		bool linearSpaceTexture = IsLinearSpaceTexture(i, model.materials);
+		textures.emplace_back();
+		auto& addedTexture = textures.back();
+		addedTexture.id = GLTexture::Create();
+		glBindTexture(GL_TEXTURE_2D, addedTexture.id);
 
-		int numComponents = image.component;
-		GLenum internalFormat;
-		GLenum format;
-		if (numComponents == 1) {
-			internalFormat = GL_RED;
-			format = GL_RED;
-		}
-		if (numComponents == 2) {
-			internalFormat = GL_RG;
-			format = GL_RG;
-		}
-		else if (numComponents == 3) {
-			internalFormat = linearSpaceTexture ? GL_RGB : GL_SRGB;
-			format = GL_RGB;
-		}
-		else if (numComponents == 4) {
-			internalFormat = linearSpaceTexture ? GL_RGBA : GL_SRGB_ALPHA;
-			format = GL_RGBA;
+		const CompressedTexture& compressed = data.textures[i];
+		if (compressed.format != BlockFormat::None)
+		{
+			const GLenum internalFormat = GetGLInternalFormat(compressed.format);
+			glTexStorage2D(GL_TEXTURE_2D, (GLsizei)compressed.mips.size(), internalFormat, compressed.width, compressed.height);
+			for (int level = 0; level < compressed.mips.size(); level++)
+			{
+				const int mipWidth = std::max(compressed.width >> level, 1);
+				const int mipHeight = std::max(compressed.height >> level, 1);
+				const std::span<const std::uint8_t> mip = compressed.mips[level];
+				addedTexture.gpuBytes += mip.size();
+				if (uploader)
+				{
+					uploader->UploadCompressedTexture2D(addedTexture.id, level, mipWidth, mipHeight, internalFormat, mip);
+				}
+				else
+				{
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mipWidth, mipHeight, internalFormat, (GLsizei)mip.size(), mip.data());
+				}
+			}
 		}
 		else
 		{
-			std::cout << "Unsupported number of components: " << numComponents << " from file " << image.uri << '\n';
-			std::exit(1);
-		}
+			// Decodes were queued by LoadGLTFAsset, so by now most of them are done
+			const DecodedImage& decoded = asset.WaitForImage(texture.source);
+			if (!decoded.error.empty())
+			{
+				std::cout << decoded.error << '\n';
+				std::exit(1);
+			}
+			const tinygltf::Image& image = decoded.image;
+			bool linearSpaceTexture = IsLinearSpaceTexture(i, model.materials);
 
-		textures.emplace_back();
-		auto& addedTexture = textures.back();
+			int numComponents = image.component;
+			GLenum internalFormat;
+			GLenum format;
+			if (numComponents == 1) {
+				internalFormat = GL_RED;
+				format = GL_RED;
+			}
+			if (numComponents == 2) {
+				internalFormat = GL_RG;
+				format = GL_RG;
+			}
+			else if (numComponents == 3) {
+				internalFormat = linearSpaceTexture ? GL_RGB : GL_SRGB;
+				format = GL_RGB;
+			}
+			else if (numComponents == 4) {
+				internalFormat = linearSpaceTexture ? GL_RGBA : GL_SRGB_ALPHA;
+				format = GL_RGBA;
+			}
+			else
+			{
+				std::cout << "Unsupported number of components: " << numComponents << " from file " << image.uri << '\n';
+				std::exit(1);
+			}
 
-		glGenTextures(1, &addedTexture.id);
-		glBindTexture(GL_TEXTURE_2D, addedTexture.id);
-		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, image.pixel_type, image.image.data());
-		glGenerateMipmap(GL_TEXTURE_2D);
+			// Full mip chain is about a third on top of the base level
+			addedTexture.gpuBytes = (std::size_t)image.width * image.height * numComponents * image.bits / 8 * 4 / 3;
+			if (uploader)
+			{
+				glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, image.pixel_type, nullptr);
+				uploader->UploadTexture2D(addedTexture.id, image.width, image.height, format, image.pixel_type, numComponents * image.bits / 8, image.image, true);
+			}
+			else
+			{
+				glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, image.pixel_type, image.image.data());
+				glGenerateMipmap(GL_TEXTURE_2D);
+			}
+		}
 
 		if (texture.sampler >= 0)
 		{
@@ -149,14 +345,14 @@ Shader& GLTFResources::GetOrCreateShader(VertexAttribute attributes, bool flatSh
 		}
 	}
 	auto defines = GetShaderDefines(attributes, flatShading);
-	shaders.push_back({ { attributes, flatShading }, Shader("Shaders/default.vert", "Shaders/default.frag", nullptr, defines)});
+	shaders.emplace_back(ShaderKey{ attributes, flatShading }, Shader("Shaders/default.vert", "Shaders/default.frag", nullptr, defines));
 	return shaders.back().second;
 }
 
 Shader& GLTFResources::GetOrCreateDepthShader(VertexAttribute attributes, bool depthCubemap)
 {
 	// Only take attributes that affect depth shading into account
-	constexpr VertexAttribute depthShadingAttributes = VertexAttribute::POSITION | VertexAttribute::JOINTS | VertexAttribute::WEIGHTS | VertexAttribute::MORPH_TARGET0_POSITION;
+	constexpr VertexAttribute depthShadingAttributes = VertexAttribute::POSITION | VertexAttribute::JOINTS | VertexAttribute::WEIGHTS | VertexAttribute::MORPH_VERTEX;
 	VertexAttribute relevantAttributes = attributes & depthShadingAttributes;
 	for (auto& pair : depthShaders)
 	{
@@ -169,18 +365,18 @@ Shader& GLTFResources::GetOrCreateDepthShader(VertexAttribute attributes, bool d
 	auto defines = GetShaderDefines(relevantAttributes, false);
 	if (!depthCubemap)
 	{
-		depthShaders.push_back({ { relevantAttributes, false }, Shader("Shaders/depth.vert", "Shaders/empty.frag", nullptr, defines) });
+		depthShaders.emplace_back(DepthShaderKey{ relevantAttributes, false }, Shader("Shaders/depth.vert", "Shaders/empty.frag", nullptr, defines));
 	}
 	else
 	{
-		depthShaders.push_back({ { relevantAttributes, true }, Shader("Shaders/transform.vert", "Shaders/empty.frag", "Shaders/cubedepth.geom", defines)});
+		depthShaders.emplace_back(DepthShaderKey{ relevantAttributes, true }, Shader("Shaders/transform.vert", "Shaders/empty.frag", "Shaders/cubedepth.geom", defines));
 	}
 	return depthShaders.back().second;
 }
 
 Shader& GLTFResources::GetOrCreateHighlightShader(VertexAttribute attributes)
 {
-	constexpr VertexAttribute highlightAttributes = VertexAttribute::POSITION | VertexAttribute::JOINTS | VertexAttribute::WEIGHTS | VertexAttribute::MORPH_TARGET0_POSITION;
+	constexpr VertexAttribute highlightAttributes = VertexAttribute::POSITION | VertexAttribute::JOINTS | VertexAttribute::WEIGHTS | VertexAttribute::MORPH_VERTEX;
 	VertexAttribute relevantAttributes = attributes & highlightAttributes;
 	for (auto& pair : highlightShaders)
 	{
@@ -191,6 +387,18 @@ Shader& GLTFResources::GetOrCreateHighlightShader(VertexAttribute attributes)
 		}
 	}
 	auto defines = GetShaderDefines(relevantAttributes, false);
-	highlightShaders.push_back({ relevantAttributes, Shader("Shaders/transform.vert", "Shaders/highlight.frag", nullptr, defines) });
+	highlightShaders.emplace_back(relevantAttributes, Shader("Shaders/transform.vert", "Shaders/highlight.frag", nullptr, defines));
 	return highlightShaders.back().second;
+}
+
+std::size_t GLTFResources::GPUBytes() const
+{
+	std::size_t bytes = 0;
+	if (geometryArena) bytes += geometryArena->CapacityBytes();
+	for (const Texture& texture : textures) bytes += texture.gpuBytes;
+	for (const Mesh& mesh : meshes)
+	{
+		for (const Submesh& submesh : mesh.submeshes) bytes += submesh.MorphDeltaBufferSize() + submesh.MorphIndexBufferSize();
+	}
+	return bytes;
 }
\ No newline at end of file
@@ -1,20 +1,47 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include "GeometryArena.h"
+#include "GLTFAsset.h"
+#include "MappedFile.h"
 #include "Mesh.h"
 #include "PBRMaterial.h"
 #include "Shader.h"
 #include "Skeleton.h"
+#include "StagingUploader.h"
 #include "Texture.h"
+#include "TextureCompression.h"
 #include "tiny_gltf/tiny_gltf.h"
 #include "VertexAttribute.h"
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <utility>
 
+// CPU side of GLTFResources. Doesn't touch GL, so it can be built on any thread.
+struct GLTFResourceData
+{
+	std::vector<std::vector<SubmeshData>> meshes; // [mesh][primitive]
+	MappedFile geometryCache; // backs meshes if they were read from a .gvcache
+	std::vector<CompressedTexture> textures; // parallel to the model's textures, format None if left uncompressed
+};
+
+// Reads the asset's .gvcache if it's up to date, otherwise builds every primitive and writes it. Then block compresses every
+// texture (or reads it from the texture cache). itemsBuilt counts finished primitives and textures, it and cancelled are
+// optional, for loading in the background.
+GLTFResourceData BuildGLTFResourceData(const GLTFAsset& asset, std::atomic<int>* itemsBuilt = nullptr, const std::atomic<bool>* cancelled = nullptr,
+	const MeshBuildOptions& meshOptions = {});
+
 // TODO: just make this part of Scene?
 struct GLTFResources
 {
-	GLTFResources(const tinygltf::Model& model);
+	GLTFResources(const GLTFAsset& asset);
+	// Creates the GL objects for data. With an uploader their contents are streamed in by it instead of uploaded right away,
+	// so both data and the asset's decoded images must stay alive until it's idle.
+	GLTFResources(const GLTFAsset& asset, const GLTFResourceData& data, StagingUploader* uploader);
+	// Declared before meshes so it outlives their allocations. Behind a pointer so it doesn't move with the resources.
+	std::unique_ptr<GeometryArena> geometryArena;
 	std::vector<Mesh> meshes;
 	// TODO: make shader depend on material as well
 	using ShaderKey = std::pair<VertexAttribute, bool>; // bool = flatShading
@@ -24,7 +51,8 @@ struct GLTFResources
 	std::vector<std::pair<VertexAttribute, Shader>> highlightShaders;
 	std::vector<Texture> textures;
 	std::vector<PBRMaterial> materials;
-	// TODO: probably should make these global, these aren't specific to each scene
+	// TODO: probably should make these global, these aren't specific to each scene. For now every scene owns its own, so they
+	// go away with it.
 	int white1x1RGBAIndex;
 	int max1x1RedIndex;
 	
@@ -35,4 +63,7 @@ struct GLTFResources
 	Shader& GetOrCreateShader(VertexAttribute attributes, bool flatShading);
 	Shader& GetOrCreateDepthShader(VertexAttribute attributes, bool depthCubemap);
 	Shader& GetOrCreateHighlightShader(VertexAttribute attributes);
+
+	// Buffers and textures, shaders aren't counted
+	std::size_t GPUBytes() const;
 };
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+RangeAllocator::RangeAllocator(std::size_t size)
+	:size(size)
+{
+	if (size > 0) freeRanges.emplace(0, size);
+}
+
+std::optional<std::size_t> RangeAllocator::Allocate(std::size_t allocationSize, std::size_t alignment)
+{
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+	{
+		const auto [rangeOffset, rangeSize] = *it;
+		const std::size_t offset = (rangeOffset + alignment - 1) / alignment * alignment;
+		if (offset + allocationSize > rangeOffset + rangeSize)
+		{
+			continue;
+		}
+
+		// Whatever's left on either side of the allocation stays free
+		freeRanges.erase(it);
+		if (offset > rangeOffset) freeRanges.emplace(rangeOffset, offset - rangeOffset);
+		if (offset + allocationSize < rangeOffset + rangeSize) freeRanges.emplace(offset + allocationSize, rangeOffset + rangeSize - offset - allocationSize);
+		used += allocationSize;
+		return offset;
+	}
+	return std::nullopt;
+}
+
+void RangeAllocator::Free(std::size_t offset, std::size_t freedSize)
+{
+	assert(freedSize <= used);
+	used -= freedSize;
+
+	auto next = freeRanges.lower_bound(offset);
+	if (next != freeRanges.end() && offset + freedSize == next->first)
+	{
+		freedSize += next->second;
+		next = freeRanges.erase(next);
+	}
+	if (next != freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += freedSize;
+			return;
+		}
+	}
+	freeRanges.emplace(offset, freedSize);
+}
+
+GeometryArena::Allocation::Allocation(Allocation&& other) noexcept
+	:arena(std::exchange(other.arena, nullptr)), page(other.page), baseVertex(other.baseVertex), vertexCount(other.vertexCount),
+	indexOffset(other.indexOffset), indexBytes(other.indexBytes)
+{
+}
+
+GeometryArena::Allocation& GeometryArena::Allocation::operator=(Allocation&& other) noexcept
+{
+	if (this != &other)
+	{
+		Reset();
+		arena = std::exchange(other.arena, nullptr);
+		page = other.page;
+		baseVertex = other.baseVertex;
+		vertexCount = other.vertexCount;
+		indexOffset = other.indexOffset;
+		indexBytes = other.indexBytes;
+	}
+	return *this;
+}
+
+void GeometryArena::Allocation::Reset()
+{
+	if (arena) arena->Free(*this);
+	arena = nullptr;
+}
+
+GeometryArena::Page::Page(const VertexLayout& layout, std::size_t vertexCapacity, std::size_t indexCapacity)
+	:layout(layout), VAO(GLVertexArray::Create()), vertexBuffer(GLBuffer::Create()), indexBuffer(GLBuffer::Create()),
+	vertices(vertexCapacity), indices(indexCapacity)
+{
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * layout.stride, nullptr, GL_STATIC_DRAW);
+
+	// Don't change attribute indices, shaders rely on them being in this order
+	for (int location = 0; location < vertexAttributeCount; location++)
+	{
+		const VertexAttributeFormat& format = layout.attributes[location];
+		if (format.componentType == 0)
+		{
+			continue;
+		}
+
+		glEnableVertexAttribArray(location);
+		const void* offset = (const void*)(std::uintptr_t)format.offset;
+		if (format.integer)
+		{
+			glVertexAttribIPointer(location, format.componentCount, format.componentType, layout.stride, offset);
+		}
+		else
+		{
+			glVertexAttribPointer(location, format.componentCount, format.componentType, format.normalized ? GL_TRUE : GL_FALSE, layout.stride, offset);
+		}
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity, nullptr, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+}
+
+GeometryArena::GeometryArena(std::size_t vertexPageBytes, std::size_t indexPageBytes)
+	:vertexPageBytes(vertexPageBytes), indexPageBytes(indexPageBytes)
+{
+}
+
+static constexpr std::size_t reservedPageGranularity = 64 << 10;
+
+void GeometryArena::Reserve(const VertexLayout& layout, std::size_t vertexCount, std::size_t indexBytes)
+{
+	auto reservation = std::find_if(reservations.begin(), reservations.end(), [&](const Reservation& reservation)
+	{
+		return std::memcmp(&reservation.layout, &layout, sizeof(layout)) == 0;
+	});
+	if (reservation == reservations.end())
+	{
+		reservation = reservations.insert(reservations.end(), Reservation{ layout });
+	}
+	reservation->vertexCount += vertexCount;
+	reservation->indexBytes += (indexBytes + 3) / 4 * 4; // Allocate aligns every index range to 4 bytes
+}
+
+GeometryArena::Allocation GeometryArena::Allocate(const VertexLayout& layout, std::size_t vertexCount, std::size_t indexBytes)
+{
+	assert(layout.stride > 0 && vertexCount > 0);
+
+	Allocation allocation;
+	allocation.arena = this;
+	allocation.vertexCount = vertexCount;
+	allocation.indexBytes = indexBytes;
+
+	// 4 byte aligned indices work for both index types
+	auto tryPage = [&](int pageIdx)
+	{
+		Page& page = *pages[pageIdx];
+		const std::optional<std::size_t> baseVertex = page.vertices.Allocate(vertexCount);
+		if (!baseVertex)
+		{
+			return false;
+		}
+
+		std::optional<std::size_t> indexOffset = 0;
+		if (indexBytes > 0)
+		{
+			indexOffset = page.indices.Allocate(indexBytes, 4);
+			if (!indexOffset)
+			{
+				page.vertices.Free(*baseVertex, vertexCount);
+				return false;
+			}
+		}
+
+		allocation.page = pageIdx;
+		allocation.baseVertex = *baseVertex;
+		allocation.indexOffset = *indexOffset;
+		return true;
+	};
+
+	for (int pageIdx = 0; pageIdx < (int)pages.size(); pageIdx++)
+	{
+		if (pages[pageIdx] && std::memcmp(&pages[pageIdx]->layout, &layout, sizeof(layout)) == 0 && tryPage(pageIdx))
+		{
+			return allocation;
+		}
+	}
+
+	auto emptySlot = std::find_if(pages.begin(), pages.end(), [](const std::optional<Page>& page) { return !page; });
+	const int pageIdx = emptySlot != pages.end() ? (int)(emptySlot - pages.begin()) : (int)pages.size();
+	if (emptySlot == pages.end()) pages.emplace_back();
+	std::size_t vertexCapacity = vertexPageBytes / layout.stride;
+	std::size_t indexCapacity = indexPageBytes;
+	auto reservation = std::find_if(reservations.begin(), reservations.end(), [&](const Reservation& reservation)
+	{
+		return std::memcmp(&reservation.layout, &layout, sizeof(layout)) == 0;
+	});
+	if (reservation != reservations.end())
+	{
+		const std::size_t vertexBytes = reservation->vertexCount * layout.stride;
+		vertexCapacity = (vertexBytes + reservedPageGranularity - 1) / reservedPageGranularity * reservedPageGranularity / layout.stride;
+		indexCapacity = (reservation->indexBytes + reservedPageGranularity - 1) / reservedPageGranularity * reservedPageGranularity;
+		reservations.erase(reservation);
+	}
+	pages[pageIdx].emplace(layout, std::max(vertexCapacity, vertexCount), std::max(indexCapacity, indexBytes));
+	[[maybe_unused]] const bool allocated = tryPage(pageIdx);
+	assert(allocated);
+	return allocation;
+}
+
+void GeometryArena::Upload(const Allocation& allocation, std::span<const std::uint8_t> vertexBytes, std::span<const std::uint8_t> indexBytes, StagingUploader* uploader)
+{
+	assert(allocation.arena == this);
+	const Page& page = *pages[allocation.page];
+	assert(vertexBytes.size() == allocation.vertexCount * page.layout.stride && indexBytes.size() == allocation.indexBytes);
+
+	const std::size_t vertexOffset = allocation.baseVertex * page.layout.stride;
+	if (uploader)
+	{
+		uploader->UploadBuffer(page.vertexBuffer, vertexBytes, vertexOffset);
+		uploader->UploadBuffer(page.indexBuffer, indexBytes, allocation.indexOffset);
+		return;
+	}
+
+	// The copy target keeps whatever VAO is bound from picking up the index buffer
+	glBindBuffer(GL_COPY_WRITE_BUFFER, page.vertexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset, vertexBytes.size(), vertexBytes.data());
+	if (!indexBytes.empty())
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, page.indexBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, indexBytes.size(), indexBytes.data());
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+std::size_t GeometryArena::CapacityBytes() const
+{
+	std::size_t bytes = 0;
+	for (const std::optional<Page>& page : pages)
+	{
+		if (page) bytes += page->vertices.Size() * page->layout.stride + page->indices.Size();
+	}
+	return bytes;
+}
+
+void GeometryArena::Free(Allocation& allocation)
+{
+	std::optional<Page>& page = pages[allocation.page];
+	page->vertices.Free(allocation.baseVertex, allocation.vertexCount);
+	if (allocation.indexBytes > 0) page->indices.Free(allocation.indexOffset, allocation.indexBytes);
+	if (page->vertices.Used() == 0 && page->indices.Used() == 0)
+	{
+		page.reset();
+	}
+}
\ No newline at end of file
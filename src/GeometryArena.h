@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include "GLHandle.h"
+#include <map>
+#include <optional>
+#include <span>
+#include "StagingUploader.h"
+#include <vector>
+#include "VertexLayout.h"
+
+// First fit suballocator over [0, size). Freed ranges are merged with their free neighbours.
+class RangeAllocator
+{
+public:
+	explicit RangeAllocator(std::size_t size);
+
+	// Returns the offset, aligned to alignment, or nothing if no free range is big enough
+	std::optional<std::size_t> Allocate(std::size_t size, std::size_t alignment = 1);
+	void Free(std::size_t offset, std::size_t size);
+
+	std::size_t Size() const { return size; }
+	std::size_t Used() const { return used; }
+private:
+	std::map<std::size_t, std::size_t> freeRanges; // offset -> size
+	std::size_t size;
+	std::size_t used = 0;
+};
+
+// Vertex and index storage shared by every submesh of a scene. Submeshes with the same vertex layout are packed into
+// the same pages, each one large vertex buffer, one large index buffer and the VAO reading them, so draws only differ in
+// their base vertex and index offset. Pages are added as they fill up and deleted once everything in them is freed.
+// Must be created, used and destroyed on the GL context thread, and outlive its allocations.
+class GeometryArena
+{
+public:
+	// A submesh's vertices and indices, freed when destroyed
+	class Allocation
+	{
+	public:
+		Allocation() = default;
+		~Allocation() { Reset(); }
+		Allocation(const Allocation&) = delete;
+		Allocation& operator=(const Allocation&) = delete;
+		Allocation(Allocation&& other) noexcept;
+		Allocation& operator=(Allocation&& other) noexcept;
+
+		void Reset();
+
+		// In vertices into the page's vertex buffer, for glDrawElementsBaseVertex or as glDrawArrays' first
+		GLint BaseVertex() const { return (GLint)baseVertex; }
+		// In bytes into the page's index buffer
+		std::size_t IndexOffset() const { return indexOffset; }
+	private:
+		friend class GeometryArena;
+
+		GeometryArena* arena = nullptr;
+		int page = -1;
+		std::size_t baseVertex = 0;
+		std::size_t vertexCount = 0;
+		std::size_t indexOffset = 0;
+		std::size_t indexBytes = 0;
+	};
+
+	explicit GeometryArena(std::size_t vertexPageBytes = 16 << 20, std::size_t indexPageBytes = 8 << 20);
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	// Sizes the next page created for layout to fit this many more vertices and index bytes, rounded up to whole 64 KiB
+	// blocks, instead of the default page size. Reserving everything about to be allocated gives each layout one page that
+	// holds all of it, however little geometry that is.
+	void Reserve(const VertexLayout& layout, std::size_t vertexCount, std::size_t indexBytes);
+	// Room for vertexCount vertices in layout and indexBytes of 16 or 32 bit indices. Primitives bigger than a page get
+	// a page of their own.
+	Allocation Allocate(const VertexLayout& layout, std::size_t vertexCount, std::size_t indexBytes);
+	// Fills the allocation right away, or queues the copies on uploader, in which case the sources must outlive them
+	void Upload(const Allocation& allocation, std::span<const std::uint8_t> vertexBytes, std::span<const std::uint8_t> indexBytes, StagingUploader* uploader);
+	// Has the page's vertex and index buffers bound
+	GLuint VertexArray(const Allocation& allocation) const { return pages[allocation.page]->VAO; }
+
+	// GPU memory of every page, used or not
+	std::size_t CapacityBytes() const;
+private:
+	struct Page
+	{
+		Page(const VertexLayout& layout, std::size_t vertexCapacity, std::size_t indexCapacity);
+
+		VertexLayout layout;
+		GLVertexArray VAO;
+		GLBuffer vertexBuffer;
+		GLBuffer indexBuffer;
+		RangeAllocator vertices; // in vertices
+		RangeAllocator indices;  // in bytes
+	};
+
+	struct Reservation
+	{
+		VertexLayout layout;
+		std::size_t vertexCount = 0;
+		std::size_t indexBytes = 0;
+	};
+
+	void Free(Allocation& allocation);
+
+	std::vector<std::optional<Page>> pages; // empty slots are reused by new pages
+	std::vector<Reservation> reservations; // used up by the next page created for their layout
+	std::size_t vertexPageBytes;
+	std::size_t indexPageBytes;
+};
\ No newline at end of file
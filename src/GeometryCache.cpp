@@ -0,0 +1,244 @@
+#include "GeometryCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include "Hash.h"
+#include "ThreadPool.h"
+#include <type_traits>
+
+static constexpr std::uint32_t cacheMagic = 'G' | 'V' << 8 | 'C' << 16 | 'H' << 24; // "GVCH" at the start of the file
+static constexpr std::uint32_t cacheVersion = 8; // Bump whenever the layout of built submeshes changes
+static constexpr std::size_t blobAlignment = 16;
+
+struct CacheHeader
+{
+	std::uint32_t magic = cacheMagic;
+	std::uint32_t version = cacheVersion;
+	std::uint64_t sourceHash;
+	std::uint32_t meshCount;
+	std::uint32_t submeshCount;
+};
+
+// The header is followed by meshCount uint32 submesh counts, then submeshCount CacheSubmeshes, then the vertex, index,
+// morph delta and morph index blobs they point at
+struct CacheSubmesh
+{
+	std::uint32_t flags;
+	std::int32_t countVerticesOrIndices;
+	std::int32_t materialIndex;
+	std::uint32_t indexType;
+	std::int32_t morphTargetCount;
+	std::int32_t morphVertexCount;
+	std::int32_t morphDeltaStride;
+	std::int32_t morphDenseTargetCount;
+	std::int32_t morphSparseEntryCount;
+	std::uint8_t hasIndexBuffer;
+	std::uint8_t flatShading;
+	std::uint8_t padding[2];
+	VertexLayout layout;
+	float minXYZ[3];
+	float maxXYZ[3];
+	std::uint64_t vertexOffset;
+	std::uint64_t vertexSize;
+	std::uint64_t indexOffset;
+	std::uint64_t indexSize;
+	std::uint64_t morphDeltaOffset;
+	std::uint64_t morphDeltaSize;
+	std::uint64_t morphIndexOffset;
+	std::uint64_t morphIndexSize;
+};
+static_assert(std::is_trivially_copyable_v<CacheHeader> && std::is_trivially_copyable_v<CacheSubmesh>);
+
+std::uint64_t HashAssetSources(const GLTFAsset& asset)
+{
+	// Hash big files in chunks on the pool, then hash the chunk hashes
+	constexpr std::size_t chunkSize = 4 << 20;
+	std::vector<std::span<const std::uint8_t>> chunks;
+	std::vector<std::uint64_t> hashes;
+	for (const MappedFile& file : asset.mappedFiles)
+	{
+		hashes.push_back(file.Size());
+		for (std::size_t offset = 0; offset < file.Size(); offset += chunkSize)
+		{
+			chunks.push_back(file.Bytes(offset, std::min(chunkSize, file.Size() - offset)));
+		}
+	}
+
+	const std::size_t firstChunkHash = hashes.size();
+	hashes.resize(hashes.size() + chunks.size());
+	ThreadPool::Get().ParallelFor(chunks.size(), [&](int i)
+	{
+		hashes[firstChunkHash + i] = HashBytes(chunks[i]);
+	});
+
+	return HashBytes({ (const std::uint8_t*)hashes.data(), hashes.size() * sizeof(hashes[0]) });
+}
+
+static bool InFile(std::uint64_t offset, std::uint64_t size, std::size_t fileSize)
+{
+	return offset <= fileSize && size <= fileSize - offset;
+}
+
+bool ReadGeometryCache(const std::string& path, std::uint64_t sourceHash, MappedFile& file, std::vector<std::vector<SubmeshData>>& meshes)
+{
+	file = MappedFile(path);
+	if (!file.IsOpen() || file.Size() < sizeof(CacheHeader))
+	{
+		file = MappedFile();
+		return false;
+	}
+
+	CacheHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+	const std::size_t submeshesOffset = sizeof(CacheHeader) + (std::size_t)header.meshCount * sizeof(std::uint32_t);
+	if (header.magic != cacheMagic || header.version != cacheVersion || header.sourceHash != sourceHash ||
+		!InFile(submeshesOffset, (std::uint64_t)header.submeshCount * sizeof(CacheSubmesh), file.Size()))
+	{
+		file = MappedFile();
+		return false;
+	}
+
+	meshes.assign(header.meshCount, {});
+	std::uint32_t submeshIdx = 0;
+	for (std::uint32_t meshIdx = 0; meshIdx < header.meshCount; meshIdx++)
+	{
+		std::uint32_t submeshCount;
+		std::memcpy(&submeshCount, file.Data() + sizeof(CacheHeader) + meshIdx * sizeof(std::uint32_t), sizeof(submeshCount));
+		if (submeshCount > header.submeshCount - submeshIdx)
+		{
+			break;
+		}
+
+		for (std::uint32_t i = 0; i < submeshCount; i++, submeshIdx++)
+		{
+			CacheSubmesh cached;
+			std::memcpy(&cached, file.Data() + submeshesOffset + submeshIdx * sizeof(CacheSubmesh), sizeof(cached));
+			if (!InFile(cached.vertexOffset, cached.vertexSize, file.Size()) || !InFile(cached.indexOffset, cached.indexSize, file.Size()) ||
+				!InFile(cached.morphDeltaOffset, cached.morphDeltaSize, file.Size()) || !InFile(cached.morphIndexOffset, cached.morphIndexSize, file.Size()) ||
+				cached.layout.stride == 0 || cached.vertexSize % cached.layout.stride != 0 ||
+				(cached.indexType != GL_UNSIGNED_SHORT && cached.indexType != GL_UNSIGNED_INT) || cached.indexSize % (cached.indexType == GL_UNSIGNED_SHORT ? 2 : 4) != 0)
+			{
+				meshes.clear();
+				file = MappedFile();
+				return false;
+			}
+
+			SubmeshData& data = meshes[meshIdx].emplace_back();
+			data.submesh.flags = (VertexAttribute)cached.flags;
+			data.submesh.countVerticesOrIndices = cached.countVerticesOrIndices;
+			data.submesh.materialIndex = cached.materialIndex;
+			data.submesh.hasIndexBuffer = cached.hasIndexBuffer;
+			data.submesh.indexType = cached.indexType;
+			data.submesh.flatShading = cached.flatShading;
+			data.submesh.layout = cached.layout;
+			data.submesh.morphTargetCount = cached.morphTargetCount;
+			data.submesh.morphVertexCount = cached.morphVertexCount;
+			data.submesh.morphDeltaStride = cached.morphDeltaStride;
+			data.submesh.morphDenseTargetCount = cached.morphDenseTargetCount;
+			data.submesh.morphSparseEntryCount = cached.morphSparseEntryCount;
+			if (cached.morphTargetCount < 0 || cached.morphVertexCount < 0 || cached.morphDeltaStride < 0 || cached.morphDenseTargetCount < 0 ||
+				cached.morphSparseEntryCount < 0 || cached.morphDeltaSize != data.submesh.MorphDeltaBufferSize() ||
+				cached.morphIndexSize != data.submesh.MorphIndexBufferSize())
+			{
+				meshes.clear();
+				file = MappedFile();
+				return false;
+			}
+			data.boundingBox.minXYZ = glm::vec3(cached.minXYZ[0], cached.minXYZ[1], cached.minXYZ[2]);
+			data.boundingBox.maxXYZ = glm::vec3(cached.maxXYZ[0], cached.maxXYZ[1], cached.maxXYZ[2]);
+			data.cachedVertexBytes = file.Bytes(cached.vertexOffset, cached.vertexSize);
+			data.cachedIndexBytes = file.Bytes(cached.indexOffset, cached.indexSize);
+			data.cachedMorphDeltaBytes = file.Bytes(cached.morphDeltaOffset, cached.morphDeltaSize);
+			data.cachedMorphIndexBytes = file.Bytes(cached.morphIndexOffset, cached.morphIndexSize);
+		}
+	}
+
+	if (submeshIdx != header.submeshCount)
+	{
+		meshes.clear();
+		file = MappedFile();
+		return false;
+	}
+	return true;
+}
+
+static std::uint64_t AlignBlobOffset(std::uint64_t offset)
+{
+	return (offset + blobAlignment - 1) / blobAlignment * blobAlignment;
+}
+
+bool WriteGeometryCache(const std::string& path, std::uint64_t sourceHash, const std::vector<std::vector<SubmeshData>>& meshes)
+{
+	CacheHeader header;
+	header.sourceHash = sourceHash;
+	header.meshCount = (std::uint32_t)meshes.size();
+	header.submeshCount = 0;
+
+	std::vector<std::uint32_t> submeshCounts;
+	for (const std::vector<SubmeshData>& mesh : meshes)
+	{
+		submeshCounts.push_back((std::uint32_t)mesh.size());
+		header.submeshCount += (std::uint32_t)mesh.size();
+	}
+
+	std::vector<CacheSubmesh> cachedSubmeshes;
+	std::uint64_t offset = sizeof(CacheHeader) + submeshCounts.size() * sizeof(std::uint32_t) + (std::uint64_t)header.submeshCount * sizeof(CacheSubmesh);
+	for (const std::vector<SubmeshData>& mesh : meshes)
+	{
+		for (const SubmeshData& data : mesh)
+		{
+			// Value initialized, which zeroes the padding written to the file as well
+			CacheSubmesh& cached = cachedSubmeshes.emplace_back();
+			cached.flags = (std::uint32_t)data.submesh.flags;
+			cached.countVerticesOrIndices = data.submesh.countVerticesOrIndices;
+			cached.materialIndex = data.submesh.materialIndex;
+			cached.hasIndexBuffer = data.submesh.hasIndexBuffer;
+			cached.indexType = data.submesh.indexType;
+			cached.flatShading = data.submesh.flatShading;
+			cached.layout = data.submesh.layout;
+			cached.morphTargetCount = data.submesh.morphTargetCount;
+			cached.morphVertexCount = data.submesh.morphVertexCount;
+			cached.morphDeltaStride = data.submesh.morphDeltaStride;
+			cached.morphDenseTargetCount = data.submesh.morphDenseTargetCount;
+			cached.morphSparseEntryCount = data.submesh.morphSparseEntryCount;
+			for (int i = 0; i < 3; i++)
+			{
+				cached.minXYZ[i] = data.boundingBox.minXYZ[i];
+				cached.maxXYZ[i] = data.boundingBox.maxXYZ[i];
+			}
+			cached.vertexOffset = AlignBlobOffset(offset);
+			cached.vertexSize = data.VertexBytes().size();
+			cached.indexOffset = AlignBlobOffset(cached.vertexOffset + cached.vertexSize);
+			cached.indexSize = data.IndexBytes().size();
+			cached.morphDeltaOffset = AlignBlobOffset(cached.indexOffset + cached.indexSize);
+			cached.morphDeltaSize = data.MorphDeltaBytes().size();
+			cached.morphIndexOffset = AlignBlobOffset(cached.morphDeltaOffset + cached.morphDeltaSize);
+			cached.morphIndexSize = data.MorphIndexBytes().size();
+			offset = cached.morphIndexOffset + cached.morphIndexSize;
+		}
+	}
+
+	// Assembled in memory, blobs at the offsets computed above with zeros in between
+	std::vector<std::uint8_t> bytes(offset);
+	auto copyBlob = [&](std::uint64_t blobOffset, const void* blob, std::size_t size)
+	{
+		if (size > 0) std::memcpy(bytes.data() + blobOffset, blob, size);
+	};
+	copyBlob(0, &header, sizeof(header));
+	copyBlob(sizeof(header), submeshCounts.data(), submeshCounts.size() * sizeof(submeshCounts[0]));
+	copyBlob(sizeof(header) + submeshCounts.size() * sizeof(submeshCounts[0]), cachedSubmeshes.data(), cachedSubmeshes.size() * sizeof(cachedSubmeshes[0]));
+
+	int submeshIdx = 0;
+	for (const std::vector<SubmeshData>& mesh : meshes)
+	{
+		for (const SubmeshData& data : mesh)
+		{
+			const CacheSubmesh& cached = cachedSubmeshes[submeshIdx++];
+			copyBlob(cached.vertexOffset, data.VertexBytes().data(), cached.vertexSize);
+			copyBlob(cached.indexOffset, data.IndexBytes().data(), cached.indexSize);
+			copyBlob(cached.morphDeltaOffset, data.MorphDeltaBytes().data(), cached.morphDeltaSize);
+			copyBlob(cached.morphIndexOffset, data.MorphIndexBytes().data(), cached.morphIndexSize);
+		}
+	}
+	return WriteFileAtomically(path, bytes);
+}
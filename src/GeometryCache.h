@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include "GLTFAsset.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include <string>
+#include <vector>
+
+// .gvcache files store every built submesh of an asset (interleaved vertices, indices, flags, bounds) exactly as it gets
+// uploaded, so later loads can skip interleaving, tangent generation and bounds computation entirely. A cache is only
+// used if it was built from byte-identical source files by the same cache version.
+
+// Hash of every file the asset was loaded from (.gltf/.glb and external .bin buffers)
+std::uint64_t HashAssetSources(const GLTFAsset& asset);
+
+// On success meshes' submeshes point into file, which has to stay mapped for as long as they're used
+bool ReadGeometryCache(const std::string& path, std::uint64_t sourceHash, MappedFile& file, std::vector<std::vector<SubmeshData>>& meshes);
+bool WriteGeometryCache(const std::string& path, std::uint64_t sourceHash, const std::vector<std::vector<SubmeshData>>& meshes);
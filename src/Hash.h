@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// FNV-1a over 64 bit words with an extra fold so high bits of a word reach the low bits of the hash. Only used to key
+// on-disk caches, not for anything security related.
+inline std::uint64_t HashBytes(std::span<const std::uint8_t> bytes)
+{
+	constexpr std::uint64_t prime = 0x100000001B3ull;
+	std::uint64_t hash = 0xCBF29CE484222325ull;
+	std::size_t i = 0;
+	for (; i + sizeof(std::uint64_t) <= bytes.size(); i += sizeof(std::uint64_t))
+	{
+		std::uint64_t word;
+		std::memcpy(&word, bytes.data() + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 32;
+	}
+	for (; i < bytes.size(); i++)
+	{
+		hash = (hash ^ bytes[i]) * prime;
+	}
+	return hash;
+}
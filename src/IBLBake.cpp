@@ -0,0 +1,367 @@
+#include "IBLBake.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Cubemap.h"
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IBL_BAKE_SSE2
+#include <emmintrin.h>
+#endif
+
+static constexpr float pi = 3.14159265358979f;
+
+static int MipResolution(int resolution, int mip)
+{
+	return std::max(resolution >> mip, 1);
+}
+
+static glm::vec3 BilinearTexel(const std::vector<glm::vec3>& mip, int resolution, int face, int x0, int y0, float fx, float fy)
+{
+	const int x1 = std::min(x0 + 1, resolution - 1), y1 = std::min(y0 + 1, resolution - 1);
+	const glm::vec3* texels = mip.data() + (std::size_t)face * resolution * resolution;
+	const glm::vec3 top = texels[y0 * resolution + x0] * (1.0f - fx) + texels[y0 * resolution + x1] * fx;
+	const glm::vec3 bottom = texels[y1 * resolution + x0] * (1.0f - fx) + texels[y1 * resolution + x1] * fx;
+	return top * (1.0f - fy) + bottom * fy;
+}
+
+static glm::vec3 SampleFace(const std::vector<glm::vec3>& mip, int resolution, int face, float s, float t)
+{
+	const float x = std::clamp((s + 1.0f) * 0.5f * resolution - 0.5f, 0.0f, resolution - 1.0f);
+	const float y = std::clamp((t + 1.0f) * 0.5f * resolution - 0.5f, 0.0f, resolution - 1.0f);
+	const int x0 = (int)x, y0 = (int)y;
+	return BilinearTexel(mip, resolution, face, x0, y0, x - x0, y - y0);
+}
+
+glm::vec3 FloatCubemap::Sample(const glm::vec3& direction, float lod) const
+{
+	// Major axis selection from the GL spec, the inverse of CubemapTexelDirection
+	const glm::vec3 absolute = glm::abs(direction);
+	int face;
+	float sc, tc, ma;
+	if (absolute.x >= absolute.y && absolute.x >= absolute.z)
+	{
+		face = direction.x > 0.0f ? 0 : 1;
+		ma = absolute.x;
+		sc = direction.x > 0.0f ? -direction.z : direction.z;
+		tc = -direction.y;
+	}
+	else if (absolute.y >= absolute.z)
+	{
+		face = direction.y > 0.0f ? 2 : 3;
+		ma = absolute.y;
+		sc = direction.x;
+		tc = direction.y > 0.0f ? direction.z : -direction.z;
+	}
+	else
+	{
+		face = direction.z > 0.0f ? 4 : 5;
+		ma = absolute.z;
+		sc = direction.z > 0.0f ? direction.x : -direction.x;
+		tc = -direction.y;
+	}
+	const float s = sc / ma, t = tc / ma;
+
+	lod = std::clamp(lod, 0.0f, (float)mips.size() - 1.0f);
+	const int mip0 = (int)lod;
+	const int mip1 = std::min(mip0 + 1, (int)mips.size() - 1);
+	const float fraction = lod - mip0;
+	const glm::vec3 color0 = SampleFace(mips[mip0], MipResolution(resolution, mip0), face, s, t);
+	if (fraction == 0.0f)
+	{
+		return color0;
+	}
+	return color0 * (1.0f - fraction) + SampleFace(mips[mip1], MipResolution(resolution, mip1), face, s, t) * fraction;
+}
+
+// Calls texel(face, x, y) for every texel of a mip, a row per task
+template<typename F>
+static void ForEachTexel(std::vector<glm::vec3>& mip, int resolution, F&& texel)
+{
+	ThreadPool::Get().ParallelFor(6 * resolution, [&](int row)
+	{
+		const int face = row / resolution;
+		const int y = row % resolution;
+		glm::vec3* out = mip.data() + (std::size_t)row * resolution;
+		for (int x = 0; x < resolution; x++)
+		{
+			out[x] = texel(face, x, y);
+		}
+	});
+}
+
+FloatCubemap EquirectToCubemap(const float* rgb, int width, int height, int resolution)
+{
+	FloatCubemap cubemap;
+	cubemap.resolution = resolution;
+	cubemap.mips.emplace_back((std::size_t)6 * resolution * resolution);
+
+	auto pixel = [&](int x, int y)
+	{
+		x = (x % width + width) % width; // wraps around horizontally
+		y = std::clamp(y, 0, height - 1);
+		const float* p = rgb + ((std::size_t)y * width + x) * 3;
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	ForEachTexel(cubemap.mips[0], resolution, [&](int face, int x, int y)
+	{
+		const glm::vec3 direction = CubemapTexelDirection(face, x, y, resolution);
+		const float u = std::atan2(direction.z, direction.x) / (2.0f * pi) + 0.5f;
+		const float v = std::asin(std::clamp(direction.y, -1.0f, 1.0f)) / pi + 0.5f;
+		const float px = u * width - 0.5f;
+		const float py = (1.0f - v) * height - 0.5f; // v = 1 is up, which is the top row
+		const int x0 = (int)std::floor(px), y0 = (int)std::floor(py);
+		const float fx = px - x0, fy = py - y0;
+		const glm::vec3 top = pixel(x0, y0) * (1.0f - fx) + pixel(x0 + 1, y0) * fx;
+		const glm::vec3 bottom = pixel(x0, y0 + 1) * (1.0f - fx) + pixel(x0 + 1, y0 + 1) * fx;
+		return top * (1.0f - fy) + bottom * fy;
+	});
+	return cubemap;
+}
+
+void GenerateMips(FloatCubemap& cubemap)
+{
+	cubemap.mips.resize(1);
+	for (int resolution = cubemap.resolution / 2; resolution >= 1; resolution /= 2)
+	{
+		const std::vector<glm::vec3>& source = cubemap.mips.back();
+		std::vector<glm::vec3> mip((std::size_t)6 * resolution * resolution);
+		const int sourceResolution = resolution * 2;
+		ForEachTexel(mip, resolution, [&](int face, int x, int y)
+		{
+			const glm::vec3* texels = source.data() + (std::size_t)face * sourceResolution * sourceResolution;
+			const glm::vec3* row0 = texels + (2 * y) * sourceResolution + 2 * x;
+			const glm::vec3* row1 = row0 + sourceResolution;
+			return (row0[0] + row0[1] + row1[0] + row1[1]) * 0.25f;
+		});
+		cubemap.mips.push_back(std::move(mip));
+	}
+}
+
+static float RadicalInverse(std::uint32_t bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return bits * 2.3283064365386963e-10f;
+}
+
+// GGX light directions of one prefiltered mip in tangent space, as a structure of arrays padded with zero weight
+// samples to a multiple of 4 so PrefilterTexel can rotate and project 4 at a time
+struct PrefilterSamples
+{
+	std::vector<float> x, y, z;
+	std::vector<float> weight; // N.L
+	std::vector<float> lod;
+	// lod split into the two environment mips it blends, like FloatCubemap::Sample does, with the blend folded into weight
+	std::vector<int> mip0, mip1;
+	std::vector<float> mip0Resolution, mip1Resolution;
+	std::vector<float> mip0Weight, mip1Weight;
+	float totalWeight = 0.0f;
+};
+
+static PrefilterSamples GeneratePrefilterSamples(const FloatCubemap& environment, float roughness)
+{
+	// Same filtered importance sampling as prefilter.frag. With N = V = R the light directions only depend on roughness, so
+	// they're generated once per mip in tangent space and only rotated per texel.
+	constexpr int sampleCount = 1024;
+	const float texelSolidAngle = 4.0f * pi / (6.0f * environment.resolution * environment.resolution);
+	const float a = roughness * roughness;
+	PrefilterSamples samples;
+	auto add = [&](const glm::vec3& l, float weight, float lod)
+	{
+		samples.x.push_back(l.x);
+		samples.y.push_back(l.y);
+		samples.z.push_back(l.z);
+		samples.weight.push_back(weight);
+		samples.lod.push_back(lod);
+		lod = std::clamp(lod, 0.0f, (float)environment.mips.size() - 1.0f);
+		const int mip0 = (int)lod;
+		const int mip1 = std::min(mip0 + 1, (int)environment.mips.size() - 1);
+		const float fraction = lod - mip0;
+		samples.mip0.push_back(mip0);
+		samples.mip1.push_back(mip1);
+		samples.mip0Resolution.push_back((float)MipResolution(environment.resolution, mip0));
+		samples.mip1Resolution.push_back((float)MipResolution(environment.resolution, mip1));
+		samples.mip0Weight.push_back(weight * (1.0f - fraction));
+		samples.mip1Weight.push_back(weight * fraction);
+		samples.totalWeight += weight;
+	};
+	for (int i = 0; i < sampleCount; i++)
+	{
+		const float phi = 2.0f * pi * i / sampleCount;
+		const float xi = RadicalInverse(i);
+		const float cosTheta = std::sqrt((1.0f - xi) / (1.0f + (a * a - 1.0f) * xi));
+		const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+		const glm::vec3 h(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+		const glm::vec3 l = h * (2.0f * h.z) - glm::vec3(0.0f, 0.0f, 1.0f);
+		if (l.z <= 0.0f)
+		{
+			continue;
+		}
+
+		// pdf = D * N.H / (4 * H.V) and N.H = H.V here
+		const float denominator = cosTheta * cosTheta * (a * a - 1.0f) + 1.0f;
+		const float pdf = a * a / (pi * denominator * denominator) / 4.0f + 0.0001f;
+		const float sampleSolidAngle = 1.0f / (sampleCount * pdf + 0.0001f);
+		add(glm::normalize(l), l.z, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle));
+	}
+	while (samples.x.size() % 4 != 0)
+	{
+		add(glm::vec3(0.0f, 0.0f, 1.0f), 0.0f, 0.0f);
+	}
+	return samples;
+}
+
+#ifdef IBL_BAKE_SSE2
+static __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Texel coordinate and bilinear fraction along one axis of 4 mips, the same math as SampleFace
+static void TexelCoordinates(__m128 st, __m128 resolution, int* texel, float* fraction)
+{
+	const __m128 coordinate = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(st, _mm_set1_ps(1.0f)),
+		_mm_set1_ps(0.5f)), resolution), _mm_set1_ps(0.5f)), _mm_setzero_ps()), _mm_sub_ps(resolution, _mm_set1_ps(1.0f)));
+	const __m128i truncated = _mm_cvttps_epi32(coordinate);
+	_mm_storeu_si128((__m128i*)texel, truncated);
+	_mm_storeu_ps(fraction, _mm_sub_ps(coordinate, _mm_cvtepi32_ps(truncated)));
+}
+#endif
+
+// N.L weighted average of the environment over samples rotated into the frame of a texel's normal
+static glm::vec3 PrefilterTexel(const FloatCubemap& environment, const PrefilterSamples& samples, const glm::vec3& tangent,
+	const glm::vec3& bitangent, const glm::vec3& normal)
+{
+	glm::vec3 color(0.0f);
+	const int count = (int)samples.x.size();
+#ifdef IBL_BAKE_SSE2
+	// Rotation, face selection and texel coordinates of 4 samples at a time, only the texel fetches are per sample
+	const __m128 tx = _mm_set1_ps(tangent.x), ty = _mm_set1_ps(tangent.y), tz = _mm_set1_ps(tangent.z);
+	const __m128 bx = _mm_set1_ps(bitangent.x), by = _mm_set1_ps(bitangent.y), bz = _mm_set1_ps(bitangent.z);
+	const __m128 nx = _mm_set1_ps(normal.x), ny = _mm_set1_ps(normal.y), nz = _mm_set1_ps(normal.z);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	for (int i = 0; i < count; i += 4)
+	{
+		const __m128 lx = _mm_loadu_ps(&samples.x[i]), ly = _mm_loadu_ps(&samples.y[i]), lz = _mm_loadu_ps(&samples.z[i]);
+		const __m128 dx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, lx), _mm_mul_ps(bx, ly)), _mm_mul_ps(nx, lz));
+		const __m128 dy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ty, lx), _mm_mul_ps(by, ly)), _mm_mul_ps(ny, lz));
+		const __m128 dz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tz, lx), _mm_mul_ps(bz, ly)), _mm_mul_ps(nz, lz));
+
+		// Major axis selection of FloatCubemap::Sample. The negative faces flip the sign of sc on the x and z faces and of
+		// tc on the y faces.
+		const __m128 ax = _mm_andnot_ps(signBit, dx), ay = _mm_andnot_ps(signBit, dy), az = _mm_andnot_ps(signBit, dz);
+		const __m128 xMajor = _mm_and_ps(_mm_cmpge_ps(ax, ay), _mm_cmpge_ps(ax, az));
+		const __m128 yMajor = _mm_andnot_ps(xMajor, _mm_cmpge_ps(ay, az));
+		const __m128 ma = Select(xMajor, ax, Select(yMajor, ay, az));
+		const __m128 positive = _mm_cmpgt_ps(Select(xMajor, dx, Select(yMajor, dy, dz)), _mm_setzero_ps());
+		const __m128 flip = _mm_and_ps(positive, signBit);
+		const __m128 sc = Select(xMajor, _mm_xor_ps(dz, flip), Select(yMajor, dx, _mm_xor_ps(_mm_xor_ps(dx, signBit), flip)));
+		const __m128 tc = Select(yMajor, _mm_xor_ps(_mm_xor_ps(dz, signBit), flip), _mm_xor_ps(dy, signBit));
+		const __m128 face = _mm_add_ps(Select(xMajor, _mm_setzero_ps(), Select(yMajor, _mm_set1_ps(2.0f), _mm_set1_ps(4.0f))),
+			_mm_andnot_ps(positive, _mm_set1_ps(1.0f)));
+		const __m128 s = _mm_div_ps(sc, ma), t = _mm_div_ps(tc, ma);
+
+		int faces[4], x0[4], y0[4], x1[4], y1[4];
+		float fx0[4], fy0[4], fx1[4], fy1[4];
+		_mm_storeu_si128((__m128i*)faces, _mm_cvttps_epi32(face));
+		const __m128 resolution0 = _mm_loadu_ps(&samples.mip0Resolution[i]), resolution1 = _mm_loadu_ps(&samples.mip1Resolution[i]);
+		TexelCoordinates(s, resolution0, x0, fx0);
+		TexelCoordinates(t, resolution0, y0, fy0);
+		TexelCoordinates(s, resolution1, x1, fx1);
+		TexelCoordinates(t, resolution1, y1, fy1);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			const int sample = i + lane;
+			const int mip0 = samples.mip0[sample], mip1 = samples.mip1[sample];
+			color += BilinearTexel(environment.mips[mip0], (int)samples.mip0Resolution[sample], faces[lane], x0[lane], y0[lane],
+				fx0[lane], fy0[lane]) * samples.mip0Weight[sample];
+			if (samples.mip1Weight[sample] != 0.0f)
+			{
+				color += BilinearTexel(environment.mips[mip1], (int)samples.mip1Resolution[sample], faces[lane], x1[lane], y1[lane],
+					fx1[lane], fy1[lane]) * samples.mip1Weight[sample];
+			}
+		}
+	}
+#else
+	for (int i = 0; i < count; i++)
+	{
+		const glm::vec3 l = tangent * samples.x[i] + bitangent * samples.y[i] + normal * samples.z[i];
+		color += environment.Sample(l, samples.lod[i]) * samples.weight[i];
+	}
+#endif
+	return color / samples.totalWeight;
+}
+
+FloatCubemap BakePrefiltered(const FloatCubemap& environment, int resolution, int mipCount)
+{
+	FloatCubemap prefiltered;
+	prefiltered.resolution = resolution;
+	for (int mip = 0; mip < mipCount; mip++)
+	{
+		const int mipResolution = MipResolution(resolution, mip);
+		std::vector<glm::vec3>& out = prefiltered.mips.emplace_back((std::size_t)6 * mipResolution * mipResolution);
+		const float roughness = mipCount > 1 ? (float)mip / (mipCount - 1) : 0.0f;
+		if (roughness == 0.0f)
+		{
+			// Mirror reflection, just the environment at this resolution
+			const float lod = std::log2((float)environment.resolution / mipResolution);
+			ForEachTexel(out, mipResolution, [&](int face, int x, int y)
+			{
+				return environment.Sample(CubemapTexelDirection(face, x, y, mipResolution), lod);
+			});
+			continue;
+		}
+
+		const PrefilterSamples samples = GeneratePrefilterSamples(environment, roughness);
+		ForEachTexel(out, mipResolution, [&](int face, int x, int y)
+		{
+			const glm::vec3 normal = CubemapTexelDirection(face, x, y, mipResolution);
+			const glm::vec3 up = std::abs(normal.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+			const glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+			const glm::vec3 bitangent = glm::cross(normal, tangent);
+			return PrefilterTexel(environment, samples, tangent, bitangent, normal);
+		});
+	}
+	return prefiltered;
+}
+
+std::vector<std::vector<std::uint8_t>> CompressCubemapBC6H(const FloatCubemap& cubemap)
+{
+	std::vector<std::vector<std::uint8_t>> compressed;
+	for (int mip = 0; mip < cubemap.mips.size(); mip++)
+	{
+		const int resolution = MipResolution(cubemap.resolution, mip);
+		const int blocksPerRow = (resolution + 3) / 4;
+		std::vector<std::uint8_t>& out = compressed.emplace_back((std::size_t)6 * blocksPerRow * blocksPerRow * 16);
+
+		// A row of blocks per task. Mips smaller than a block repeat their edge texels.
+		ThreadPool::Get().ParallelFor(6 * blocksPerRow, [&](int blockRow)
+		{
+			const int face = blockRow / blocksPerRow;
+			const int blockY = blockRow % blocksPerRow;
+			const glm::vec3* texels = cubemap.mips[mip].data() + (std::size_t)face * resolution * resolution;
+			for (int blockX = 0; blockX < blocksPerRow; blockX++)
+			{
+				float block[48];
+				for (int i = 0; i < 16; i++)
+				{
+					const int x = std::min(blockX * 4 + i % 4, resolution - 1);
+					const int y = std::min(blockY * 4 + i / 4, resolution - 1);
+					const glm::vec3& texel = texels[y * resolution + x];
+					block[i * 3 + 0] = texel.x;
+					block[i * 3 + 1] = texel.y;
+					block[i * 3 + 2] = texel.z;
+				}
+				CompressBC6HBlock(block, out.data() + ((std::size_t)blockRow * blocksPerRow + blockX) * 16);
+			}
+		});
+	}
+	return compressed;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Linear HDR cubemap baked on the CPU. Faces are in GL_TEXTURE_CUBE_MAP_POSITIVE_X order, with row 0 at t = 0 like
+// glTexImage2D expects.
+struct FloatCubemap
+{
+	int resolution;
+	std::vector<std::vector<glm::vec3>> mips; // each holds 6 faces back to back
+
+	// Trilinear, no filtering across face edges
+	glm::vec3 Sample(const glm::vec3& direction, float lod) const;
+};
+
+// rgb is a width x height equirectangular image with its top row first, as stb_image loads it
+FloatCubemap EquirectToCubemap(const float* rgb, int width, int height, int resolution);
+// Box filters every mip down to 1x1
+void GenerateMips(FloatCubemap& cubemap);
+// GGX prefiltered environment with roughness going from 0 at mip 0 to 1 at the last mip
+FloatCubemap BakePrefiltered(const FloatCubemap& environment, int resolution, int mipCount);
+// Per mip, 6 faces of BC6H blocks back to back, as WriteCubemapFile takes them
+std::vector<std::vector<std::uint8_t>> CompressCubemapBC6H(const FloatCubemap& cubemap);
@@ -0,0 +1,59 @@
+// gltf-ibl-bake: turns an equirectangular .hdr into the envmap and prefilter cubemaps the viewer loads. Diffuse irradiance
+// isn't baked, the viewer projects the environment onto spherical harmonics itself.
+// Runs entirely on the CPU, so it works without a GPU or GL context.
+#include <chrono>
+#include "Cubemap.h"
+#include <filesystem>
+#include "IBLBake.h"
+#include <iostream>
+#include <string>
+#include "tiny_gltf/stb_image.h"
+
+static constexpr int environmentResolution = 512;
+static constexpr int prefilterResolution = 128;
+static constexpr int prefilterMipCount = 5; // MAX_REFLECTION_LOD in default.frag + 1
+
+static bool WriteBC6H(const std::filesystem::path& path, const FloatCubemap& cubemap)
+{
+	if (!WriteCubemapFile(path.string(), CubemapFormat::BC6H_UFloat, cubemap.resolution, CompressCubemapBC6H(cubemap)))
+	{
+		std::cout << "Failed to write " << path << '\n';
+		return false;
+	}
+	std::cout << "Wrote " << path << '\n';
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: gltf-ibl-bake <equirect.hdr> [output directory]\n";
+		return 1;
+	}
+	const std::filesystem::path outputDirectory = argc > 2 ? argv[2] : ".";
+
+	const auto start = std::chrono::steady_clock::now();
+	int width, height, components;
+	float* pixels = stbi_loadf(argv[1], &width, &height, &components, 3);
+	if (!pixels)
+	{
+		std::cout << "Failed to load " << argv[1] << ": " << stbi_failure_reason() << '\n';
+		return 1;
+	}
+
+	FloatCubemap environment = EquirectToCubemap(pixels, width, height, environmentResolution);
+	stbi_image_free(pixels);
+	GenerateMips(environment);
+	const FloatCubemap prefiltered = BakePrefiltered(environment, prefilterResolution, prefilterMipCount);
+
+	if (!WriteBC6H(outputDirectory / "envmap.cbmp", environment) ||
+		!WriteBC6H(outputDirectory / "prefilter.cbmp", prefiltered))
+	{
+		return 1;
+	}
+
+	const std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Baked in " << elapsed.count() << "s\n";
+	return 0;
+}
@@ -0,0 +1,401 @@
+#include "JsonReader.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+JsonReader::JsonReader(std::string_view text)
+	:text(text)
+{
+}
+
+void JsonReader::SkipWhitespace()
+{
+	while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+	{
+		position++;
+	}
+}
+
+bool JsonReader::Fail(const char* reason)
+{
+	if (!failed)
+	{
+		failed = true;
+		failReason = reason;
+	}
+	return false;
+}
+
+bool JsonReader::Expect(char c)
+{
+	if (failed)
+	{
+		return false;
+	}
+	SkipWhitespace();
+	if (position >= text.size() || text[position] != c)
+	{
+		return Fail(c == ':' ? "expected ':'" : c == ',' ? "expected ','" : "unexpected character");
+	}
+	position++;
+	return true;
+}
+
+JsonReader::Type JsonReader::Peek()
+{
+	if (failed)
+	{
+		return Type::Invalid;
+	}
+	SkipWhitespace();
+	if (position >= text.size())
+	{
+		return Type::Invalid;
+	}
+
+	switch (text[position])
+	{
+	case 'n': return Type::Null;
+	case 't': case 'f': return Type::Boolean;
+	case '"': return Type::String;
+	case '[': return Type::Array;
+	case '{': return Type::Object;
+	case '-': case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': return Type::Number;
+	default: return Type::Invalid;
+	}
+}
+
+bool JsonReader::ReadNumber(double& value)
+{
+	if (Peek() != Type::Number)
+	{
+		return Fail("expected a number");
+	}
+
+	const std::size_t start = position;
+	bool integer = true;
+	while (position < text.size())
+	{
+		const char c = text[position];
+		if (c == '.' || c == 'e' || c == 'E' || c == '+')
+		{
+			integer = false;
+		}
+		else if (!(c >= '0' && c <= '9') && c != '-')
+		{
+			break;
+		}
+		position++;
+	}
+
+	const std::string_view token = text.substr(start, position - start);
+	lastNumberWasInteger = integer;
+
+	// Most numbers in a glTF are small indices and counts, which don't need a full float parse
+	if (integer && token.size() <= 15)
+	{
+		const bool negative = token[0] == '-';
+		std::int64_t magnitude = 0;
+		for (std::size_t i = negative ? 1 : 0; i < token.size(); i++)
+		{
+			if (token[i] < '0' || token[i] > '9') return Fail("malformed number");
+			magnitude = magnitude * 10 + (token[i] - '0');
+		}
+		if (token.size() == (negative ? 1u : 0u)) return Fail("malformed number");
+		value = (double)(negative ? -magnitude : magnitude);
+		return true;
+	}
+
+	const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+	if (error != std::errc() || end != token.data() + token.size())
+	{
+		return Fail("malformed number");
+	}
+	return true;
+}
+
+bool JsonReader::ReadInt(int& value)
+{
+	double number;
+	if (!ReadNumber(number))
+	{
+		return false;
+	}
+	if (number != std::floor(number) || number < std::numeric_limits<int>::min() || number > std::numeric_limits<int>::max())
+	{
+		return Fail("expected an integer");
+	}
+	value = (int)number;
+	return true;
+}
+
+bool JsonReader::ReadSize(std::size_t& value)
+{
+	double number;
+	if (!ReadNumber(number))
+	{
+		return false;
+	}
+	if (number != std::floor(number) || number < 0.0 || number >= 18446744073709551616.0)
+	{
+		return Fail("expected a non-negative integer");
+	}
+	value = (std::size_t)number;
+	return true;
+}
+
+bool JsonReader::ReadBool(bool& value)
+{
+	if (Peek() == Type::Boolean)
+	{
+		if (text.substr(position, 4) == "true")
+		{
+			position += 4;
+			value = true;
+			return true;
+		}
+		if (text.substr(position, 5) == "false")
+		{
+			position += 5;
+			value = false;
+			return true;
+		}
+	}
+	return Fail("expected true or false");
+}
+
+bool JsonReader::ReadNull()
+{
+	if (Peek() == Type::Null && text.substr(position, 4) == "null")
+	{
+		position += 4;
+		return true;
+	}
+	return Fail("expected null");
+}
+
+static void AppendUTF8(std::string& string, std::uint32_t codePoint)
+{
+	if (codePoint < 0x80)
+	{
+		string += (char)codePoint;
+	}
+	else if (codePoint < 0x800)
+	{
+		string += (char)(0xC0 | (codePoint >> 6));
+		string += (char)(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		string += (char)(0xE0 | (codePoint >> 12));
+		string += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		string += (char)(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		string += (char)(0xF0 | (codePoint >> 18));
+		string += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+		string += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		string += (char)(0x80 | (codePoint & 0x3F));
+	}
+}
+
+static bool ParseHex4(std::string_view text, std::size_t position, std::uint32_t& value)
+{
+	if (position + 4 > text.size())
+	{
+		return false;
+	}
+	value = 0;
+	for (std::size_t i = position; i < position + 4; i++)
+	{
+		const char c = text[i];
+		const int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+		if (digit < 0) return false;
+		value = value * 16 + digit;
+	}
+	return true;
+}
+
+bool JsonReader::ReadStringToken(std::string_view& value, std::string& storage)
+{
+	if (!Expect('"'))
+	{
+		return false;
+	}
+
+	// Fast path, no escapes, the string is a view of the text
+	const std::size_t start = position;
+	while (position < text.size() && text[position] != '"' && text[position] != '\\')
+	{
+		position++;
+	}
+	if (position >= text.size())
+	{
+		return Fail("unterminated string");
+	}
+	if (text[position] == '"')
+	{
+		value = text.substr(start, position - start);
+		position++;
+		return true;
+	}
+
+	storage.assign(text.substr(start, position - start));
+	while (position < text.size() && text[position] != '"')
+	{
+		if (text[position] != '\\')
+		{
+			storage += text[position++];
+			continue;
+		}
+
+		if (++position >= text.size())
+		{
+			break;
+		}
+		const char escaped = text[position++];
+		switch (escaped)
+		{
+		case '"': storage += '"'; break;
+		case '\\': storage += '\\'; break;
+		case '/': storage += '/'; break;
+		case 'b': storage += '\b'; break;
+		case 'f': storage += '\f'; break;
+		case 'n': storage += '\n'; break;
+		case 'r': storage += '\r'; break;
+		case 't': storage += '\t'; break;
+		case 'u':
+		{
+			std::uint32_t codePoint;
+			if (!ParseHex4(text, position, codePoint))
+			{
+				return Fail("malformed \\u escape");
+			}
+			position += 4;
+
+			// Characters outside the BMP are escaped as a surrogate pair
+			if (codePoint >= 0xD800 && codePoint < 0xDC00)
+			{
+				std::uint32_t low;
+				if (text.substr(position, 2) != "\\u" || !ParseHex4(text, position + 2, low) || low < 0xDC00 || low >= 0xE000)
+				{
+					return Fail("unpaired surrogate");
+				}
+				position += 6;
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+			}
+			AppendUTF8(storage, codePoint);
+			break;
+		}
+		default:
+			return Fail("unknown escape");
+		}
+	}
+
+	if (position >= text.size())
+	{
+		return Fail("unterminated string");
+	}
+	position++;
+	value = storage;
+	return true;
+}
+
+bool JsonReader::ReadString(std::string& value)
+{
+	std::string_view view;
+	std::string storage;
+	if (!ReadStringToken(view, storage))
+	{
+		return false;
+	}
+	if (view.data() == storage.data())
+	{
+		value = std::move(storage);
+	}
+	else
+	{
+		value.assign(view);
+	}
+	return true;
+}
+
+std::string_view JsonReader::SkipValue()
+{
+	const Type type = Peek();
+	const std::size_t start = position;
+	switch (type)
+	{
+	case Type::Null:
+		ReadNull();
+		break;
+	case Type::Boolean:
+	{
+		bool value;
+		ReadBool(value);
+		break;
+	}
+	case Type::Number:
+	{
+		double value;
+		ReadNumber(value);
+		break;
+	}
+	case Type::String:
+	{
+		std::string_view value;
+		std::string storage;
+		ReadStringToken(value, storage);
+		break;
+	}
+	case Type::Array:
+	case Type::Object:
+	{
+		// Brackets are only counted, strings are stepped over so brackets in them don't count
+		int depth = 0;
+		while (position < text.size())
+		{
+			const char c = text[position++];
+			if (c == '[' || c == '{')
+			{
+				depth++;
+			}
+			else if (c == ']' || c == '}')
+			{
+				if (--depth == 0) break;
+			}
+			else if (c == '"')
+			{
+				while (position < text.size() && text[position] != '"')
+				{
+					position += text[position] == '\\' ? 2 : 1;
+				}
+				position++;
+			}
+		}
+		if (depth != 0 || position > text.size())
+		{
+			Fail("unbalanced brackets");
+		}
+		break;
+	}
+	case Type::Invalid:
+		Fail("expected a value");
+		break;
+	}
+	return failed ? std::string_view() : text.substr(start, position - start);
+}
+
+bool JsonReader::ReadEnd()
+{
+	SkipWhitespace();
+	return position == text.size() || Fail("trailing characters");
+}
+
+std::string JsonReader::Error() const
+{
+	return std::string(failReason ? failReason : "no error") + " at byte " + std::to_string(position);
+}
\ No newline at end of file
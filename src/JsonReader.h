@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Pull parser that reads JSON text straight into whatever the caller is filling, without building a DOM. Errors are
+// sticky: after the first one every read fails and leaves its output alone, so callers can check Failed() once at the end
+// instead of after every read. Values the caller doesn't care about are skipped, or kept as their raw text.
+class JsonReader
+{
+public:
+	enum class Type
+	{
+		Null,
+		Boolean,
+		Number,
+		String,
+		Array,
+		Object,
+		Invalid, // malformed text or the end of it
+	};
+
+	explicit JsonReader(std::string_view text);
+
+	// Type of the next value, without reading it
+	Type Peek();
+
+	// Calls onMember(key) for every member of the next value, which must be an object. onMember has to read or skip
+	// exactly one value, key is only valid until it returns.
+	template<typename OnMember>
+	bool ReadObject(OnMember&& onMember);
+	// Calls onElement() for every element of the next value, which must be an array. onElement has to read or skip
+	// exactly one value.
+	template<typename OnElement>
+	bool ReadArray(OnElement&& onElement);
+
+	bool ReadNumber(double& value);
+	// Integral numbers only, 3.0 counts but 3.5 doesn't
+	bool ReadInt(int& value);
+	bool ReadSize(std::size_t& value);
+	bool ReadBool(bool& value);
+	bool ReadString(std::string& value);
+	bool ReadNull();
+	// Whether the last number read had no fraction or exponent, the way JSON DOMs tell integers from reals
+	bool LastNumberWasInteger() const { return lastNumberWasInteger; }
+
+	// Skips the next value, whatever it is, and returns its raw text. Nested values are only checked for balanced
+	// brackets, not fully validated.
+	std::string_view SkipValue();
+
+	// Fails unless only whitespace is left
+	bool ReadEnd();
+
+	bool Failed() const { return failed; }
+	// Failure reason and where it happened
+	std::string Error() const;
+private:
+	void SkipWhitespace();
+	bool Expect(char c);
+	bool Fail(const char* reason);
+	// Reads a string token into a view of the text if it has no escapes, otherwise unescapes it into storage
+	bool ReadStringToken(std::string_view& value, std::string& storage);
+
+	std::string_view text;
+	std::size_t position = 0;
+	bool failed = false;
+	bool lastNumberWasInteger = false;
+	const char* failReason = nullptr;
+};
+
+template<typename OnMember>
+bool JsonReader::ReadObject(OnMember&& onMember)
+{
+	if (!Expect('{'))
+	{
+		return false;
+	}
+
+	SkipWhitespace();
+	if (position < text.size() && text[position] == '}')
+	{
+		position++;
+		return true;
+	}
+
+	std::string keyStorage;
+	while (!failed)
+	{
+		std::string_view key;
+		SkipWhitespace();
+		if (!ReadStringToken(key, keyStorage) || !Expect(':'))
+		{
+			return false;
+		}
+		onMember(key);
+
+		SkipWhitespace();
+		if (position < text.size() && text[position] == ',')
+		{
+			position++;
+			continue;
+		}
+		return Expect('}');
+	}
+	return false;
+}
+
+template<typename OnElement>
+bool JsonReader::ReadArray(OnElement&& onElement)
+{
+	if (!Expect('['))
+	{
+		return false;
+	}
+
+	SkipWhitespace();
+	if (position < text.size() && text[position] == ']')
+	{
+		position++;
+		return true;
+	}
+
+	while (!failed)
+	{
+		onElement();
+
+		SkipWhitespace();
+		if (position < text.size() && text[position] == ',')
+		{
+			position++;
+			continue;
+		}
+		return Expect(']');
+	}
+	return false;
+}
\ No newline at end of file
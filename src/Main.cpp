@@ -1,6 +1,7 @@
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "CubemapTexture.h"
 #include "Input.h"
 #include <memory>
 #include "tiny_gltf/stb_image.h"
@@ -11,10 +12,21 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "Scene.h"
+#include "SceneCache.h"
+#include "SceneLoader.h"
+#include "SphericalHarmonics.h"
+#include "StagingUploader.h"
 
 int windowWidth = 1920;
 int windowHeight = 1080;
 int selectedModelIndex = 0;
+std::filesystem::path modelsDirectory = "C:/dev/gltf-models";
+// Starting budgets of the scene cache, adjustable from the UI
+int sceneCacheCPUBudgetMB = 1024;
+int sceneCacheGPUBudgetMB = 1024;
+// Only affects models loaded after they change
+MeshBuildOptions meshBuildOptions;
+AnimationCompression animationCompression;
 
 void FramebufferSizeCallback(GLFWwindow*, int width, int height)
 {
@@ -110,7 +122,20 @@ void ProcessInput(GLFWwindow* window, Input& outInput, const ImGuiIO& io)
     }
 }
 
-Scene* LoadScene(const std::string& modelName, std::unordered_map<std::string, Scene>& scenes, GLuint fbo,
+// Prefers the .glb variant of a sample model since it maps as a single file
+std::string GetModelPath(const std::string& modelName)
+{
+    const auto modelDirectory = modelsDirectory / modelName;
+    const auto glbPath = modelDirectory / "glTF-Binary" / (modelName + ".glb");
+    if (std::filesystem::exists(glbPath))
+    {
+        return glbPath.string();
+    }
+    return (modelDirectory / "glTF" / (modelName + ".gltf")).string();
+}
+
+// Moves a finished load into the cache, which may evict other scenes to make room
+Scene* AddLoadedScene(const std::string& modelName, SceneLoader& loader, SceneCache& scenes, GLuint fbo,
     GLuint fbW,
     GLuint fbH,
     GLuint fullscreenQuadVAO,
@@ -120,105 +145,12 @@ Scene* LoadScene(const std::string& modelName, std::unordered_map<std::string, S
     GLuint lightsUBO,
     GLuint skyboxVAO,
     GLuint environmentMap,
-    GLuint irradianceMap,
     GLuint prefilterMap,
     GLuint brdfLUT)
 {
-    std::string filepath = "C:\\dev\\gltf-models\\" + modelName + "\\glTF\\" + modelName + ".gltf";
-    tinygltf::Model model;
-    tinygltf::TinyGLTF loader;
-    std::string err;
-    std::string warn;
-
-    bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, filepath);
-    //bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, argv[1]); // for binary glTF(.glb)
-
-    if (!warn.empty()) {
-        printf("Warn: %s\n", warn.c_str());
-    }
-
-    if (!err.empty()) {
-        printf("Err: %s\n", err.c_str());
-    }
-
-    if (!ret) {
-        printf("Failed to parse glTF\n");
-        return nullptr;
-    }
-
+    const tinygltf::Model& model = loader.Asset().model;
     assert(model.scenes.size() == 1); // cba
-    auto pair = scenes.emplace(std::piecewise_construct, std::forward_as_tuple(modelName), std::forward_as_tuple(model.scenes[0], model, fbW, fbH, fbo, fullscreenQuadVAO, colorTexture, highlightFBO, depthStencilRBO, lightsUBO, skyboxVAO, environmentMap, irradianceMap, prefilterMap, brdfLUT));
-    return &pair.first->second;
-}
-
-struct CubemapFile
-{
-    static constexpr std::uint32_t correctMagicNumber = 'PMBC';
-    struct Header
-    {
-        std::uint32_t magicNumber = correctMagicNumber;
-        std::uint32_t mipmapLevels;
-        std::uint32_t resolution;
-        // TODO: specify pixel format
-    };
-    Header header;
-    std::vector<std::uint8_t> pixels;
-};
-
-int BytesPerFaceBC6(std::uint32_t resolution, std::uint32_t mipmapLevels)
-{
-    int bytesNeeded = resolution * resolution;
-
-    for (int i = 1; i < mipmapLevels; i++)
-    {
-        resolution = std::max(resolution / 2, 4u); // BC6 always works with 4x4 blocks
-        bytesNeeded += resolution * resolution;
-    }
-
-    return bytesNeeded;
-}
-
-GLuint ReadCubemapFile(const char* path)
-{
-    std::ifstream file(path, std::ios::binary);
-
-    CubemapFile data;
-    file.read((char*)&data.header, sizeof(data.header));
-    assert(data.header.magicNumber == CubemapFile::correctMagicNumber);
-    const auto res = data.header.resolution;
-    int bytesPerFace = BytesPerFaceBC6(res, data.header.mipmapLevels);
-    data.pixels.resize(bytesPerFace * 6);
-    file.read((char*)&data.pixels[0], data.pixels.size());
-
-    GLuint cubemap;
-    glGenTextures(1, &cubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, data.header.mipmapLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    if (data.header.mipmapLevels > 1 && data.header.mipmapLevels != 1 + (int)std::log2(res))
-    {
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, data.header.mipmapLevels - 1);
-    }
-
-    int byteOffset = 0;
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        int mipRes = res;
-
-        for (unsigned int j = 0; j < data.header.mipmapLevels; j++)
-        {
-            int imageSize = mipRes >= 4 ? mipRes * mipRes : 4 * 4;
-            glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, j, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, mipRes, mipRes, 0, imageSize, &data.pixels[byteOffset]);
-            byteOffset += imageSize;
-            mipRes /= 2;
-        }
-    }
-
-    return cubemap;
+    return scenes.Insert(modelName, std::make_unique<Scene>(model.scenes[0], loader.Asset(), loader.TakeResources(), fbW, fbH, fbo, fullscreenQuadVAO, colorTexture, highlightFBO, depthStencilRBO, lightsUBO, skyboxVAO, environmentMap, prefilterMap, brdfLUT, animationCompression));
 }
 
 int main(int argc, char** argv)
@@ -260,12 +192,15 @@ int main(int argc, char** argv)
     glCullFace(GL_BACK);
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
-    std::unordered_map<std::string, Scene> sampleModels;
+    SceneCache sampleModels((std::size_t)sceneCacheCPUBudgetMB << 20, (std::size_t)sceneCacheGPUBudgetMB << 20);
     std::vector<std::string> sampleModelNames;
 
     namespace fs = std::filesystem;
 
-    const auto modelsDirectory = fs::path("C:/dev/gltf-models");
+    if (argc > 1)
+    {
+        modelsDirectory = argv[1];
+    }
     assert(fs::is_directory(modelsDirectory));
     for (const auto& entry : fs::directory_iterator(modelsDirectory))
     {
@@ -454,11 +389,51 @@ int main(int argc, char** argv)
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec3), (const void*)(sizeof(glm::vec3)));
 
-    GLuint environmentMap = ReadCubemapFile("envmap.cbmp");
-
-    GLuint irradianceMap = ReadCubemapFile("irradiance.cbmp");
-
-    GLuint prefilterMap = ReadCubemapFile("prefilter.cbmp");
+    // Only the smallest mips are uploaded here, the rest stream in over the first frames
+    auto environmentUploader = std::make_unique<StagingUploader>(4 << 20);
+    CubemapFile cubemapFiles[2];
+    const char* cubemapPaths[2] = { "envmap.cbmp", "prefilter.cbmp" };
+    GLuint cubemaps[2];
+    for (int i = 0; i < 2; i++)
+    {
+        if (!ReadCubemapFile(cubemapPaths[i], cubemapFiles[i]))
+        {
+            std::cout << "Failed to read cubemap " << cubemapPaths[i] << '\n';
+            glfwTerminate();
+            return -1;
+        }
+        cubemaps[i] = CreateStreamedCubemap(cubemapFiles[i], *environmentUploader);
+    }
+    GLuint environmentMap = cubemaps[0];
+    GLuint prefilterMap = cubemaps[1];
+
+    // Diffuse IBL comes from L2 spherical harmonics of the environment. They start out from the 1x1 mip and are redone
+    // once a mip of at most 32x32 has streamed in.
+    const CubemapFile& environmentFile = cubemapFiles[0];
+    const int smallestEnvironmentMip = (int)environmentFile.mips.size() - 1;
+    IrradianceSH irradianceSH = ComputeIrradianceSH(environmentMap, smallestEnvironmentMip, std::max(environmentFile.resolution >> smallestEnvironmentMip, 1));
+    GLuint irradianceSHUBO;
+    glGenBuffers(1, &irradianceSHUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, irradianceSHUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(IrradianceSH), &irradianceSH, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 2, irradianceSHUBO);
+
+    int shMip = 0;
+    while ((environmentFile.resolution >> shMip) > 32 && shMip < smallestEnvironmentMip)
+    {
+        shMip++;
+    }
+    if (shMip != smallestEnvironmentMip)
+    {
+        // Runs once every mip queued so far has landed
+        const int shMipResolution = std::max(environmentFile.resolution >> shMip, 1);
+        environmentUploader->OnUploaded([environmentMap, irradianceSHUBO, shMip, shMipResolution]()
+        {
+            const IrradianceSH sh = ComputeIrradianceSH(environmentMap, shMip, shMipResolution);
+            glBindBuffer(GL_UNIFORM_BUFFER, irradianceSHUBO);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(IrradianceSH), &sh);
+        });
+    }
 
     GLuint captureFBO;
     glGenFramebuffers(1, &captureFBO);
@@ -546,7 +521,10 @@ int main(int argc, char** argv)
     {
         selectedModelIndex++;
     }
-    Scene* selectedScene = LoadScene(sampleModelNames[selectedModelIndex], sampleModels, fbo, fbW, fbH, fullscreenQuadVAO, colorTexture, highlightFBO, depthStencilRBO, lightsUBO, skyboxVAO, environmentMap, irradianceMap, prefilterMap, brdfLUT);
+    Scene* selectedScene = nullptr;
+    int displayedModelIndex = -1; // the model selectedScene belongs to, which keeps rendering while another one loads
+    std::unique_ptr<SceneLoader> sceneLoader;
+    int loadingModelIndex = -1;
 
     Shader postprocessShader = Shader("Shaders/fullscreen.vert", "Shaders/postprocess.frag");
 
@@ -559,6 +537,8 @@ int main(int argc, char** argv)
 
         ProcessInput(window, input, io);
 
+        environmentUploader->Flush();
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -586,6 +566,52 @@ int main(int argc, char** argv)
             ImGui::EndCombo();
         }
 
+        ImGui::Checkbox("Compact vertices", &meshBuildOptions.compactVertices);
+        ImGui::Checkbox("Split for 16 bit indices", &meshBuildOptions.splitForShortIndices);
+        ImGui::Checkbox("Weld vertices", &meshBuildOptions.weldVertices);
+        ImGui::Checkbox("Optimize triangle order", &meshBuildOptions.optimizeIndices);
+        bool fastTangents = meshBuildOptions.tangentGenerator == TangentGenerator::Fast;
+        if (ImGui::Checkbox("Fast approximate tangents", &fastTangents))
+        {
+            meshBuildOptions.tangentGenerator = fastTangents ? TangentGenerator::Fast : TangentGenerator::MikkTSpace;
+        }
+        ImGui::Checkbox("Compress animations", &animationCompression.enabled);
+        if (animationCompression.enabled)
+        {
+            ImGui::SliderFloat("Max positional error", &animationCompression.positionalError, 0.0f, 0.01f, "%.5f");
+            ImGui::SliderFloat("Max angular error (rad)", &animationCompression.angularError, 0.0f, 0.01f, "%.5f");
+        }
+
+        if (sceneLoader && (sceneLoader->GetState() == SceneLoader::State::Loading || sceneLoader->GetState() == SceneLoader::State::Uploading))
+        {
+            ImGui::ProgressBar(sceneLoader->Progress());
+            if (displayedModelIndex >= 0)
+            {
+                ImGui::SameLine();
+                if (ImGui::Button("Cancel"))
+                {
+                    sceneLoader.reset();
+                    selectedModelIndex = displayedModelIndex;
+                }
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Scene cache"))
+        {
+            bool budgetChanged = ImGui::SliderInt("CPU budget (MB)", &sceneCacheCPUBudgetMB, 64, 8192);
+            budgetChanged |= ImGui::SliderInt("GPU budget (MB)", &sceneCacheGPUBudgetMB, 64, 8192);
+            if (budgetChanged)
+            {
+                sampleModels.SetBudget((std::size_t)sceneCacheCPUBudgetMB << 20, (std::size_t)sceneCacheGPUBudgetMB << 20);
+            }
+            const SceneMemoryUsage total = sampleModels.TotalUsage();
+            ImGui::Text("Total: %.1f MB CPU, %.1f MB GPU", total.cpuBytes / 1048576.0, total.gpuBytes / 1048576.0);
+            for (const SceneCache::Entry& entry : sampleModels.Entries())
+            {
+                ImGui::BulletText("%s: %.1f MB CPU, %.1f MB GPU", entry.name.c_str(), entry.usage.cpuBytes / 1048576.0, entry.usage.gpuBytes / 1048576.0);
+            }
+        }
+
         ImGui::End();
 
         // Rendering
@@ -597,14 +623,38 @@ int main(int argc, char** argv)
         glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
         
 
-        auto sceneIter = sampleModels.find(sampleModelNames[selectedModelIndex]);
-        if (sceneIter != sampleModels.end())
+        if (Scene* cachedScene = sampleModels.Find(sampleModelNames[selectedModelIndex]))
         {
-            selectedScene = &sceneIter->second;
+            selectedScene = cachedScene;
+            displayedModelIndex = selectedModelIndex;
+            sceneLoader.reset(); // selection went back to an already loaded model
         }
         else
         {
-            selectedScene = LoadScene(sampleModelNames[selectedModelIndex], sampleModels, fbo, fbW, fbH, fullscreenQuadVAO, colorTexture, highlightFBO, depthStencilRBO, lightsUBO, skyboxVAO, environmentMap, irradianceMap, prefilterMap, brdfLUT);
+            if (!sceneLoader || loadingModelIndex != selectedModelIndex)
+            {
+                sceneLoader = std::make_unique<SceneLoader>(GetModelPath(sampleModelNames[selectedModelIndex]), meshBuildOptions);
+                loadingModelIndex = selectedModelIndex;
+            }
+
+            sceneLoader->Update();
+            if (sceneLoader->GetState() == SceneLoader::State::Ready)
+            {
+                selectedScene = AddLoadedScene(sampleModelNames[selectedModelIndex], *sceneLoader, sampleModels, fbo, fbW, fbH, fullscreenQuadVAO, colorTexture, highlightFBO, depthStencilRBO, lightsUBO, skyboxVAO, environmentMap, prefilterMap, brdfLUT);
+                displayedModelIndex = selectedModelIndex;
+                sceneLoader.reset();
+            }
+            else if (sceneLoader->GetState() == SceneLoader::State::Failed)
+            {
+                printf("Err: %s\n", sceneLoader->Error().c_str());
+                printf("Failed to parse glTF\n");
+                // Go back to what's on screen. With nothing on screen keep the failed loader around so it isn't retried every frame.
+                if (displayedModelIndex >= 0)
+                {
+                    selectedModelIndex = displayedModelIndex;
+                    sceneLoader.reset();
+                }
+            }
         }
 
         if (selectedScene)
@@ -646,6 +696,13 @@ int main(int argc, char** argv)
         glfwPollEvents();
     }
 
+    // Everything holding GL objects goes before the context does
+    sceneLoader.reset();
+    SceneLoader::WaitForCancelledLoads();
+    selectedScene = nullptr;
+    sampleModels.Clear();
+    environmentUploader.reset();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are only faulted in when touched, so views into the mapping
+// (glTF buffers, cubemap mips, cached geometry) never need their own copy of the file contents.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool IsOpen() const { return opened; }
+	const std::uint8_t* Data() const { return data; }
+	std::size_t Size() const { return size; }
+	std::span<const std::uint8_t> Bytes() const { return { data, size }; }
+	std::span<const std::uint8_t> Bytes(std::size_t offset, std::size_t count) const { return { data + offset, count }; }
+private:
+	void Close();
+	const std::uint8_t* data = nullptr;
+	std::size_t size = 0;
+	bool opened = false;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+// Writes bytes to path under a temporary name first and then renames it over path, so an interrupted write never leaves
+// a truncated file behind for the next load to map
+bool WriteFileAtomically(const std::string& path, std::span<const std::uint8_t> bytes);
\ No newline at end of file
@@ -1,10 +1,14 @@
 #include "Mesh.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include "GLTFHelpers.h"
+#include <glm/geometric.hpp>
+#include "Hash.h"
 #include "mikktspace.h"
+#include <map>
 #include <utility>
 #include <vector>
 #include <span>
@@ -20,61 +24,8 @@ static const std::unordered_map<std::string, VertexAttribute> vertexAttributeMap
 	{"TANGENT", VertexAttribute::TANGENT },
 	{"COLOR_0", VertexAttribute::COLOR },
 };
-static const std::vector<VertexAttribute> vertexAttributeOrdering =
-{
-	VertexAttribute::POSITION,
-	VertexAttribute::TEXCOORD,
-	VertexAttribute::NORMAL,
-	VertexAttribute::WEIGHTS,
-	VertexAttribute::JOINTS,
-	VertexAttribute::MORPH_TARGET0_POSITION,
-	VertexAttribute::MORPH_TARGET1_POSITION,
-	VertexAttribute::MORPH_TARGET0_NORMAL,
-	VertexAttribute::MORPH_TARGET1_NORMAL,
-	VertexAttribute::TANGENT,
-	VertexAttribute::MORPH_TARGET0_TANGENT,
-	VertexAttribute::MORPH_TARGET1_TANGENT,
-	VertexAttribute::COLOR,
-};
-static const std::unordered_map<VertexAttribute, int> attributeByteSizes =
-{
-	{VertexAttribute::POSITION, 12},
-	{VertexAttribute::TEXCOORD, 8},
-	{VertexAttribute::NORMAL, 12},
-	{VertexAttribute::WEIGHTS, 16},
-	{VertexAttribute::JOINTS, 4},
-	{VertexAttribute::MORPH_TARGET0_POSITION, 12},
-	{VertexAttribute::MORPH_TARGET1_POSITION, 12},
-	{VertexAttribute::MORPH_TARGET0_NORMAL, 12},
-	{VertexAttribute::MORPH_TARGET1_NORMAL, 12},
-	{VertexAttribute::TANGENT, 16},
-	{VertexAttribute::MORPH_TARGET0_TANGENT, 12},
-	{VertexAttribute::MORPH_TARGET1_TANGENT, 12},
-	{VertexAttribute::COLOR, 16}, // vertexColor is always converted to RGBA
-};
-
-static int GetAttributeByteOffset(VertexAttribute attributes, VertexAttribute attribute)
-{
-	int offset = 0;
-
-	for (VertexAttribute attr : vertexAttributeOrdering)
-	{
-		if (attribute == attr)
-		{
-			return offset;
-		}
-		
-		if (HasFlag(attributes, attr))
-		{
-			offset += attributeByteSizes.find(attr)->second;
-		}
-	}
 
-	assert(false && "Attribute not found");
-	return -1;
-}
-
-static VertexAttribute GetPrimitiveVertexLayout(const tinygltf::Primitive& primitive)
+static VertexAttribute GetPrimitiveAttributes(const tinygltf::Primitive& primitive)
 {
 	VertexAttribute attributes = (VertexAttribute)0;
 
@@ -89,567 +40,952 @@ static VertexAttribute GetPrimitiveVertexLayout(const tinygltf::Primitive& primi
 		}
 	}
 
-	int countMorphTargets = primitive.targets.size();
-	if (countMorphTargets > 0)
+	// The deltas themselves live in a buffer texture, vertices only carry the index to look them up with
+	if (!primitive.targets.empty())
 	{
-		assert(countMorphTargets == 2 && "Only 2 morph targets per primitive currently supported");
-		attributes |= VertexAttribute::MORPH_TARGET0_POSITION;
-		attributes |= VertexAttribute::MORPH_TARGET1_POSITION;
-		if (HasFlag(attributes, VertexAttribute::NORMAL))
-		{
-			assert(primitive.targets[0].contains("NORMAL") && primitive.targets[1].contains("NORMAL"));
-			attributes |= VertexAttribute::MORPH_TARGET0_NORMAL;
-			attributes |= VertexAttribute::MORPH_TARGET1_NORMAL;
-		}
-		if (HasFlag(attributes, VertexAttribute::TANGENT))
-		{
-			assert(primitive.targets[0].contains("TANGENT") && primitive.targets[1].contains("TANGENT"));
-			attributes |= VertexAttribute::MORPH_TARGET0_TANGENT;
-			attributes |= VertexAttribute::MORPH_TARGET1_TANGENT;
-		}
+		attributes |= VertexAttribute::MORPH_VERTEX;
 	}
 	
 	return attributes;
 }
 
-static int GetVertexSizeBytes(VertexAttribute attributes)
+// glTF name of the accessor an attribute is read from
+static const char* GetAttributeSource(VertexAttribute attribute)
 {
-	int size = 0;
-
-	for (const auto& pair : attributeByteSizes)
+	switch (attribute)
 	{
-		if (HasFlag(attributes, pair.first))
-		{
-			size += pair.second;
-		}
+	case VertexAttribute::POSITION: return "POSITION";
+	case VertexAttribute::TEXCOORD: return "TEXCOORD_0";
+	case VertexAttribute::NORMAL: return "NORMAL";
+	case VertexAttribute::WEIGHTS: return "WEIGHTS_0";
+	case VertexAttribute::JOINTS: return "JOINTS_0";
+	case VertexAttribute::TANGENT: return "TANGENT";
+	case VertexAttribute::COLOR: return "COLOR_0";
+	case VertexAttribute::MORPH_VERTEX: break; // Generated from the targets, no accessor holds it
 	}
-
-	return size;
+	assert(false && "Attribute not found");
+	return nullptr;
 }
 
-static void FillInterleavedBufferWithAttribute(std::vector<std::uint8_t>& interleavedBuffer, std::span<const std::uint8_t> attrData, int attrSizeBytes, int attrOffset, 
-	int vertexSizeBytes, int numVertices)
+static const tinygltf::Accessor& GetAttributeAccessor(const tinygltf::Primitive& primitive, VertexAttribute attribute, const tinygltf::Model& model)
 {
-	const std::uint8_t* attrDataPtr = attrData.data();
-
-	std::uint8_t* interleavedBufferAttrPtr = interleavedBuffer.data() + attrOffset;
-	const int interleavedAttributeStride = vertexSizeBytes;
-
-	for (int i = 0; i < numVertices; i++)
-	{
-		std::memcpy(interleavedBufferAttrPtr, attrDataPtr, attrSizeBytes);
-		interleavedBufferAttrPtr += interleavedAttributeStride;
-		attrDataPtr += attrSizeBytes;
-	}
+	return model.accessors[primitive.attributes.find(GetAttributeSource(attribute))->second];
 }
 
-static void FillInterleavedBufferWithAttribute(std::vector<std::uint8_t>& interleavedBuffer, const tinygltf::Accessor& accessor, int vertexSizeBytes, VertexAttribute attribute,
-	VertexAttribute attributes, const tinygltf::Model& model)
+// Every attribute keeps the component type of its accessor, so quantized data (KHR_mesh_quantization) stays quantized on
+// the GPU. Joints are the exception, they're always packed into one uint that the shaders unpack, and so is the morph
+// vertex index, which has no accessor.
+static VertexLayout GetVertexLayout(const tinygltf::Primitive& primitive, VertexAttribute attributes, const tinygltf::Model& model, bool generateTangents)
 {
-	// Positions, normals, and tangents are always float vec3 so we can always treat them the same, but the other types can have different component types
-	// so they need to be converted to a single type
-	switch (attribute)
+	VertexLayout layout;
+	for (int location = 0; location < vertexAttributeCount; location++)
 	{
-	case VertexAttribute::POSITION: case VertexAttribute::NORMAL: 
-	case VertexAttribute::MORPH_TARGET0_POSITION: case VertexAttribute::MORPH_TARGET1_POSITION:
-	case VertexAttribute::MORPH_TARGET0_NORMAL: case VertexAttribute::MORPH_TARGET1_NORMAL: 
-	case VertexAttribute::TANGENT: case VertexAttribute::MORPH_TARGET0_TANGENT: case VertexAttribute::MORPH_TARGET1_TANGENT: 
-		FillInterleavedBufferWithAttribute(interleavedBuffer, GetAccessorBytes(accessor, model), attributeByteSizes.find(attribute)->second, GetAttributeByteOffset(attributes, attribute), vertexSizeBytes, accessor.count);
-		break;
-	case VertexAttribute::WEIGHTS: case VertexAttribute::TEXCOORD:
-		assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && "Normalized unsigned byte and unsigned short not supported for now");
-		FillInterleavedBufferWithAttribute(interleavedBuffer, GetAccessorBytes(accessor, model), attributeByteSizes.find(attribute)->second, GetAttributeByteOffset(attributes, attribute), vertexSizeBytes, accessor.count);
-		break;
-	case VertexAttribute::JOINTS:
-		if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-		{
-			FillInterleavedBufferWithAttribute(interleavedBuffer, GetAccessorBytes(accessor, model), attributeByteSizes.find(attribute)->second, GetAttributeByteOffset(attributes, attribute), vertexSizeBytes, accessor.count);
-		}
-		else
+		const VertexAttribute attribute = (VertexAttribute)(1u << location);
+		if (!HasFlag(attributes, attribute))
 		{
-			assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
-
-			// Convert from unsigned short to unsigned byte
-			auto jointBytes = GetAccessorBytes(accessor, model);
-			std::span<glm::u16vec4> joints((glm::u16vec4*)jointBytes.data(), accessor.count);
-			std::vector<glm::u8vec4> jointsAsUnsignedBytes(accessor.count);
-			std::transform(joints.begin(), joints.end(), jointsAsUnsignedBytes.begin(),
-				[](glm::u16vec4 indices)
-				{
-					assert(indices.x < 255 && indices.y < 255 && indices.z < 255 && indices.w < 255);
-					return glm::u8vec4(indices);
-				});
-
-			std::span<const std::uint8_t> attrBytes((std::uint8_t*)jointsAsUnsignedBytes.data(), sizeof(glm::u8vec4) * jointsAsUnsignedBytes.size());
+			continue;
+		}
 
-			FillInterleavedBufferWithAttribute(interleavedBuffer, attrBytes, attributeByteSizes.find(attribute)->second, GetAttributeByteOffset(attributes, attribute), vertexSizeBytes, accessor.count);
+		VertexAttributeFormat& format = layout.attributes[location];
+		if (attribute == VertexAttribute::JOINTS || attribute == VertexAttribute::MORPH_VERTEX)
+		{
+			format = { .componentType = GL_UNSIGNED_INT, .componentCount = 1, .integer = 1 };
 		}
-		break;
-	case VertexAttribute::COLOR:
-		assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-		if (accessor.type == TINYGLTF_TYPE_VEC3) // convert to vec4
+		else if (attribute == VertexAttribute::TANGENT && generateTangents)
 		{
-			auto colorBytes = GetAccessorBytes(accessor, model);
-			std::span<glm::vec3> rgbColors((glm::vec3*)colorBytes.data(), accessor.count);
-			std::vector<glm::vec4> rgbaColors(accessor.count);
-			for (int i = 0; i < accessor.count; i++)
-			{
-				rgbaColors[i] = glm::vec4(rgbColors[i], 1.0f);
-			}
-			std::span<const std::uint8_t> rgbaBytes((std::uint8_t*)rgbaColors.data(), sizeof(glm::vec4) * accessor.count);
-			FillInterleavedBufferWithAttribute(interleavedBuffer, rgbaBytes, attributeByteSizes.find(attribute)->second, GetAttributeByteOffset(attributes, attribute), vertexSizeBytes, accessor.count);
+			format = { .componentType = GL_FLOAT, .componentCount = 4 };
 		}
-		else // format is already vec4
+		else
 		{
-			FillInterleavedBufferWithAttribute(interleavedBuffer, GetAccessorBytes(accessor, model), attributeByteSizes.find(attribute)->second, GetAttributeByteOffset(attributes, attribute), vertexSizeBytes, accessor.count);
+			const tinygltf::Accessor& accessor = GetAttributeAccessor(primitive, attribute, model);
+			assert(accessor.componentType != TINYGLTF_COMPONENT_TYPE_DOUBLE && accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
+			format.componentType = accessor.componentType;
+			format.componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+			format.normalized = accessor.normalized && accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT;
 		}
 	}
+	ComputeOffsets(layout);
+	return layout;
 }
 
-static std::vector<std::uint8_t> GetInterleavedVertexBuffer(const tinygltf::Primitive& primitive, VertexAttribute attributes, const tinygltf::Model& model, bool generateTangents)
+static void FillInterleavedBufferWithAttribute(std::vector<std::uint8_t>& interleavedBuffer, const tinygltf::Accessor& accessor, const VertexLayout& layout,
+	VertexAttribute attribute, const GLTFAsset& asset)
 {
-	assert(HasFlag(attributes, VertexAttribute::POSITION) && "Assuming all primitives have position attribute.");
+	// Read the accessor in place, wherever it lives in the glTF buffer. Only joints are converted, everything else is copied as is.
+	const AccessorView attrData(accessor, asset);
+	const VertexAttributeFormat& format = layout[attribute];
+	std::uint8_t* interleavedBufferAttrPtr = interleavedBuffer.data() + format.offset;
 
-	int vertexSizeBytes = GetVertexSizeBytes(attributes);
-
-	int positionAccessorIndex = primitive.attributes.find("POSITION")->second;
-	const tinygltf::Accessor& positionsAccessor = model.accessors[positionAccessorIndex];
-	const int numVertices = positionsAccessor.count;
-
-	std::vector<std::uint8_t> buffer(vertexSizeBytes * numVertices);
-
-	FillInterleavedBufferWithAttribute(buffer, positionsAccessor, vertexSizeBytes, VertexAttribute::POSITION, attributes, model);
-	
-	if (HasFlag(attributes, VertexAttribute::TEXCOORD))
+	if (attribute == VertexAttribute::JOINTS && accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
 	{
-		int tcAccessorIndex = primitive.attributes.find("TEXCOORD_0")->second;
-		const tinygltf::Accessor& tcAccessor = model.accessors[tcAccessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, tcAccessor, vertexSizeBytes, VertexAttribute::TEXCOORD, attributes, model);
+		// Convert from unsigned short to unsigned byte
+		for (int i = 0; i < attrData.count; i++)
+		{
+			const glm::u16vec4& indices = attrData.Get<glm::u16vec4>(i);
+			assert(indices.x < 255 && indices.y < 255 && indices.z < 255 && indices.w < 255);
+			glm::u8vec4 indicesAsUnsignedBytes(indices);
+			std::memcpy(interleavedBufferAttrPtr, &indicesAsUnsignedBytes, sizeof(indicesAsUnsignedBytes));
+			interleavedBufferAttrPtr += layout.stride;
+		}
+		return;
 	}
-	if (HasFlag(attributes, VertexAttribute::NORMAL))
+
+	assert(attribute == VertexAttribute::JOINTS ? accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE : attrData.elementSize <= GetAttributeSizeBytes(format));
+	for (int i = 0; i < attrData.count; i++)
 	{
-		int normalAccessorIndex = primitive.attributes.find("NORMAL")->second;
-		const tinygltf::Accessor& normalsAccessor = model.accessors[normalAccessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, normalsAccessor, vertexSizeBytes, VertexAttribute::NORMAL, attributes, model);
+		std::memcpy(interleavedBufferAttrPtr, attrData[i], attrData.elementSize);
+		interleavedBufferAttrPtr += layout.stride;
 	}
-	if (HasFlag(attributes, VertexAttribute::WEIGHTS))
-	{
-		assert(HasFlag(attributes, VertexAttribute::JOINTS));
+}
 
-		int weightsAccessorIndex = primitive.attributes.find("WEIGHTS_0")->second;
-		const tinygltf::Accessor& weightsAccessor = model.accessors[weightsAccessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, weightsAccessor, vertexSizeBytes, VertexAttribute::WEIGHTS, attributes, model);
+static std::vector<std::uint8_t> GetInterleavedVertexBuffer(const tinygltf::Primitive& primitive, VertexAttribute attributes, const VertexLayout& layout,
+	const GLTFAsset& asset, bool generateTangents)
+{
+	assert(HasFlag(attributes, VertexAttribute::POSITION) && "Assuming all primitives have position attribute.");
+	assert(!HasFlag(attributes, VertexAttribute::WEIGHTS) || HasFlag(attributes, VertexAttribute::JOINTS));
 
-		int jointsAccessorIndex = primitive.attributes.find("JOINTS_0")->second;
-		const tinygltf::Accessor& jointsAccessor = model.accessors[jointsAccessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, jointsAccessor, vertexSizeBytes, VertexAttribute::JOINTS, attributes, model);
-	}
-	if (HasFlag(attributes, VertexAttribute::MORPH_TARGET0_POSITION))
-	{
-		int accessorIndex = primitive.targets[0].find("POSITION")->second;
-		const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, accessor, vertexSizeBytes, VertexAttribute::MORPH_TARGET0_POSITION, attributes, model);
-	}
-	if (HasFlag(attributes, VertexAttribute::MORPH_TARGET1_POSITION))
-	{
-		int accessorIndex = primitive.targets[1].find("POSITION")->second;
-		const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, accessor, vertexSizeBytes, VertexAttribute::MORPH_TARGET1_POSITION, attributes, model);
-	}
-	if (HasFlag(attributes, VertexAttribute::MORPH_TARGET0_NORMAL))
-	{
-		int accessorIndex = primitive.targets[0].find("NORMAL")->second;
-		const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, accessor, vertexSizeBytes, VertexAttribute::MORPH_TARGET0_NORMAL, attributes, model);
-	}
-	if (HasFlag(attributes, VertexAttribute::MORPH_TARGET1_NORMAL))
-	{
-		int accessorIndex = primitive.targets[1].find("NORMAL")->second;
-		const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, accessor, vertexSizeBytes, VertexAttribute::MORPH_TARGET1_NORMAL, attributes, model);
-	}
-	if (HasFlag(attributes, VertexAttribute::TANGENT) && !generateTangents)
-	{
-		int tangentAccessorIndex = primitive.attributes.find("TANGENT")->second;
-		const tinygltf::Accessor& tangentAccessor = model.accessors[tangentAccessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, tangentAccessor, vertexSizeBytes, VertexAttribute::TANGENT, attributes, model);
-	}
-	if (HasFlag(attributes, VertexAttribute::MORPH_TARGET0_TANGENT))
-	{
-		int accessorIndex = primitive.targets[0].find("TANGENT")->second;
-		const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, accessor, vertexSizeBytes, VertexAttribute::MORPH_TARGET0_TANGENT, attributes, model);
-	}
-	if (HasFlag(attributes, VertexAttribute::MORPH_TARGET1_TANGENT))
-	{
-		int accessorIndex = primitive.targets[1].find("TANGENT")->second;
-		const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, accessor, vertexSizeBytes, VertexAttribute::MORPH_TARGET1_TANGENT, attributes, model);
-	}
-	if (HasFlag(attributes, VertexAttribute::COLOR))
+	const tinygltf::Accessor& positionsAccessor = GetAttributeAccessor(primitive, VertexAttribute::POSITION, asset.model);
+	const int numVertices = positionsAccessor.count;
+
+	std::vector<std::uint8_t> buffer((std::size_t)layout.stride * numVertices);
+	for (int location = 0; location < vertexAttributeCount; location++)
 	{
-		int accessorIndex = primitive.attributes.find("COLOR_0")->second;
-		const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-		FillInterleavedBufferWithAttribute(buffer, accessor, vertexSizeBytes, VertexAttribute::COLOR, attributes, model);
+		const VertexAttribute attribute = (VertexAttribute)(1u << location);
+		if (attribute == VertexAttribute::MORPH_VERTEX && HasFlag(attributes, attribute))
+		{
+			// Travels with the vertex through welding and reordering, so it always finds the vertex's deltas.
+			// SplitForShortIndices renumbers it per cluster.
+			for (std::uint32_t i = 0; i < (std::uint32_t)numVertices; i++)
+			{
+				std::memcpy(buffer.data() + (std::size_t)i * layout.stride + layout[attribute].offset, &i, sizeof(i));
+			}
+		}
+		else if (HasFlag(attributes, attribute) && !(attribute == VertexAttribute::TANGENT && generateTangents))
+		{
+			FillInterleavedBufferWithAttribute(buffer, GetAttributeAccessor(primitive, attribute, asset.model), layout, attribute, asset);
+		}
 	}
 
 	return buffer;
 }
 
-static std::vector<std::uint32_t> GetIndexBuffer(const tinygltf::Primitive& primitive, const tinygltf::Model& model, int offset)
+static std::vector<std::uint32_t> GetIndexBuffer(const tinygltf::Primitive& primitive, const GLTFAsset& asset)
 {
-	const tinygltf::Accessor& indicesAccessor = model.accessors[primitive.indices];
-	auto indicesAccessorBytes = GetAccessorBytes(indicesAccessor, model);
+	const tinygltf::Accessor& indicesAccessor = asset.model.accessors[primitive.indices];
+	const AccessorView indices(indicesAccessor, asset);
 	std::vector<std::uint32_t> indexBuffer(indicesAccessor.count);
 	int componentSizeBytes = tinygltf::GetComponentSizeInBytes(indicesAccessor.componentType);
 
 	if (componentSizeBytes == 4)
 	{
-		std::span<std::uint32_t> indicesAccessorData((std::uint32_t*)(indicesAccessorBytes.data()), indicesAccessor.count);
-		std::transform(indicesAccessorData.begin(), indicesAccessorData.end(), indexBuffer.begin(), 
-			[offset](std::uint32_t index) { return index + offset; });
+		for (int i = 0; i < indices.count; i++)
+		{
+			indexBuffer[i] = indices.Get<std::uint32_t>(i);
+		}
 	}
 	else if (componentSizeBytes == 2)
 	{
-		std::span<std::uint16_t> indicesAccessorData((std::uint16_t*)(indicesAccessorBytes.data()), indicesAccessor.count);
-		std::transform(indicesAccessorData.begin(), indicesAccessorData.end(), indexBuffer.begin(),
-			[offset](std::uint16_t index) { return std::uint32_t(index) + offset; });
+		for (int i = 0; i < indices.count; i++)
+		{
+			indexBuffer[i] = std::uint32_t(indices.Get<std::uint16_t>(i));
+		}
 	}
 	else
 	{
 		assert(componentSizeBytes == 1 && "Invalid index buffer component size.");
-		std::span<std::uint8_t> indicesAccessorData((std::uint8_t*)(indicesAccessorBytes.data()), indicesAccessor.count);
-		std::transform(indicesAccessorData.begin(), indicesAccessorData.end(), indexBuffer.begin(),
-			[offset](std::uint8_t index) { return std::uint32_t(index) + offset; });
+		for (int i = 0; i < indices.count; i++)
+		{
+			indexBuffer[i] = std::uint32_t(indices.Get<std::uint8_t>(i));
+		}
 	}
 	
 	return indexBuffer;
 }
 
-static BBox ComputeBoundingBox(const std::vector<std::uint8_t>& vertexBuffer, int stride)
+// Most vertices a primitive can have and still use 16 bit indices
+static constexpr std::size_t maxShortIndexVertices = 65536;
+
+// 16 bit indices whenever they can address every vertex. 8 bit ones aren't used, most GPUs handle them poorly.
+static std::vector<std::uint8_t> PackIndices(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, GLenum& indexType)
+{
+	std::vector<std::uint8_t> packed;
+	if (vertexCount <= maxShortIndexVertices)
+	{
+		indexType = GL_UNSIGNED_SHORT;
+		const std::vector<std::uint16_t> shortIndices(indices.begin(), indices.end());
+		packed.resize(shortIndices.size() * sizeof(std::uint16_t));
+		std::memcpy(packed.data(), shortIndices.data(), packed.size());
+	}
+	else
+	{
+		indexType = GL_UNSIGNED_INT;
+		packed.resize(indices.size() * sizeof(std::uint32_t));
+		std::memcpy(packed.data(), indices.data(), packed.size());
+	}
+	return packed;
+}
+
+static BBox ComputeBoundingBox(const std::vector<std::uint8_t>& vertexBuffer, const VertexLayout& layout)
 {
-	// assumes positions are at offset 0
 	BBox bbox{
 		.minXYZ = glm::vec3(FLT_MAX),
 		.maxXYZ = glm::vec3(-FLT_MAX)
 	};
 
-	const std::uint8_t* vertexBufferPtr = vertexBuffer.data();
-	const std::uint8_t* vertexBufferPtrEnd = vertexBuffer.data() + vertexBuffer.size();
-	while (vertexBufferPtr < vertexBufferPtrEnd)
+	const VertexAttributeFormat& positionFormat = layout[VertexAttribute::POSITION];
+	for (std::size_t offset = 0; offset < vertexBuffer.size(); offset += layout.stride)
 	{
-		const glm::vec3* pos = reinterpret_cast<const glm::vec3*>(vertexBufferPtr);
-
-		bbox.minXYZ = glm::min(*pos, bbox.minXYZ);
-		bbox.maxXYZ = glm::max(*pos, bbox.maxXYZ);
-
-		vertexBufferPtr += stride;
+		const glm::vec3 pos = ReadAttribute(vertexBuffer.data() + offset, positionFormat);
+		bbox.minXYZ = glm::min(pos, bbox.minXYZ);
+		bbox.maxXYZ = glm::max(pos, bbox.maxXYZ);
 	}
 
 	return bbox;
 }
 
-static void GenerateTangents(std::vector<std::uint8_t>& vertexBuffer, const std::vector<std::uint32_t>* indexBuffer, VertexAttribute attributes)
+static void GenerateTangentsMikkTSpace(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& texCoords,
+	const std::vector<std::uint32_t>* indexBuffer, std::vector<glm::vec4>& tangents)
 {
-	assert(HasFlag(attributes, VertexAttribute::NORMAL | VertexAttribute::TEXCOORD | VertexAttribute::TANGENT) && "Must have normals and texture coordinates to generate tangents");
-
 	SMikkTSpaceInterface mikktInterface{};
 
 	SMikkTSpaceContext context{};
 	struct UserData
 	{
-		std::vector<std::uint8_t>& vb; 
-		const std::vector<std::uint32_t>* ib; 
-		VertexAttribute attributes;
-		int stride;
-		int texcoordOffsetBytes;
-		int normalOffsetBytes;
-		int tangentOffsetBytes;
+		const std::vector<glm::vec3>& positions;
+		const std::vector<glm::vec3>& normals;
+		const std::vector<glm::vec2>& texCoords;
+		std::vector<glm::vec4>& tangents;
+		const std::uint32_t* ib;
+		int faceCount;
+
+		std::uint32_t Vertex(int iFace, int iVert) const
+		{
+			return ib ? ib[iFace * 3 + iVert] : iFace * 3 + iVert;
+		}
 	};
-	UserData userData{ vertexBuffer, indexBuffer, attributes, GetVertexSizeBytes(attributes), 
-					   GetAttributeByteOffset(attributes, VertexAttribute::TEXCOORD), GetAttributeByteOffset(attributes, VertexAttribute::NORMAL),
-					   GetAttributeByteOffset(attributes, VertexAttribute::TANGENT) };
+	UserData userData{ positions, normals, texCoords, tangents, indexBuffer ? indexBuffer->data() : nullptr,
+		(int)(indexBuffer ? indexBuffer->size() : positions.size()) / 3 };
 	context.m_pUserData = &userData;
 	context.m_pInterface = &mikktInterface;
 
-	mikktInterface.m_getNumFaces = 
-	[](const SMikkTSpaceContext* pContext) 
+	mikktInterface.m_getNumFaces = [](const SMikkTSpaceContext* pContext) { return static_cast<const UserData*>(pContext->m_pUserData)->faceCount; };
+	mikktInterface.m_getNumVerticesOfFace = [](const SMikkTSpaceContext*, int) { return 3; }; // Assuming triangles
+
+	mikktInterface.m_getPosition =
+	[](const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert)
 	{
-		auto userData = static_cast<UserData*>(pContext->m_pUserData);
-		if (userData->ib != nullptr) return (int)userData->ib->size() / 3;
-		return (int)userData->vb.size() / 3;
+		auto userData = static_cast<const UserData*>(pContext->m_pUserData);
+		std::memcpy(fvPosOut, &userData->positions[userData->Vertex(iFace, iVert)], sizeof(glm::vec3));
 	};
-	mikktInterface.m_getNumVerticesOfFace = [](const SMikkTSpaceContext*, int) { return 3; }; // Assuming triangles
-	if (indexBuffer != nullptr)
+
+	mikktInterface.m_getNormal =
+	[](const SMikkTSpaceContext* pContext, float fvNormOut[], const int iFace, const int iVert)
 	{
-		mikktInterface.m_getPosition =
-		[](const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert)
-		{
-			auto userData = static_cast<const UserData*>(pContext->m_pUserData);
-			std::uint32_t index = (*userData->ib)[iFace * 3 + iVert];
-			const glm::vec3* pos = reinterpret_cast<const glm::vec3*>(&userData->vb[index * userData->stride]);
-			fvPosOut[0] = pos->x;
-			fvPosOut[1] = pos->y;
-			fvPosOut[2] = pos->z;
-		};
+		auto userData = static_cast<const UserData*>(pContext->m_pUserData);
+		std::memcpy(fvNormOut, &userData->normals[userData->Vertex(iFace, iVert)], sizeof(glm::vec3));
+	};
 
-		mikktInterface.m_getNormal =
-			[](const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert)
-		{
-			auto userData = static_cast<const UserData*>(pContext->m_pUserData);
-			std::uint32_t index = (*userData->ib)[iFace * 3 + iVert];
-			const glm::vec3* normal = reinterpret_cast<const glm::vec3*>(&userData->vb[(index * userData->stride) + userData->normalOffsetBytes]);
-			fvPosOut[0] = normal->x;
-			fvPosOut[1] = normal->y;
-			fvPosOut[2] = normal->z;
-		};
+	mikktInterface.m_getTexCoord =
+	[](const SMikkTSpaceContext* pContext, float fvTexcOut[], const int iFace, const int iVert)
+	{
+		auto userData = static_cast<const UserData*>(pContext->m_pUserData);
+		std::memcpy(fvTexcOut, &userData->texCoords[userData->Vertex(iFace, iVert)], sizeof(glm::vec2));
+	};
 
-		mikktInterface.m_getTexCoord =
-			[](const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert)
-		{
-			auto userData = static_cast<const UserData*>(pContext->m_pUserData);
-			std::uint32_t index = (*userData->ib)[iFace * 3 + iVert];
-			const glm::vec2* texCoord = reinterpret_cast<const glm::vec2*>(&userData->vb[(index * userData->stride) + userData->texcoordOffsetBytes]);
-			fvPosOut[0] = texCoord->x;
-			fvPosOut[1] = texCoord->y;
-		};
+	mikktInterface.m_setTSpaceBasic =
+	[](const SMikkTSpaceContext* pContext, const float fvTangent[], const float fSign, const int iFace, const int iVert)
+	{
+		auto userData = static_cast<const UserData*>(pContext->m_pUserData);
+		userData->tangents[userData->Vertex(iFace, iVert)] = glm::vec4(fvTangent[0], fvTangent[1], fvTangent[2], fSign);
+	};
+
+	genTangSpaceDefault(&context);
+}
+
+// Lengyel's method: every triangle adds its UV aligned tangent and bitangent to its vertices, unnormalized so bigger
+// triangles weigh more, then each vertex's tangent is Gram-Schmidt orthonormalized against its normal. Vertices are
+// never split, so a vertex on a UV mirror seam ends up with an averaged tangent where MikkTSpace would split it.
+static void GenerateTangentsFast(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& texCoords,
+	const std::vector<std::uint32_t>* indexBuffer, std::vector<glm::vec4>& tangents)
+{
+	const std::size_t vertexCount = positions.size();
+	const std::size_t cornerCount = indexBuffer ? indexBuffer->size() : vertexCount;
+
+	// Structure of arrays, so the orthonormalization loop below vectorizes
+	std::vector<float> tx(vertexCount), ty(vertexCount), tz(vertexCount);
+	std::vector<float> bx(vertexCount), by(vertexCount), bz(vertexCount);
+	for (std::size_t corner = 0; corner + 2 < cornerCount; corner += 3)
+	{
+		const std::uint32_t i0 = indexBuffer ? (*indexBuffer)[corner] : (std::uint32_t)corner;
+		const std::uint32_t i1 = indexBuffer ? (*indexBuffer)[corner + 1] : (std::uint32_t)corner + 1;
+		const std::uint32_t i2 = indexBuffer ? (*indexBuffer)[corner + 2] : (std::uint32_t)corner + 2;
+
+		const glm::vec3 e1 = positions[i1] - positions[i0];
+		const glm::vec3 e2 = positions[i2] - positions[i0];
+		const glm::vec2 d1 = texCoords[i1] - texCoords[i0];
+		const glm::vec2 d2 = texCoords[i2] - texCoords[i0];
+		const float det = d1.x * d2.y - d2.x * d1.y;
+		if (det == 0.0f)
+		{
+			continue;
+		}
 
-		mikktInterface.m_setTSpaceBasic =
-			[](const SMikkTSpaceContext* pContext, const float fvTangent[], const float fSign, const int iFace, const int iVert)
+		// Scaled by |det| rather than divided by det, which keeps the triangle's area weighting and flips to the right side
+		const float sign = det < 0.0f ? -1.0f : 1.0f;
+		const glm::vec3 t = (e1 * d2.y - e2 * d1.y) * sign;
+		const glm::vec3 b = (e2 * d1.x - e1 * d2.x) * sign;
+		for (const std::uint32_t i : { i0, i1, i2 })
 		{
-			auto userData = static_cast<const UserData*>(pContext->m_pUserData);
-			std::uint32_t index = (*userData->ib)[iFace * 3 + iVert];
-			glm::vec4* tangent = reinterpret_cast<glm::vec4*>(&userData->vb[(index * userData->stride) + userData->tangentOffsetBytes]);
-			tangent->x = fvTangent[0];
-			tangent->y = fvTangent[1];
-			tangent->z = fvTangent[2];
-			tangent->w = fSign;
-		};
+			tx[i] += t.x; ty[i] += t.y; tz[i] += t.z;
+			bx[i] += b.x; by[i] += b.y; bz[i] += b.z;
+		}
+	}
+
+	std::vector<float> nx(vertexCount), ny(vertexCount), nz(vertexCount), w(vertexCount);
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		nx[i] = normals[i].x;
+		ny[i] = normals[i].y;
+		nz[i] = normals[i].z;
+	}
+
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		const float nDotT = nx[i] * tx[i] + ny[i] * ty[i] + nz[i] * tz[i];
+		float x = tx[i] - nx[i] * nDotT;
+		float y = ty[i] - ny[i] * nDotT;
+		float z = tz[i] - nz[i] * nDotT;
+		const float lengthSquared = x * x + y * y + z * z;
+		const float invLength = lengthSquared > 1e-20f ? 1.0f / std::sqrt(lengthSquared) : 0.0f;
+		tx[i] = x * invLength;
+		ty[i] = y * invLength;
+		tz[i] = z * invLength;
+
+		// Handedness of (t, b, n), dot(cross(n, t), b)
+		const float cx = ny[i] * z - nz[i] * y;
+		const float cy = nz[i] * x - nx[i] * z;
+		const float cz = nx[i] * y - ny[i] * x;
+		w[i] = cx * bx[i] + cy * by[i] + cz * bz[i] < 0.0f ? -1.0f : 1.0f;
+	}
+
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		tangents[i] = glm::vec4(tx[i], ty[i], tz[i], w[i]);
+		if (tangents[i].x == 0.0f && tangents[i].y == 0.0f && tangents[i].z == 0.0f)
+		{
+			// No triangle with usable UVs touches the vertex, any unit vector perpendicular to the normal does
+			const glm::vec3 axis = std::abs(normals[i].x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			const glm::vec3 tangent = glm::cross(normals[i], axis);
+			const float length = glm::length(tangent);
+			tangents[i] = glm::vec4(length > 0.0f ? tangent / length : axis, 1.0f);
+		}
+	}
+}
+
+void GenerateTangents(std::vector<std::uint8_t>& vertexBuffer, const std::vector<std::uint32_t>* indexBuffer, const VertexLayout& layout,
+	TangentGenerator generator, TangentCache* tangentCache)
+{
+	assert(layout[VertexAttribute::NORMAL].componentType != 0 && layout[VertexAttribute::TEXCOORD].componentType != 0 &&
+		layout[VertexAttribute::TANGENT].componentType != 0 && "Must have normals and texture coordinates to generate tangents");
+
+	// Attributes can be quantized, so they're decoded to floats once up front. MikkTSpace asks for each corner's
+	// attributes several times.
+	const std::size_t vertexCount = vertexBuffer.size() / layout.stride;
+	std::vector<glm::vec3> positions(vertexCount);
+	std::vector<glm::vec3> normals(vertexCount);
+	std::vector<glm::vec2> texCoords(vertexCount);
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		const std::uint8_t* vertex = vertexBuffer.data() + i * layout.stride;
+		positions[i] = glm::vec3(ReadAttribute(vertex, layout[VertexAttribute::POSITION]));
+		normals[i] = glm::vec3(ReadAttribute(vertex, layout[VertexAttribute::NORMAL]));
+		texCoords[i] = glm::vec2(ReadAttribute(vertex, layout[VertexAttribute::TEXCOORD]));
+	}
+
+	std::vector<glm::vec4> tangents(vertexCount, glm::vec4(0.0f));
+	if (generator == TangentGenerator::Fast)
+	{
+		// Costs about as much as hashing the inputs, so it isn't cached
+		GenerateTangentsFast(positions, normals, texCoords, indexBuffer, tangents);
+	}
+	else if (!tangentCache)
+	{
+		GenerateTangentsMikkTSpace(positions, normals, texCoords, indexBuffer, tangents);
 	}
 	else
 	{
-		mikktInterface.m_getPosition =
-			[](const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert)
+		// Identical inputs hash to the same key, whichever asset or build options they came from
+		auto hashVector = [](const auto& vector)
 		{
-			auto userData = static_cast<const UserData*>(pContext->m_pUserData);
-			int index = iFace * 3 + iVert;
-			const glm::vec3* pos = reinterpret_cast<const glm::vec3*>(&userData->vb[index * userData->stride]);
-			fvPosOut[0] = pos->x;
-			fvPosOut[1] = pos->y;
-			fvPosOut[2] = pos->z;
+			return HashBytes({ (const std::uint8_t*)vector.data(), vector.size() * sizeof(vector[0]) });
 		};
+		std::uint64_t key = hashVector(positions);
+		key = key * 31 + hashVector(normals);
+		key = key * 31 + hashVector(texCoords);
+		key = key * 31 + (indexBuffer ? hashVector(*indexBuffer) : 0);
 
-		mikktInterface.m_getNormal =
-			[](const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert)
+		if (!tangentCache->Find(key, vertexCount, tangents))
 		{
-			auto userData = static_cast<const UserData*>(pContext->m_pUserData);
-			int index = iFace * 3 + iVert;
-			const glm::vec3* normal = reinterpret_cast<const glm::vec3*>(&userData->vb[(index * userData->stride) + userData->normalOffsetBytes]);
-			fvPosOut[0] = normal->x;
-			fvPosOut[1] = normal->y;
-			fvPosOut[2] = normal->z;
-		};
+			GenerateTangentsMikkTSpace(positions, normals, texCoords, indexBuffer, tangents);
+			tangentCache->Insert(key, tangents);
+		}
+	}
 
-		mikktInterface.m_getTexCoord =
-			[](const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert)
-		{
-			auto userData = static_cast<const UserData*>(pContext->m_pUserData);
-			int index = iFace * 3 + iVert;
-			const glm::vec2* texCoord = reinterpret_cast<const glm::vec2*>(&userData->vb[(index * userData->stride) + userData->texcoordOffsetBytes]);
-			fvPosOut[0] = texCoord->x;
-			fvPosOut[1] = texCoord->y;
-		};
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		WriteAttribute(vertexBuffer.data() + i * layout.stride, layout[VertexAttribute::TANGENT], tangents[i]);
+	}
+}
 
-		mikktInterface.m_setTSpaceBasic =
-			[](const SMikkTSpaceContext* pContext, const float fvTangent[], const float fSign, const int iFace, const int iVert)
-		{
-			auto userData = static_cast<const UserData*>(pContext->m_pUserData);
-			int index = iFace * 3 + iVert;
-			glm::vec4* tangent = reinterpret_cast<glm::vec4*>(&userData->vb[(index * userData->stride) + userData->tangentOffsetBytes]);
-			tangent->x = fvTangent[0];
-			tangent->y = fvTangent[1];
-			tangent->z = fvTangent[2];
-			tangent->w = fSign;
-		};
+// Texcoords outside [-maxHalfTexcoord, maxHalfTexcoord] stay as they are, half floats get too coarse for tiled textures
+static constexpr float maxHalfTexcoord = 4.0f;
+
+// Maps a unit vector onto the [-1, 1] square by projecting it on the octahedron and folding the lower half over
+static glm::vec2 OctahedralEncode(glm::vec3 v)
+{
+	const float sum = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+	if (sum == 0.0f)
+	{
+		return glm::vec2(0.0f);
 	}
+	v /= sum;
+	if (v.z < 0.0f)
+	{
+		return glm::vec2((1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f));
+	}
+	return glm::vec2(v.x, v.y);
+}
 
-	genTangSpaceDefault(&context);
+// Octahedral tangent as two 16 bit snorms, with the bitangent sign in the lowest bit of y. Decoded in default.vert.
+static void WriteCompactTangent(std::uint8_t* destination, const glm::vec4& tangent)
+{
+	const glm::vec2 encoded = OctahedralEncode(glm::vec3(tangent));
+	std::int16_t packed[2] = { (std::int16_t)std::round(encoded.x * 32767.0f), (std::int16_t)std::round(encoded.y * 32767.0f) };
+	packed[1] = (std::int16_t)((packed[1] & ~1) | (tangent.w < 0.0f ? 1 : 0));
+	std::memcpy(destination, packed, sizeof(packed));
 }
 
-// Create one interleaved vertex buffer that contains the vertices of all the mesh's primitives
-Mesh::Mesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model)
+static bool TexcoordsFitInHalf(const std::vector<std::uint8_t>& vertexBuffer, const VertexLayout& layout)
 {
-	assert(mesh.primitives.size() > 0);
+	const VertexAttributeFormat& format = layout[VertexAttribute::TEXCOORD];
+	for (std::size_t offset = 0; offset < vertexBuffer.size(); offset += layout.stride)
+	{
+		const glm::vec4 texcoord = ReadAttribute(vertexBuffer.data() + offset, format);
+		if (std::abs(texcoord.x) > maxHalfTexcoord || std::abs(texcoord.y) > maxHalfTexcoord)
+		{
+			return false;
+		}
+	}
+	return true;
+}
 
-	for (const tinygltf::Primitive& primitive : mesh.primitives)
+static VertexLayout GetCompactVertexLayout(const std::vector<std::uint8_t>& vertexBuffer, const VertexLayout& layout)
+{
+	VertexLayout compact = layout;
+	for (int location = 0; location < vertexAttributeCount; location++)
 	{
-		assert(primitive.mode == GL_TRIANGLES);
+		VertexAttributeFormat& format = compact.attributes[location];
+		if (format.componentType == 0)
+		{
+			continue;
+		}
 
-		submeshes.emplace_back();
-		Submesh& submesh = submeshes.back();
+		switch ((VertexAttribute)(1u << location))
+		{
+		case VertexAttribute::NORMAL:
+			format = { .componentType = GL_SHORT, .componentCount = 2, .normalized = 1 };
+			break;
+		case VertexAttribute::TANGENT:
+			format = { .componentType = GL_SHORT, .componentCount = 2, .integer = 1 };
+			break;
+		case VertexAttribute::TEXCOORD:
+			if (format.componentType == GL_FLOAT && TexcoordsFitInHalf(vertexBuffer, layout)) format = { .componentType = GL_HALF_FLOAT, .componentCount = 2 };
+			break;
+		default:
+			break;
+		}
+	}
+	ComputeOffsets(compact);
+	return compact;
+}
 
-		submesh.flags = GetPrimitiveVertexLayout(primitive);
-		bool hasJoints = HasFlag(submesh.flags, VertexAttribute::JOINTS);
-		bool hasMorphTargets = HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET0_POSITION);
-		assert((!hasJoints && !hasMorphTargets) || (hasJoints != hasMorphTargets) && "Morph targets and skeletal animation on same mesh not supported");
+static bool SameFormat(const VertexAttributeFormat& a, const VertexAttributeFormat& b)
+{
+	return a.componentType == b.componentType && a.componentCount == b.componentCount && a.normalized == b.normalized && a.integer == b.integer;
+}
+
+static std::vector<std::uint8_t> RepackVertices(const std::vector<std::uint8_t>& vertexBuffer, const VertexLayout& from, const VertexLayout& to)
+{
+	const std::size_t vertexCount = vertexBuffer.size() / from.stride;
+	std::vector<std::uint8_t> repacked(vertexCount * to.stride);
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		const std::uint8_t* source = vertexBuffer.data() + i * from.stride;
+		std::uint8_t* destination = repacked.data() + i * to.stride;
+		for (int location = 0; location < vertexAttributeCount; location++)
+		{
+			const VertexAttributeFormat& fromFormat = from.attributes[location];
+			const VertexAttributeFormat& toFormat = to.attributes[location];
+			const VertexAttribute attribute = (VertexAttribute)(1u << location);
+			if (toFormat.componentType == 0)
+			{
+				continue;
+			}
 
-		submesh.materialIndex = primitive.material;
-		bool hasMaterial = submesh.materialIndex >= 0;
-		bool hasNormals = HasFlag(submesh.flags, VertexAttribute::NORMAL);
-		submesh.flatShading = hasMaterial && !hasNormals;
+			// Unchanged attributes are copied, which also keeps packed joints exact
+			if (SameFormat(fromFormat, toFormat))
+			{
+				std::memcpy(destination + toFormat.offset, source + fromFormat.offset, GetAttributeSizeBytes(toFormat));
+				continue;
+			}
 
-		bool hasTangents = HasFlag(submesh.flags, VertexAttribute::TANGENT);
-		assert(!hasTangents || hasNormals && "Primitive with tangents must also has normals");
-		
-		bool hasNormalMap = primitive.material >= 0 && model.materials[primitive.material].normalTexture.index >= 0;
-		bool generateTangents = !hasTangents && hasNormalMap;
-		if (generateTangents)
-		{
-			// TODO: generate tangents for morph targets
-			assert(!hasMorphTargets && "Generating tangents with morph targets not currently supported");
-			submesh.flags |= VertexAttribute::TANGENT;
+			const glm::vec4 value = ReadAttribute(source, fromFormat);
+			if (attribute == VertexAttribute::NORMAL)
+			{
+				WriteAttribute(destination, toFormat, glm::vec4(OctahedralEncode(glm::vec3(value)), 0.0f, 0.0f));
+			}
+			else if (attribute == VertexAttribute::TANGENT)
+			{
+				WriteCompactTangent(destination + toFormat.offset, value);
+			}
+			else
+			{
+				WriteAttribute(destination, toFormat, value);
+			}
 		}
+	}
+	return repacked;
+}
 
-		bool discardTangents = hasTangents && !hasNormalMap; // wtf is the point?
-		if (discardTangents)
+// Deltas of every target, [target][vertex][position, normal, tangent], as texels of submesh.MorphDeltaFormat(). Only the
+// normal and tangent deltas of attributes the submesh keeps are stored.
+static std::vector<std::uint8_t> GetMorphTargetDeltas(const tinygltf::Primitive& primitive, const GLTFAsset& asset, SubmeshInfo& submesh,
+	bool generatedTangents)
+{
+	const bool morphNormals = HasFlag(submesh.flags, VertexAttribute::NORMAL);
+	const bool morphTangents = HasFlag(submesh.flags, VertexAttribute::TANGENT) && !generatedTangents;
+	submesh.morphTargetCount = (int)primitive.targets.size();
+	submesh.morphVertexCount = (int)GetAttributeAccessor(primitive, VertexAttribute::POSITION, asset.model).count;
+	submesh.morphDeltaStride = 1 + morphNormals + morphTangents;
+
+	const bool compact = HasFlag(submesh.flags, VertexAttribute::COMPACT);
+	const VertexAttributeFormat texelFormat = compact ? VertexAttributeFormat{ .componentType = GL_HALF_FLOAT, .componentCount = 4 } :
+		VertexAttributeFormat{ .componentType = GL_FLOAT, .componentCount = 3 };
+	const std::size_t texelSize = GetAttributeSizeBytes(texelFormat);
+
+	std::vector<std::uint8_t> deltas((std::size_t)submesh.morphTargetCount * submesh.morphVertexCount * submesh.morphDeltaStride * texelSize);
+	for (int target = 0; target < submesh.morphTargetCount; target++)
+	{
+		// Tangents always come with normals, so a component's index is enough to know which attribute it is
+		const char* names[] = { "POSITION", "NORMAL", "TANGENT" };
+		for (int component = 0; component < submesh.morphDeltaStride; component++)
 		{
-			submesh.flags &= ~VertexAttribute::TANGENT;
+			// Targets may leave out any attribute, its deltas are zero then
+			const auto accessorIdx = primitive.targets[target].find(names[component]);
+			if (accessorIdx == primitive.targets[target].end())
+			{
+				continue;
+			}
+
+			const tinygltf::Accessor& accessor = asset.model.accessors[accessorIdx->second];
+			assert(accessor.count == submesh.morphVertexCount);
+			const AccessorView view(accessor, asset);
+			const VertexAttributeFormat format = { .componentType = (std::uint32_t)accessor.componentType, .componentCount = 3,
+				.normalized = accessor.normalized && accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT };
+			std::uint8_t* texel = deltas.data() + ((std::size_t)target * submesh.morphVertexCount * submesh.morphDeltaStride + component) * texelSize;
+			for (int i = 0; i < view.count; i++)
+			{
+				WriteAttribute(texel, texelFormat, ReadAttribute(view[i], format));
+				texel += submesh.morphDeltaStride * texelSize;
+			}
 		}
+	}
+	return deltas;
+}
 
-		int submeshVertexSizeBytes = GetVertexSizeBytes(submesh.flags);
-		std::vector<std::uint8_t> submeshVertexBuffer = GetInterleavedVertexBuffer(primitive, submesh.flags, model, generateTangents);
+// Fraction of the vertices a target can move and still be stored sparsely. Sparse entries cost a target index on top of
+// their deltas, and vertex shaders an extra fetch to find them.
+static constexpr float maxSparseMorphTargetDensity = 0.25f;
 
-		submesh.hasIndexBuffer = primitive.indices >= 0;
-		std::vector<std::uint32_t> primitiveIndexBuffer;
-		if (submesh.hasIndexBuffer)
-		{
-			primitiveIndexBuffer = GetIndexBuffer(primitive, model, 0);
-			submesh.countVerticesOrIndices = primitiveIndexBuffer.size();
-		}
-		else
+// Rewrites dense deltas from GetMorphTargetDeltas into the dense and sparse layout described in Mesh.h, dropping the zero
+// deltas of every target that moves few enough vertices
+static void SparsifyMorphTargetDeltas(SubmeshData& data)
+{
+	SubmeshInfo& submesh = data.submesh;
+	const std::size_t vertexDeltaSize = data.morphDeltas.size() / ((std::size_t)submesh.morphTargetCount * submesh.morphVertexCount);
+	auto vertexDeltas = [&](int target, int vertex) { return data.morphDeltas.data() + ((std::size_t)target * submesh.morphVertexCount + vertex) * vertexDeltaSize; };
+	auto isZero = [&](const std::uint8_t* deltas) { return std::all_of(deltas, deltas + vertexDeltaSize, [](std::uint8_t byte) { return byte == 0; }); };
+
+	std::vector<std::uint8_t> sparse(submesh.morphTargetCount);
+	std::vector<std::uint32_t> denseTargets;
+	for (int target = 0; target < submesh.morphTargetCount; target++)
+	{
+		int movedVertices = 0;
+		for (int vertex = 0; vertex < submesh.morphVertexCount; vertex++)
 		{
-			submesh.countVerticesOrIndices = submeshVertexBuffer.size() / submeshVertexSizeBytes;
+			movedVertices += !isZero(vertexDeltas(target, vertex));
 		}
+		sparse[target] = movedVertices <= maxSparseMorphTargetDensity * submesh.morphVertexCount;
+		if (!sparse[target]) denseTargets.push_back(target);
+	}
 
-		if (generateTangents)
+	std::vector<std::uint8_t> deltas;
+	data.morphIndices = denseTargets;
+	for (std::uint32_t target : denseTargets)
+	{
+		deltas.insert(deltas.end(), vertexDeltas(target, 0), vertexDeltas(target, 0) + submesh.morphVertexCount * vertexDeltaSize);
+	}
+
+	std::vector<std::uint32_t> entryTargets;
+	for (int vertex = 0; vertex < submesh.morphVertexCount; vertex++)
+	{
+		data.morphIndices.push_back((std::uint32_t)entryTargets.size());
+		for (int target = 0; target < submesh.morphTargetCount; target++)
 		{
-			GenerateTangents(submeshVertexBuffer, submesh.hasIndexBuffer ? &primitiveIndexBuffer : nullptr, submesh.flags);
+			const std::uint8_t* targetDeltas = vertexDeltas(target, vertex);
+			if (sparse[target] && !isZero(targetDeltas))
+			{
+				entryTargets.push_back(target);
+				deltas.insert(deltas.end(), targetDeltas, targetDeltas + vertexDeltaSize);
+			}
 		}
+	}
+	data.morphIndices.push_back((std::uint32_t)entryTargets.size());
+	data.morphIndices.insert(data.morphIndices.end(), entryTargets.begin(), entryTargets.end());
+
+	submesh.morphDenseTargetCount = (int)denseTargets.size();
+	submesh.morphSparseEntryCount = (int)entryTargets.size();
+	data.morphDeltas = std::move(deltas);
+}
 
-		BBox submeshBoundingBox = ComputeBoundingBox(submeshVertexBuffer, submeshVertexSizeBytes);
+// Interleaves the primitive's vertices, generates tangents, computes bounds, optimizes the triangle and vertex order and
+// packs the indices into the narrowest type that fits. Makes no GL calls, so primitives can be built in parallel on
+// worker threads.
+SubmeshData BuildSubmeshData(const tinygltf::Primitive& primitive, const GLTFAsset& asset, const MeshBuildOptions& options, TangentCache* tangentCache)
+{
+	assert(primitive.mode == GL_TRIANGLES);
+
+	SubmeshData data;
+	SubmeshInfo& submesh = data.submesh;
+
+	submesh.flags = GetPrimitiveAttributes(primitive);
+	bool hasJoints = HasFlag(submesh.flags, VertexAttribute::JOINTS);
+	bool hasMorphTargets = HasFlag(submesh.flags, VertexAttribute::MORPH_VERTEX);
+	assert((!hasJoints && !hasMorphTargets) || (hasJoints != hasMorphTargets) && "Morph targets and skeletal animation on same mesh not supported");
+
+	submesh.materialIndex = primitive.material;
+	bool hasMaterial = submesh.materialIndex >= 0;
+	bool hasNormals = HasFlag(submesh.flags, VertexAttribute::NORMAL);
+	submesh.flatShading = hasMaterial && !hasNormals;
+
+	bool hasTangents = HasFlag(submesh.flags, VertexAttribute::TANGENT);
+	assert(!hasTangents || hasNormals && "Primitive with tangents must also has normals");
 	
-		boundingBox.minXYZ = glm::min(submeshBoundingBox.minXYZ, boundingBox.minXYZ);
-		boundingBox.maxXYZ = glm::max(submeshBoundingBox.maxXYZ, boundingBox.maxXYZ);
+	bool hasNormalMap = primitive.material >= 0 && asset.model.materials[primitive.material].normalTexture.index >= 0;
+	bool generateTangents = !hasTangents && hasNormalMap;
+	if (generateTangents)
+	{
+		// Morph targets don't move generated tangents, they only get deltas from the glTF
+		submesh.flags |= VertexAttribute::TANGENT;
+	}
 
-		glGenVertexArrays(1, &submesh.VAO);
-		glBindVertexArray(submesh.VAO);
+	bool discardTangents = hasTangents && !hasNormalMap; // wtf is the point?
+	if (discardTangents)
+	{
+		submesh.flags &= ~VertexAttribute::TANGENT;
+	}
 
-		GLuint VBO;
-		glGenBuffers(1, &VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, submeshVertexBuffer.size(), submeshVertexBuffer.data(), GL_STATIC_DRAW);
+	submesh.layout = GetVertexLayout(primitive, submesh.flags, asset.model, generateTangents);
+	std::vector<std::uint8_t> submeshVertexBuffer = GetInterleavedVertexBuffer(primitive, submesh.flags, submesh.layout, asset, generateTangents);
 
-		// Don't change attribute indices, shaders rely on them being in this order
+	submesh.hasIndexBuffer = primitive.indices >= 0;
+	std::vector<std::uint32_t> primitiveIndexBuffer;
+	if (submesh.hasIndexBuffer)
+	{
+		primitiveIndexBuffer = GetIndexBuffer(primitive, asset);
+		submesh.countVerticesOrIndices = primitiveIndexBuffer.size();
+	}
+	else
+	{
+		submesh.countVerticesOrIndices = submeshVertexBuffer.size() / submesh.layout.stride;
+	}
 
-		// Position
-		int offset = 0;
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-		offset += attributeByteSizes.find(VertexAttribute::POSITION)->second;
+	if (generateTangents)
+	{
+		GenerateTangents(submeshVertexBuffer, submesh.hasIndexBuffer ? &primitiveIndexBuffer : nullptr, submesh.layout, options.tangentGenerator, tangentCache);
+	}
 
-		if (HasFlag(submesh.flags, VertexAttribute::TEXCOORD))
-		{
-			glEnableVertexAttribArray(1);
-			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::TEXCOORD)->second;
-		}
+	BBox submeshBoundingBox = ComputeBoundingBox(submeshVertexBuffer, submesh.layout);
+
+	// After tangent generation, vertices it split apart stay apart
+	if (options.weldVertices && !submesh.hasIndexBuffer)
+	{
+		primitiveIndexBuffer = WeldVertices(submeshVertexBuffer, submesh.layout.stride);
+		submesh.hasIndexBuffer = true;
+		submesh.countVerticesOrIndices = primitiveIndexBuffer.size();
+	}
+
+	// Repacked last, tangent generation and bounds work on the full precision vertices
+	if (options.compactVertices)
+	{
+		const VertexLayout compactLayout = GetCompactVertexLayout(submeshVertexBuffer, submesh.layout);
+		submeshVertexBuffer = RepackVertices(submeshVertexBuffer, submesh.layout, compactLayout);
+		submesh.layout = compactLayout;
+		submesh.flags |= VertexAttribute::COMPACT;
+	}
+
+	if (options.optimizeIndices && submesh.hasIndexBuffer)
+	{
+		data.cacheStatsBefore = AnalyzeVertexCache(primitiveIndexBuffer, submeshVertexBuffer.size() / submesh.layout.stride);
+		OptimizeVertexCache(primitiveIndexBuffer, submeshVertexBuffer.size() / submesh.layout.stride);
+		OptimizeOverdraw(primitiveIndexBuffer, submeshVertexBuffer, submesh.layout, submeshBoundingBox.GetCenter());
+		OptimizeVertexFetch(submeshVertexBuffer, submesh.layout.stride, primitiveIndexBuffer);
+		data.cacheStatsAfter = AnalyzeVertexCache(primitiveIndexBuffer, submeshVertexBuffer.size() / submesh.layout.stride);
+	}
+
+	// After compaction, which decides their format
+	if (hasMorphTargets)
+	{
+		data.morphDeltas = GetMorphTargetDeltas(primitive, asset, submesh, generateTangents);
+		SparsifyMorphTargetDeltas(data);
+	}
+
+	if (submesh.hasIndexBuffer)
+	{
+		data.indexBuffer = PackIndices(primitiveIndexBuffer, submeshVertexBuffer.size() / submesh.layout.stride, submesh.indexType);
+	}
+	data.vertexBuffer = std::move(submeshVertexBuffer);
+	data.boundingBox = submeshBoundingBox;
+	return data;
+}
+
+std::span<const std::uint8_t> SubmeshData::VertexBytes() const
+{
+	if (!cachedVertexBytes.empty()) return cachedVertexBytes;
+	return vertexBuffer;
+}
+
+std::span<const std::uint8_t> SubmeshData::IndexBytes() const
+{
+	if (!cachedIndexBytes.empty()) return cachedIndexBytes;
+	return indexBuffer;
+}
+
+std::span<const std::uint8_t> SubmeshData::MorphDeltaBytes() const
+{
+	if (!cachedMorphDeltaBytes.empty()) return cachedMorphDeltaBytes;
+	return morphDeltas;
+}
 
-		if (HasFlag(submesh.flags, VertexAttribute::NORMAL))
+std::span<const std::uint8_t> SubmeshData::MorphIndexBytes() const
+{
+	if (!cachedMorphIndexBytes.empty()) return cachedMorphIndexBytes;
+	return { (const std::uint8_t*)morphIndices.data(), morphIndices.size() * sizeof(std::uint32_t) };
+}
+
+std::size_t SubmeshInfo::MorphDeltaBufferSize() const
+{
+	return ((std::size_t)morphDenseTargetCount * morphVertexCount + morphSparseEntryCount) * morphDeltaStride * MorphDeltaTexelSize();
+}
+
+std::size_t SubmeshInfo::MorphIndexBufferSize() const
+{
+	if (morphTargetCount == 0) return 0;
+	return ((std::size_t)morphDenseTargetCount + morphVertexCount + 1 + morphSparseEntryCount) * sizeof(std::uint32_t);
+}
+
+// Gives cluster, whose vertices were copied out of data, the deltas and indices of only the morph vertices it uses.
+// Those are renumbered in the order the cluster first uses them, and so are the cluster's MORPH_VERTEX attributes.
+static void TrimMorphTargetsToCluster(const SubmeshData& data, SubmeshData& cluster)
+{
+	const SubmeshInfo& source = data.submesh;
+	SubmeshInfo& submesh = cluster.submesh;
+	const VertexLayout& layout = submesh.layout;
+	const std::size_t vertexDeltaSize = source.morphDeltaStride * source.MorphDeltaTexelSize();
+	const std::uint32_t* denseTargets = data.morphIndices.data();
+	const std::uint32_t* entryOffsets = denseTargets + source.morphDenseTargetCount;
+	const std::uint32_t* entryTargets = entryOffsets + source.morphVertexCount + 1;
+	const std::uint8_t* sparseDeltas = data.morphDeltas.data() + (std::size_t)source.morphDenseTargetCount * source.morphVertexCount * vertexDeltaSize;
+
+	std::vector<std::int32_t> remap(source.morphVertexCount, -1);
+	std::vector<std::uint32_t> morphVertices; // the source's morph vertex of each of the cluster's
+	const std::size_t vertexCount = cluster.vertexBuffer.size() / layout.stride;
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		std::uint8_t* attribute = cluster.vertexBuffer.data() + i * layout.stride + layout[VertexAttribute::MORPH_VERTEX].offset;
+		std::uint32_t morphVertex;
+		std::memcpy(&morphVertex, attribute, sizeof(morphVertex));
+		if (remap[morphVertex] < 0)
 		{
-			glEnableVertexAttribArray(2);
-			glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::NORMAL)->second;
+			remap[morphVertex] = (std::int32_t)morphVertices.size();
+			morphVertices.push_back(morphVertex);
 		}
+		std::memcpy(attribute, &remap[morphVertex], sizeof(morphVertex));
+	}
 
-		if (HasFlag(submesh.flags, VertexAttribute::WEIGHTS))
+	cluster.morphDeltas.clear();
+	cluster.morphIndices.assign(denseTargets, denseTargets + source.morphDenseTargetCount);
+	for (int dense = 0; dense < source.morphDenseTargetCount; dense++)
+	{
+		for (std::uint32_t morphVertex : morphVertices)
 		{
-			glEnableVertexAttribArray(3);
-			glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::WEIGHTS)->second;
-
-			glEnableVertexAttribArray(4);
-			glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::JOINTS)->second;
+			const std::uint8_t* deltas = data.morphDeltas.data() + ((std::size_t)dense * source.morphVertexCount + morphVertex) * vertexDeltaSize;
+			cluster.morphDeltas.insert(cluster.morphDeltas.end(), deltas, deltas + vertexDeltaSize);
 		}
+	}
 
-		if (HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET0_POSITION))
+	std::vector<std::uint32_t> clusterEntryTargets;
+	for (std::uint32_t morphVertex : morphVertices)
+	{
+		cluster.morphIndices.push_back((std::uint32_t)clusterEntryTargets.size());
+		for (std::uint32_t entry = entryOffsets[morphVertex]; entry < entryOffsets[morphVertex + 1]; entry++)
 		{
-			assert(HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET1_POSITION));
-			glEnableVertexAttribArray(5);
-			glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::MORPH_TARGET0_POSITION)->second;
-
-			glEnableVertexAttribArray(6);
-			glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::MORPH_TARGET1_POSITION)->second;
+			clusterEntryTargets.push_back(entryTargets[entry]);
+			cluster.morphDeltas.insert(cluster.morphDeltas.end(), sparseDeltas + entry * vertexDeltaSize, sparseDeltas + (entry + 1) * vertexDeltaSize);
 		}
+	}
+	cluster.morphIndices.push_back((std::uint32_t)clusterEntryTargets.size());
+	cluster.morphIndices.insert(cluster.morphIndices.end(), clusterEntryTargets.begin(), clusterEntryTargets.end());
 
-		if (HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET0_NORMAL))
-		{
-			assert(HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET1_NORMAL));
-			glEnableVertexAttribArray(7);
-			glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::MORPH_TARGET0_NORMAL)->second;
+	submesh.morphVertexCount = (int)morphVertices.size();
+	submesh.morphSparseEntryCount = (int)clusterEntryTargets.size();
+}
 
-			glEnableVertexAttribArray(8);
-			glVertexAttribPointer(8, 3, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::MORPH_TARGET1_NORMAL)->second;
+std::vector<SubmeshData> SplitForShortIndices(SubmeshData&& data)
+{
+	std::vector<SubmeshData> clusters;
+	if (!data.submesh.hasIndexBuffer || data.submesh.indexType != GL_UNSIGNED_INT)
+	{
+		clusters.push_back(std::move(data));
+		return clusters;
+	}
+	assert(data.cachedVertexBytes.empty() && data.cachedIndexBytes.empty() && data.cachedMorphDeltaBytes.empty() && data.cachedMorphIndexBytes.empty());
+
+	const VertexLayout& layout = data.submesh.layout;
+	std::vector<std::uint32_t> indices(data.indexBuffer.size() / sizeof(std::uint32_t));
+	std::memcpy(indices.data(), data.indexBuffer.data(), data.indexBuffer.size());
+
+	// Triangles are taken in order and a new cluster starts whenever the next one wouldn't fit, so clusters stay as
+	// spatially coherent as the index buffer was
+	std::vector<std::int32_t> remap(data.vertexBuffer.size() / layout.stride, -1);
+	std::vector<std::uint32_t> clusterVertices; // indices into data's vertices
+	std::vector<std::uint16_t> clusterIndices;
+	auto finishCluster = [&]()
+	{
+		SubmeshData& cluster = clusters.emplace_back();
+		cluster.submesh = data.submesh;
+		cluster.submesh.indexType = GL_UNSIGNED_SHORT;
+		cluster.submesh.countVerticesOrIndices = (int)clusterIndices.size();
+		cluster.vertexBuffer.resize(clusterVertices.size() * layout.stride);
+		for (std::size_t i = 0; i < clusterVertices.size(); i++)
+		{
+			std::memcpy(cluster.vertexBuffer.data() + i * layout.stride, data.vertexBuffer.data() + (std::size_t)clusterVertices[i] * layout.stride, layout.stride);
+			remap[clusterVertices[i]] = -1;
 		}
-
-		if (HasFlag(submesh.flags, VertexAttribute::TANGENT))
+		cluster.indexBuffer.resize(clusterIndices.size() * sizeof(std::uint16_t));
+		std::memcpy(cluster.indexBuffer.data(), clusterIndices.data(), cluster.indexBuffer.size());
+		cluster.boundingBox = ComputeBoundingBox(cluster.vertexBuffer, layout);
+		if (data.submesh.morphTargetCount > 0)
 		{
-			glEnableVertexAttribArray(9);
-			glVertexAttribPointer(9, 4, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::TANGENT)->second;
+			TrimMorphTargetsToCluster(data, cluster);
 		}
+		clusterVertices.clear();
+		clusterIndices.clear();
+	};
 
-		if (HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET0_TANGENT))
+	for (std::size_t triangle = 0; triangle + 2 < indices.size(); triangle += 3)
+	{
+		int newVertices = 0;
+		for (int corner = 0; corner < 3; corner++)
 		{
-			assert(HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET1_TANGENT));
-			glEnableVertexAttribArray(10);
-			glVertexAttribPointer(10, 3, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::MORPH_TARGET0_TANGENT)->second;
-
-			glEnableVertexAttribArray(11);
-			glVertexAttribPointer(11, 3, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::MORPH_TARGET1_TANGENT)->second;
+			newVertices += remap[indices[triangle + corner]] < 0;
 		}
-
-		if (HasFlag(submesh.flags, VertexAttribute::COLOR))
+		if (clusterVertices.size() + newVertices > maxShortIndexVertices)
 		{
-			glEnableVertexAttribArray(12);
-			glVertexAttribPointer(12, 4, GL_FLOAT, GL_FALSE, submeshVertexSizeBytes, (const void*)offset);
-			offset += attributeByteSizes.find(VertexAttribute::COLOR)->second;
+			finishCluster();
 		}
 
-		if (submesh.hasIndexBuffer)
+		for (int corner = 0; corner < 3; corner++)
 		{
-			GLuint IBO;
-			glGenBuffers(1, &IBO);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, primitiveIndexBuffer.size() * sizeof(primitiveIndexBuffer[0]), primitiveIndexBuffer.data(), GL_STATIC_DRAW);
+			const std::uint32_t vertex = indices[triangle + corner];
+			if (remap[vertex] < 0)
+			{
+				remap[vertex] = (std::int32_t)clusterVertices.size();
+				clusterVertices.push_back(vertex);
+			}
+			clusterIndices.push_back((std::uint16_t)remap[vertex]);
 		}
 	}
+	if (!clusterIndices.empty())
+	{
+		finishCluster();
+	}
+	return clusters;
+}
+
+void Submesh::Draw() const
+{
+	glBindVertexArray(VAO);
+	if (hasIndexBuffer)
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, countVerticesOrIndices, indexType, (const void*)(std::uintptr_t)geometry.IndexOffset(), geometry.BaseVertex());
+	}
+	else
+	{
+		glDrawArrays(GL_TRIANGLES, geometry.BaseVertex(), countVerticesOrIndices);
+	}
 }
 
-bool Mesh::HasMorphTargets()
+Mesh::Mesh(std::span<const SubmeshData> submeshData, GeometryArena& arena, StagingUploader* uploader)
 {
-	for (Submesh& submesh : submeshes)
+	assert(submeshData.size() > 0);
+
+	// Only GL work is left at this point, everything else was done by BuildSubmeshData
+	for (const SubmeshData& data : submeshData)
 	{
-		if (HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET0_POSITION))
+		Submesh& submesh = submeshes.emplace_back(Submesh{ data.submesh });
+
+		boundingBox.minXYZ = glm::min(data.boundingBox.minXYZ, boundingBox.minXYZ);
+		boundingBox.maxXYZ = glm::max(data.boundingBox.maxXYZ, boundingBox.maxXYZ);
+
+		const std::span<const std::uint8_t> vertexBytes = data.VertexBytes();
+		const std::span<const std::uint8_t> indexBytes = data.IndexBytes();
+		submesh.geometry = arena.Allocate(submesh.layout, vertexBytes.size() / submesh.layout.stride, indexBytes.size());
+		submesh.VAO = arena.VertexArray(submesh.geometry);
+		arena.Upload(submesh.geometry, vertexBytes, indexBytes, uploader);
+
+		if (submesh.morphTargetCount > 0)
 		{
-			return true;
+			// Like the arena's buffers, the storage is allocated here and its contents go through uploader when there is one
+			auto createTextureBuffer = [&](std::span<const std::uint8_t> bytes, GLenum format, GLBuffer& buffer, GLTexture& texture)
+			{
+				buffer = GLBuffer::Create();
+				glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+				glBufferData(GL_TEXTURE_BUFFER, bytes.size(), uploader ? nullptr : bytes.data(), GL_STATIC_DRAW);
+				if (uploader) uploader->UploadBuffer(buffer, bytes);
+				texture = GLTexture::Create();
+				glBindTexture(GL_TEXTURE_BUFFER, texture);
+				glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+			};
+
+			const std::span<const std::uint8_t> morphDeltaBytes = data.MorphDeltaBytes();
+			assert(morphDeltaBytes.size() == submesh.MorphDeltaBufferSize());
+			createTextureBuffer(morphDeltaBytes, submesh.MorphDeltaFormat(), submesh.morphDeltaBuffer, submesh.morphDeltaTexture);
+			const std::span<const std::uint8_t> morphIndexBytes = data.MorphIndexBytes();
+			assert(morphIndexBytes.size() == submesh.MorphIndexBufferSize());
+			createTextureBuffer(morphIndexBytes, GL_R32UI, submesh.morphIndexBuffer, submesh.morphIndexTexture);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
 		}
 	}
-	return false;
+}
+
+int Mesh::MorphTargetCount() const
+{
+	int count = 0;
+	for (const Submesh& submesh : submeshes)
+	{
+		count = std::max(count, submesh.morphTargetCount);
+	}
+	return count;
 }
@@ -1,29 +1,125 @@
 #pragma once
 
 #include "BBox.h"
+#include <cstddef>
 #include <cstdint>
+#include "GeometryArena.h"
+#include "GLTFAsset.h"
 #include <glad/glad.h>
+#include "MeshOptimizer.h"
 #include "PBRMaterial.h"
+#include <span>
+#include "StagingUploader.h"
+#include "TangentCache.h"
 #include <tiny_gltf/tiny_gltf.h>
 #include "VertexAttribute.h"
+#include "VertexLayout.h"
+#include <vector>
 
-struct Submesh
+// Everything about a submesh except its GL objects
+struct SubmeshInfo
 {
-	GLuint VAO;
 	VertexAttribute flags = VertexAttribute::POSITION;
+	VertexLayout layout;
 	int countVerticesOrIndices;
 	int materialIndex;
 	bool hasIndexBuffer;
+	GLenum indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
 	bool flatShading = false;
+	// Morph target deltas are texels of a buffer texture, RGBA16F with VertexAttribute::COMPACT and RGB32F otherwise,
+	// morphDeltaStride texels per vertex and target: position first, then the normal and tangent if the primitive has them.
+	// Targets that move most vertices are dense, the deltas of the i-th dense one for vertex MORPH_VERTEX start at texel
+	// (i * morphVertexCount + MORPH_VERTEX) * morphDeltaStride. The other targets are sparse, only the vertices they move
+	// have an entry, and entries follow the dense deltas grouped by vertex.
+	// A second, R32UI buffer texture indexes them: the morphDenseTargetCount dense targets' indices, then morphVertexCount + 1
+	// offsets where each vertex's sparse entries start, then the target of every sparse entry.
+	int morphTargetCount = 0;
+	int morphVertexCount = 0;
+	int morphDeltaStride = 0;
+	int morphDenseTargetCount = 0;
+	int morphSparseEntryCount = 0;
+
+	GLenum MorphDeltaFormat() const { return HasFlag(flags, VertexAttribute::COMPACT) ? GL_RGBA16F : GL_RGB32F; }
+	std::size_t MorphDeltaTexelSize() const { return HasFlag(flags, VertexAttribute::COMPACT) ? 4 * sizeof(std::uint16_t) : 3 * sizeof(float); }
+	std::size_t MorphDeltaBufferSize() const;
+	std::size_t MorphIndexBufferSize() const;
+};
+
+struct Submesh : SubmeshInfo
+{
+	GeometryArena::Allocation geometry;
+	GLuint VAO = 0; // the arena page's, shared with every other submesh in it
+	GLBuffer morphDeltaBuffer;
+	GLTexture morphDeltaTexture; // GL_TEXTURE_BUFFER view of morphDeltaBuffer
+	GLBuffer morphIndexBuffer;
+	GLTexture morphIndexTexture; // GL_TEXTURE_BUFFER view of morphIndexBuffer
+
+	// Binds the VAO and draws with the allocation's base vertex and index offset
+	void Draw() const;
+};
+
+// CPU side of a submesh, everything needed to create its GL objects
+struct SubmeshData
+{
+	SubmeshInfo submesh;
+	std::vector<std::uint8_t> vertexBuffer;
+	std::vector<std::uint8_t> indexBuffer; // submesh.indexType indices
+	std::vector<std::uint8_t> morphDeltas; // texels of submesh.MorphDeltaFormat(), empty without morph targets
+	std::vector<std::uint32_t> morphIndices;
+	// Used instead of the vectors when loaded from a geometry cache, pointing straight into the mapped file
+	std::span<const std::uint8_t> cachedVertexBytes;
+	std::span<const std::uint8_t> cachedIndexBytes;
+	std::span<const std::uint8_t> cachedMorphDeltaBytes;
+	std::span<const std::uint8_t> cachedMorphIndexBytes;
+	// Only set when built with MeshBuildOptions::optimizeIndices, the geometry cache doesn't keep them
+	VertexCacheStats cacheStatsBefore, cacheStatsAfter;
+	BBox boundingBox;
+
+	std::span<const std::uint8_t> VertexBytes() const;
+	std::span<const std::uint8_t> IndexBytes() const;
+	std::span<const std::uint8_t> MorphDeltaBytes() const;
+	std::span<const std::uint8_t> MorphIndexBytes() const;
+};
+
+enum class TangentGenerator
+{
+	MikkTSpace, // matches what normal maps are baked against, the default for final renders
+	Fast,       // O(n) per-triangle accumulation without vertex splitting, for previews
 };
 
+struct MeshBuildOptions
+{
+	bool compactVertices = false; // VertexAttribute::COMPACT layout
+	bool splitForShortIndices = true; // SplitForShortIndices every built primitive
+	bool weldVertices = true; // WeldVertices non-indexed primitives so they can be drawn indexed
+	bool optimizeIndices = true; // vertex cache, overdraw and vertex fetch order, see MeshOptimizer.h
+	TangentGenerator tangentGenerator = TangentGenerator::MikkTSpace; // for normal mapped primitives without tangents
+};
+
+// Indices are 16 bit when the primitive has at most 65536 vertices, 32 bit otherwise. Generated tangents are looked up
+// in and added to tangentCache if there is one.
+SubmeshData BuildSubmeshData(const tinygltf::Primitive& primitive, const GLTFAsset& asset, const MeshBuildOptions& options = {},
+	TangentCache* tangentCache = nullptr);
+// Fills layout's tangent attribute of every vertex from its positions, normals and texture coordinates. MikkTSpace
+// tangents are looked up in and added to tangentCache if there is one.
+void GenerateTangents(std::vector<std::uint8_t>& vertexBuffer, const std::vector<std::uint32_t>* indexBuffer, const VertexLayout& layout,
+	TangentGenerator generator = TangentGenerator::MikkTSpace, TangentCache* tangentCache = nullptr);
+// Splits a primitive with 32 bit indices into clusters of at most 65536 vertices, each with 16 bit indices. Vertices
+// used by more than one cluster are duplicated, and each cluster only keeps the morph target deltas of its own vertices.
+// Anything else is returned as the only element.
+std::vector<SubmeshData> SplitForShortIndices(SubmeshData&& data);
+
 struct Mesh
 {
-	Mesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model);
+	// Allocates the already built primitives in arena and fills them and their morph target buffers, must be called on
+	// the GL context thread. With an uploader the contents are queued on it instead, so submeshData has to outlive those
+	// uploads.
+	Mesh(std::span<const SubmeshData> submeshData, GeometryArena& arena, StagingUploader* uploader = nullptr);
 	std::vector<Submesh> submeshes;
 	BBox boundingBox {
 		.minXYZ = glm::vec3(FLT_MAX),
 		.maxXYZ = glm::vec3(-FLT_MAX)
 	};
-	bool HasMorphTargets();
+	// Targets of the submesh with the most, glTF requires every primitive of a mesh to have the same number
+	int MorphTargetCount() const;
 };
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include "Hash.h"
+#include <numeric>
+
+// FIFO cache size used to find cluster boundaries, the same as AnalyzeVertexCache's default
+static constexpr std::size_t overdrawCacheSize = 16;
+
+std::vector<std::uint32_t> WeldVertices(std::vector<std::uint8_t>& vertexBuffer, std::size_t stride)
+{
+	const std::size_t vertexCount = vertexBuffer.size() / stride;
+	std::vector<std::uint32_t> indices(vertexCount);
+	std::vector<std::uint8_t> welded;
+	welded.reserve(vertexBuffer.size());
+
+	// Open addressing table of welded vertex indices, at most half full
+	const std::size_t tableSize = std::bit_ceil(std::max<std::size_t>(vertexCount * 2, 16));
+	std::vector<std::uint32_t> table(tableSize, UINT32_MAX);
+	std::uint32_t weldedCount = 0;
+	for (std::size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const std::uint8_t* bytes = vertexBuffer.data() + vertex * stride;
+		std::size_t slot = HashBytes({ bytes, stride }) & (tableSize - 1);
+		while (table[slot] != UINT32_MAX && std::memcmp(welded.data() + (std::size_t)table[slot] * stride, bytes, stride) != 0)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == UINT32_MAX)
+		{
+			table[slot] = weldedCount++;
+			welded.insert(welded.end(), bytes, bytes + stride);
+		}
+		indices[vertex] = table[slot];
+	}
+
+	vertexBuffer = std::move(welded);
+	return indices;
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, int cacheSize)
+{
+	VertexCacheStats stats;
+	stats.triangleCount = indices.size() / 3;
+
+	// Timestamp of each vertex's last cache insertion, it's still cached while fewer than cacheSize misses happened since
+	std::vector<std::size_t> insertedAt(vertexCount, 0);
+	std::size_t time = cacheSize + 1;
+	for (const std::uint32_t index : indices)
+	{
+		if (insertedAt[index] == 0)
+		{
+			stats.vertexCount++;
+		}
+		if (time - insertedAt[index] > (std::size_t)cacheSize)
+		{
+			insertedAt[index] = time++;
+			stats.cacheMisses++;
+		}
+	}
+	return stats;
+}
+
+// Scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static constexpr int forsythCacheSize = 32;
+static constexpr float cacheDecayPower = 1.5f;
+static constexpr float lastTriangleScore = 0.75f;
+static constexpr float valenceBoostScale = 2.0f;
+static constexpr float valenceBoostPower = 0.5f;
+
+static float VertexScore(int cachePosition, int remainingTriangles)
+{
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			// Used by the last triangle, fixed score so the next one doesn't prefer any of its edges
+			score = lastTriangleScore;
+		}
+		else
+		{
+			score = std::pow(1.0f - (float)(cachePosition - 3) / (forsythCacheSize - 3), cacheDecayPower);
+		}
+	}
+	// Vertices with few triangles left get boosted so they're finished off instead of left as stragglers
+	score += valenceBoostScale * std::pow((float)remainingTriangles, -valenceBoostPower);
+	return score;
+}
+
+void OptimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t vertexCount)
+{
+	const std::size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles using each vertex, as offsets into one array
+	std::vector<std::uint32_t> triangleOffsets(vertexCount + 1, 0);
+	for (const std::uint32_t index : indices)
+	{
+		triangleOffsets[index + 1]++;
+	}
+	std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+	std::vector<std::uint32_t> vertexTriangles(triangleCount * 3);
+	std::vector<std::uint32_t> remaining(vertexCount, 0); // triangles using the vertex that haven't been emitted
+	for (std::size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const std::uint32_t vertex = indices[triangle * 3 + corner];
+			vertexTriangles[triangleOffsets[vertex] + remaining[vertex]++] = (std::uint32_t)triangle;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (std::size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		vertexScores[vertex] = VertexScore(-1, remaining[vertex]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for (std::size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<std::uint32_t> optimized;
+	optimized.reserve(indices.size());
+
+	// A few extra slots, a triangle pushes up to 3 vertices before the ones that fall off are dropped
+	std::vector<std::uint32_t> cache, nextCache;
+	cache.reserve(forsythCacheSize + 3);
+	nextCache.reserve(forsythCacheSize + 3);
+
+	std::size_t bestTriangle = 0;
+	std::size_t nextUnemitted = 0; // fallback when nothing in the cache has triangles left
+	for (std::size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (bestTriangle == triangleCount)
+		{
+			while (emitted[nextUnemitted]) nextUnemitted++;
+			bestTriangle = nextUnemitted;
+		}
+
+		emitted[bestTriangle] = true;
+		nextCache.clear();
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const std::uint32_t vertex = indices[bestTriangle * 3 + corner];
+			optimized.push_back(vertex);
+			if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end())
+			{
+				nextCache.push_back(vertex);
+			}
+
+			// Remove the emitted triangle from the vertex's list, keeping the unemitted ones in front
+			std::uint32_t* begin = vertexTriangles.data() + triangleOffsets[vertex];
+			std::uint32_t* end = begin + remaining[vertex];
+			*std::find(begin, end, (std::uint32_t)bestTriangle) = *(end - 1);
+			remaining[vertex]--;
+		}
+		for (const std::uint32_t vertex : cache)
+		{
+			if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end())
+			{
+				nextCache.push_back(vertex);
+			}
+		}
+		std::swap(cache, nextCache);
+
+		// Only the cached vertices' scores changed, and the best next triangle is almost always one of theirs
+		for (int i = 0; i < cache.size(); i++)
+		{
+			const std::uint32_t vertex = cache[i];
+			cachePosition[vertex] = i < forsythCacheSize ? i : -1;
+			const float newScore = VertexScore(cachePosition[vertex], remaining[vertex]);
+			const float scoreChange = newScore - vertexScores[vertex];
+			vertexScores[vertex] = newScore;
+
+			const std::uint32_t* triangles = vertexTriangles.data() + triangleOffsets[vertex];
+			for (std::uint32_t j = 0; j < remaining[vertex]; j++)
+			{
+				triangleScores[triangles[j]] += scoreChange;
+			}
+		}
+
+		float bestScore = -1.0f;
+		bestTriangle = triangleCount;
+		for (const std::uint32_t vertex : cache)
+		{
+			const std::uint32_t* triangles = vertexTriangles.data() + triangleOffsets[vertex];
+			for (std::uint32_t j = 0; j < remaining[vertex]; j++)
+			{
+				if (triangleScores[triangles[j]] > bestScore)
+				{
+					bestScore = triangleScores[triangles[j]];
+					bestTriangle = triangles[j];
+				}
+			}
+		}
+		if (cache.size() > forsythCacheSize)
+		{
+			cache.resize(forsythCacheSize);
+		}
+	}
+
+	indices = std::move(optimized);
+}
+
+void OptimizeOverdraw(std::vector<std::uint32_t>& indices, const std::vector<std::uint8_t>& vertexBuffer, const VertexLayout& layout,
+	const glm::vec3& meshCenter)
+{
+	const std::size_t triangleCount = indices.size() / 3;
+	const std::size_t vertexCount = vertexBuffer.size() / layout.stride;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// A triangle whose vertices all miss the cache is where the cache optimizer ran out of neighbours and jumped, so
+	// reordering at those points doesn't lose any reuse
+	std::vector<std::size_t> clusterStarts;
+	std::vector<std::size_t> insertedAt(vertexCount, 0);
+	std::size_t time = overdrawCacheSize + 1;
+	for (std::size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		int misses = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			std::size_t& vertexInsertedAt = insertedAt[indices[triangle * 3 + corner]];
+			if (time - vertexInsertedAt > overdrawCacheSize)
+			{
+				vertexInsertedAt = time++;
+				misses++;
+			}
+		}
+		if (misses == 3)
+		{
+			clusterStarts.push_back(triangle);
+		}
+	}
+	if (clusterStarts.size() <= 1)
+	{
+		return;
+	}
+	clusterStarts.push_back(triangleCount);
+
+	const VertexAttributeFormat& positionFormat = layout[VertexAttribute::POSITION];
+	auto position = [&](std::uint32_t vertex)
+	{
+		return glm::vec3(ReadAttribute(vertexBuffer.data() + (std::size_t)vertex * layout.stride, positionFormat));
+	};
+
+	// Clusters on the outside of the mesh face away from its center, draw the ones facing furthest out first
+	const std::size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<float> sortKeys(clusterCount);
+	for (std::size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f); // area weighted
+		float area = 0.0f;
+		for (std::size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+		{
+			const glm::vec3 p0 = position(indices[triangle * 3]);
+			const glm::vec3 p1 = position(indices[triangle * 3 + 1]);
+			const glm::vec3 p2 = position(indices[triangle * 3 + 2]);
+			const glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+			const float triangleArea = glm::length(triangleNormal);
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+		centroid = area > 0.0f ? centroid / area : meshCenter;
+		sortKeys[cluster] = glm::dot(centroid - meshCenter, normal);
+	}
+
+	std::vector<std::size_t> clusterOrder(clusterCount);
+	std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](std::size_t a, std::size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<std::uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (const std::size_t cluster : clusterOrder)
+	{
+		sorted.insert(sorted.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+	}
+	indices = std::move(sorted);
+}
+
+void OptimizeVertexFetch(std::vector<std::uint8_t>& vertexBuffer, std::size_t stride, std::vector<std::uint32_t>& indices)
+{
+	std::vector<std::uint32_t> remap(vertexBuffer.size() / stride, UINT32_MAX);
+	std::vector<std::uint8_t> reordered;
+	reordered.reserve(vertexBuffer.size());
+	std::uint32_t nextVertex = 0;
+	for (std::uint32_t& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = nextVertex++;
+			reordered.insert(reordered.end(), vertexBuffer.begin() + index * stride, vertexBuffer.begin() + (index + 1) * stride);
+		}
+		index = remap[index];
+	}
+	vertexBuffer = std::move(reordered);
+}
\ No newline at end of file
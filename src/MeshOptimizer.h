@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <vector>
+#include "VertexLayout.h"
+
+// Triangle list reordering and vertex remapping done on indexed primitives before they're uploaded. Runs on the CPU
+// without GL, in WeldVertices -> OptimizeVertexCache -> OptimizeOverdraw -> OptimizeVertexFetch order.
+
+// Post-transform cache behaviour of an index buffer, simulated with a FIFO cache like most GPUs have
+struct VertexCacheStats
+{
+	std::size_t triangleCount = 0;
+	std::size_t vertexCount = 0; // distinct vertices the indices reference
+	std::size_t cacheMisses = 0;
+
+	// Average cache miss ratio, vertex shader invocations per triangle. 0.5 is the best a regular grid can do, 3 the worst.
+	float ACMR() const { return triangleCount ? (float)cacheMisses / triangleCount : 0.0f; }
+	// Average transformed vertex ratio, vertex shader invocations per vertex. 1 is ideal.
+	float ATVR() const { return vertexCount ? (float)cacheMisses / vertexCount : 0.0f; }
+
+	VertexCacheStats& operator+=(const VertexCacheStats& other)
+	{
+		triangleCount += other.triangleCount;
+		vertexCount += other.vertexCount;
+		cacheMisses += other.cacheMisses;
+		return *this;
+	}
+};
+
+// Indexes a non-indexed primitive, merging vertices whose interleaved bytes are identical. Only exact duplicates are
+// merged, so anything that split a vertex on purpose (tangent generation, hard normals, UV seams) is kept. Returns the
+// index buffer.
+std::vector<std::uint32_t> WeldVertices(std::vector<std::uint8_t>& vertexBuffer, std::size_t stride);
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, int cacheSize = 16);
+
+// Forsyth's linear-speed vertex cache optimization, reorders triangles so they reuse recently transformed vertices
+void OptimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t vertexCount);
+// Splits the cache optimized triangles into clusters wherever the order already jumps to unconnected triangles, then
+// draws clusters facing away from meshCenter (the center of its bounds) first, since they tend to occlude the rest.
+// Costs almost none of the cache hits.
+void OptimizeOverdraw(std::vector<std::uint32_t>& indices, const std::vector<std::uint8_t>& vertexBuffer, const VertexLayout& layout,
+	const glm::vec3& meshCenter);
+// Renumbers vertices in the order the indices first use them, so vertex fetches walk through memory. Vertices the
+// indices don't use are dropped.
+void OptimizeVertexFetch(std::vector<std::uint8_t>& vertexBuffer, std::size_t stride, std::vector<std::uint32_t>& indices);
\ No newline at end of file
@@ -0,0 +1,473 @@
+#include "MeshoptDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHOPT_SSE2
+#include <emmintrin.h>
+#endif
+
+bool ParseMeshoptMode(const std::string& name, MeshoptMode& mode)
+{
+	if (name == "ATTRIBUTES") mode = MeshoptMode::Attributes;
+	else if (name == "TRIANGLES") mode = MeshoptMode::Triangles;
+	else if (name == "INDICES") mode = MeshoptMode::Indices;
+	else return false;
+	return true;
+}
+
+bool ParseMeshoptFilter(const std::string& name, MeshoptFilter& filter)
+{
+	if (name == "NONE") filter = MeshoptFilter::None;
+	else if (name == "OCTAHEDRAL") filter = MeshoptFilter::Octahedral;
+	else if (name == "QUATERNION") filter = MeshoptFilter::Quaternion;
+	else if (name == "EXPONENTIAL") filter = MeshoptFilter::Exponential;
+	else return false;
+	return true;
+}
+
+// LEB128 style, 7 bits per byte with the high bit set on every byte but the last. At most 5 bytes, the last of which
+// is taken whole.
+static bool ReadVByte(const std::uint8_t*& data, const std::uint8_t* end, std::uint32_t& value)
+{
+	value = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		if (data == end) return false;
+		const std::uint8_t byte = *data++;
+		value |= (std::uint32_t)(byte & 127) << (7 * i);
+		if (byte < 128) break;
+	}
+	return true;
+}
+
+static std::uint32_t UnZigZag(std::uint32_t value)
+{
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+static void WriteIndex(std::uint8_t* destination, std::size_t i, std::size_t indexSize, std::uint32_t index)
+{
+	if (indexSize == 2)
+	{
+		const std::uint16_t shortIndex = (std::uint16_t)index;
+		std::memcpy(destination + i * 2, &shortIndex, 2);
+	}
+	else
+	{
+		std::memcpy(destination + i * 4, &index, 4);
+	}
+}
+
+// Vertex codec. Vertices are split into blocks, and each byte of the vertex is delta encoded against the same byte of the
+// previous vertex across the block, zigzagged, then stored in groups of 16 at 0, 2, 4 or 8 bits per byte with escapes.
+static constexpr std::size_t vertexBlockMaxBytes = 8192;
+static constexpr std::size_t vertexBlockMaxVertices = 256;
+static constexpr std::size_t byteGroupSize = 16;
+static constexpr std::size_t vertexTailMinSize = 32;
+
+static std::size_t GetVertexBlockSize(std::size_t vertexSize)
+{
+	const std::size_t blockSize = (vertexBlockMaxBytes / vertexSize) & ~(byteGroupSize - 1);
+	return std::min(blockSize, vertexBlockMaxVertices);
+}
+
+static bool DecodeBytesGroup(const std::uint8_t*& data, const std::uint8_t* end, std::uint8_t* destination, int bitsMode)
+{
+	switch (bitsMode)
+	{
+	case 0:
+		std::memset(destination, 0, byteGroupSize);
+		return true;
+	case 3:
+		if ((std::size_t)(end - data) < byteGroupSize) return false;
+		std::memcpy(destination, data, byteGroupSize);
+		data += byteGroupSize;
+		return true;
+	default:
+	{
+		// Values are packed high bits first, the all ones value means the byte is in the escape list after them
+		const int bits = bitsMode == 1 ? 2 : 4;
+		const std::size_t packedSize = byteGroupSize * bits / 8;
+		if ((std::size_t)(end - data) < packedSize) return false;
+		const std::uint8_t* escapes = data + packedSize;
+		const int escape = (1 << bits) - 1;
+		for (std::size_t i = 0; i < byteGroupSize; i++)
+		{
+			const std::size_t bitOffset = i * bits;
+			const int value = (data[bitOffset / 8] >> (8 - bits - bitOffset % 8)) & escape;
+			if (value == escape)
+			{
+				if (escapes == end) return false;
+				destination[i] = *escapes++;
+			}
+			else
+			{
+				destination[i] = (std::uint8_t)value;
+			}
+		}
+		data = escapes;
+		return true;
+	}
+	}
+}
+
+static bool DecodeVertexBlock(const std::uint8_t*& data, const std::uint8_t* end, std::uint8_t* vertices, std::size_t vertexCount, std::size_t vertexSize,
+	std::uint8_t* lastVertex)
+{
+	const std::size_t groupCount = (vertexCount + byteGroupSize - 1) / byteGroupSize;
+	const std::size_t headerSize = (groupCount + 3) / 4;
+	std::uint8_t deltas[vertexBlockMaxVertices];
+
+	for (std::size_t k = 0; k < vertexSize; k++)
+	{
+		// 2 bits of mode per group
+		if ((std::size_t)(end - data) < headerSize) return false;
+		const std::uint8_t* header = data;
+		data += headerSize;
+		for (std::size_t group = 0; group < groupCount; group++)
+		{
+			const int bitsMode = (header[group / 4] >> (group % 4 * 2)) & 3;
+			if (!DecodeBytesGroup(data, end, deltas + group * byteGroupSize, bitsMode)) return false;
+		}
+
+		std::uint8_t value = lastVertex[k];
+		for (std::size_t i = 0; i < vertexCount; i++)
+		{
+			const std::uint8_t delta = deltas[i];
+			value += (std::uint8_t)((delta >> 1) ^ (0u - (delta & 1)));
+			vertices[i * vertexSize + k] = value;
+		}
+		lastVertex[k] = value;
+	}
+	return true;
+}
+
+static bool DecodeVertexBuffer(std::uint8_t* destination, std::size_t count, std::size_t vertexSize, std::span<const std::uint8_t> source)
+{
+	if (vertexSize == 0 || vertexSize > vertexBlockMaxVertices || vertexSize % 4 != 0) return false;
+
+	// The tail holds the first block's reference vertex, padded at the front to at least 32 bytes
+	const std::size_t tailSize = std::max(vertexSize, vertexTailMinSize);
+	if (source.size() < 1 + tailSize || source[0] != 0xA0) return false;
+
+	std::uint8_t lastVertex[vertexBlockMaxVertices];
+	std::memcpy(lastVertex, source.data() + source.size() - vertexSize, vertexSize);
+
+	const std::uint8_t* data = source.data() + 1;
+	const std::uint8_t* end = source.data() + source.size() - tailSize;
+	const std::size_t blockSize = GetVertexBlockSize(vertexSize);
+	for (std::size_t first = 0; first < count; first += blockSize)
+	{
+		if (!DecodeVertexBlock(data, end, destination + first * vertexSize, std::min(blockSize, count - first), vertexSize, lastVertex)) return false;
+	}
+	return data == end;
+}
+
+// Index codec. Each triangle is one code byte, which mostly refers to an edge of a recent triangle in a 16 entry FIFO
+// plus a recent or brand new vertex. Explicit indices are delta encoded varints.
+static bool DecodeIndexBuffer(std::uint8_t* destination, std::size_t count, std::size_t indexSize, std::span<const std::uint8_t> source)
+{
+	if (count % 3 != 0 || source.size() < 1 + count / 3 + 16) return false;
+	const int version = source[0] & 0x0F;
+	if ((source[0] & 0xF0) != 0xE0 || version > 1) return false;
+
+	std::uint32_t edgeFifo[16][2];
+	std::uint32_t vertexFifo[16];
+	std::memset(edgeFifo, -1, sizeof(edgeFifo));
+	std::memset(vertexFifo, -1, sizeof(vertexFifo));
+	std::size_t edgeFifoOffset = 0;
+	std::size_t vertexFifoOffset = 0;
+	auto pushEdge = [&](std::uint32_t a, std::uint32_t b)
+	{
+		edgeFifo[edgeFifoOffset][0] = a;
+		edgeFifo[edgeFifoOffset][1] = b;
+		edgeFifoOffset = (edgeFifoOffset + 1) & 15;
+	};
+	auto pushVertex = [&](std::uint32_t v, bool push = true)
+	{
+		vertexFifo[vertexFifoOffset] = v;
+		vertexFifoOffset = (vertexFifoOffset + push) & 15;
+	};
+
+	std::uint32_t next = 0; // next vertex that hasn't been referenced yet
+	std::uint32_t last = 0; // explicit indices are deltas from the previous one
+	auto readIndex = [&](const std::uint8_t*& data, const std::uint8_t* end, std::uint32_t& index)
+	{
+		std::uint32_t value;
+		if (!ReadVByte(data, end, value)) return false;
+		last = index = last + UnZigZag(value);
+		return true;
+	};
+
+	// Version 1 spends edge codes 13 and 14 on the last explicit index plus or minus one
+	const int fifoCodeLimit = version >= 1 ? 13 : 15;
+	const std::uint8_t* codes = source.data() + 1;
+	const std::uint8_t* data = codes + count / 3;
+	const std::uint8_t* end = source.data() + source.size() - 16;
+	const std::uint8_t* codeAuxTable = end;
+	for (std::size_t i = 0; i < count; i += 3)
+	{
+		const std::uint8_t code = *codes++;
+		std::uint32_t a, b, c;
+		if (code < 0xF0)
+		{
+			const std::size_t edge = (edgeFifoOffset - 1 - (code >> 4)) & 15;
+			a = edgeFifo[edge][0];
+			b = edgeFifo[edge][1];
+			const int fec = code & 15;
+			if (fec < fifoCodeLimit)
+			{
+				c = fec == 0 ? next++ : vertexFifo[(vertexFifoOffset - 1 - fec) & 15];
+				pushVertex(c, fec == 0);
+			}
+			else
+			{
+				if (fec != 15) last = c = last + (fec == 13 ? -1 : 1);
+				else if (!readIndex(data, end, c)) return false;
+				pushVertex(c);
+			}
+			pushEdge(c, b);
+			pushEdge(a, c);
+		}
+		else
+		{
+			// Triangles that don't share an edge with a recent one
+			std::uint8_t codeAux;
+			int fea;
+			if (code < 0xFE)
+			{
+				codeAux = codeAuxTable[code & 15];
+				fea = 0;
+			}
+			else
+			{
+				if (data == end) return false;
+				codeAux = *data++;
+				fea = code == 0xFE ? 0 : 15;
+				if (codeAux == 0) next = 0; // restart
+			}
+			const int feb = codeAux >> 4;
+			const int fec = codeAux & 15;
+
+			// next is advanced for all three vertices before reading explicit indices, like the encoder does
+			a = fea == 0 ? next++ : 0;
+			b = feb == 0 ? next++ : vertexFifo[(vertexFifoOffset - feb) & 15];
+			c = fec == 0 ? next++ : vertexFifo[(vertexFifoOffset - fec) & 15];
+			if (fea == 15 && !readIndex(data, end, a)) return false;
+			if (feb == 15 && !readIndex(data, end, b)) return false;
+			if (fec == 15 && !readIndex(data, end, c)) return false;
+
+			pushVertex(a);
+			pushVertex(b, feb == 0 || feb == 15);
+			pushVertex(c, fec == 0 || fec == 15);
+			pushEdge(b, a);
+			pushEdge(c, b);
+			pushEdge(a, c);
+		}
+
+		WriteIndex(destination, i, indexSize, a);
+		WriteIndex(destination, i + 1, indexSize, b);
+		WriteIndex(destination, i + 2, indexSize, c);
+	}
+	return data == end;
+}
+
+// Index sequence codec. Every index is a varint delta from one of two baselines, picked by its lowest bit. Versions 0
+// and 1 only differ in how the encoder picks the baseline, so they decode the same.
+static bool DecodeIndexSequence(std::uint8_t* destination, std::size_t count, std::size_t indexSize, std::span<const std::uint8_t> source)
+{
+	if (source.size() < 1 + count + 4 || (source[0] & 0xF0) != 0xD0 || (source[0] & 0x0F) > 1) return false;
+
+	std::uint32_t last[2] = {};
+	const std::uint8_t* data = source.data() + 1;
+	const std::uint8_t* end = source.data() + source.size() - 4;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		std::uint32_t value;
+		if (!ReadVByte(data, end, value)) return false;
+		const int baseline = value & 1;
+		last[baseline] += UnZigZag(value >> 1);
+		WriteIndex(destination, i, indexSize, last[baseline]);
+	}
+	return data == end;
+}
+
+static int RoundToInt(float value)
+{
+	return (int)(value + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+// xy are octahedral coordinates and z holds what 1 encodes to, the result is the unit vector at full precision of T
+template<typename T>
+static void DecodeOctahedral(T* data, std::size_t count)
+{
+	const float maxValue = (float)((1 << (sizeof(T) * 8 - 1)) - 1);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		float x = data[i * 4 + 0];
+		float y = data[i * 4 + 1];
+		const float z = data[i * 4 + 2] - std::fabs(x) - std::fabs(y);
+		const float t = std::min(z, 0.0f);
+		x += x >= 0.0f ? t : -t;
+		y += y >= 0.0f ? t : -t;
+
+		const float scale = maxValue / std::sqrt(x * x + y * y + z * z);
+		data[i * 4 + 0] = (T)RoundToInt(x * scale);
+		data[i * 4 + 1] = (T)RoundToInt(y * scale);
+		data[i * 4 + 2] = (T)RoundToInt(z * scale);
+	}
+}
+
+#ifdef MESHOPT_SSE2
+static __m128i RoundToIntSSE(__m128 value)
+{
+	const __m128 half = _mm_or_ps(_mm_and_ps(value, _mm_set1_ps(-0.0f)), _mm_set1_ps(0.5f));
+	return _mm_cvttps_epi32(_mm_add_ps(value, half));
+}
+
+// Same as DecodeOctahedral<std::int16_t>, 4 vectors at a time
+static void DecodeOctahedral16SSE(std::int16_t* data, std::size_t count)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 maxValue = _mm_set1_ps(32767.0f);
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i* vectors = (__m128i*)(data + i * 4);
+		const __m128i v01 = _mm_loadu_si128(vectors);
+		const __m128i v23 = _mm_loadu_si128(vectors + 1);
+
+		// Transpose to x0..x3 y0..y3 and z0..z3 w0..w3, then sign extend each to 32 bits
+		const __m128i t0 = _mm_unpacklo_epi16(v01, v23);
+		const __m128i t1 = _mm_unpackhi_epi16(v01, v23);
+		const __m128i xy = _mm_unpacklo_epi16(t0, t1);
+		const __m128i zw = _mm_unpackhi_epi16(t0, t1);
+		__m128 x = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(xy, xy), 16));
+		__m128 y = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(xy, xy), 16));
+		__m128 z = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zw, zw), 16));
+		const __m128i w = _mm_srai_epi32(_mm_unpackhi_epi16(zw, zw), 16);
+
+		z = _mm_sub_ps(z, _mm_add_ps(_mm_andnot_ps(signMask, x), _mm_andnot_ps(signMask, y)));
+		const __m128 t = _mm_min_ps(z, _mm_setzero_ps());
+		x = _mm_add_ps(x, _mm_xor_ps(t, _mm_and_ps(x, signMask)));
+		y = _mm_add_ps(y, _mm_xor_ps(t, _mm_and_ps(y, signMask)));
+
+		const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		const __m128 scale = _mm_div_ps(maxValue, _mm_sqrt_ps(lengthSquared));
+		const __m128i xyOut = _mm_packs_epi32(RoundToIntSSE(_mm_mul_ps(x, scale)), RoundToIntSSE(_mm_mul_ps(y, scale)));
+		const __m128i zwOut = _mm_packs_epi32(RoundToIntSSE(_mm_mul_ps(z, scale)), w);
+
+		// And back to x y z w per vertex
+		const __m128i xz = _mm_unpacklo_epi16(xyOut, zwOut);
+		const __m128i yw = _mm_unpackhi_epi16(xyOut, zwOut);
+		_mm_storeu_si128(vectors, _mm_unpacklo_epi16(xz, yw));
+		_mm_storeu_si128(vectors + 1, _mm_unpackhi_epi16(xz, yw));
+	}
+	DecodeOctahedral(data + i * 4, count - i);
+}
+#endif
+
+// The 2 low bits of w pick the largest component, which was dropped, and the rest of w scales the other three
+static void DecodeQuaternion(std::int16_t* data, std::size_t count)
+{
+	const float scale = 1.0f / std::sqrt(2.0f);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		std::int16_t* q = data + i * 4;
+		const float componentScale = scale / (float)(q[3] | 3);
+		const float x = q[0] * componentScale;
+		const float y = q[1] * componentScale;
+		const float z = q[2] * componentScale;
+		const float w = std::sqrt(std::max(1.0f - x * x - y * y - z * z, 0.0f));
+
+		const int maxComponent = q[3] & 3;
+		q[(maxComponent + 1) & 3] = (std::int16_t)RoundToInt(x * 32767.0f);
+		q[(maxComponent + 2) & 3] = (std::int16_t)RoundToInt(y * 32767.0f);
+		q[(maxComponent + 3) & 3] = (std::int16_t)RoundToInt(z * 32767.0f);
+		q[maxComponent] = (std::int16_t)RoundToInt(w * 32767.0f);
+	}
+}
+
+// Each value is a signed 24 bit mantissa in the low bits and a signed 8 bit exponent in the high byte
+static void DecodeExponential(std::uint32_t* data, std::size_t count)
+{
+	std::size_t i = 0;
+#ifdef MESHOPT_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+		const __m128i mantissa = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+		const __m128i exponent = _mm_srai_epi32(v, 24);
+		const __m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127)), 23));
+		_mm_storeu_si128((__m128i*)(data + i), _mm_castps_si128(_mm_mul_ps(power, _mm_cvtepi32_ps(mantissa))));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const std::int32_t mantissa = (std::int32_t)(data[i] << 8) >> 8;
+		const std::int32_t exponent = (std::int32_t)data[i] >> 24;
+		// 2^exponent built directly in the float's exponent bits
+		const std::uint32_t powerBits = (std::uint32_t)(exponent + 127) << 23;
+		float power;
+		std::memcpy(&power, &powerBits, sizeof(power));
+		const float value = power * (float)mantissa;
+		std::memcpy(data + i, &value, sizeof(value));
+	}
+}
+
+bool DecodeMeshoptBufferView(std::span<std::uint8_t> destination, std::size_t count, std::size_t byteStride, MeshoptMode mode, MeshoptFilter filter,
+	std::span<const std::uint8_t> source)
+{
+	if (destination.size() != count * byteStride)
+	{
+		return false;
+	}
+
+	switch (mode)
+	{
+	case MeshoptMode::Attributes:
+		if (!DecodeVertexBuffer(destination.data(), count, byteStride, source)) return false;
+		break;
+	case MeshoptMode::Triangles:
+		if (filter != MeshoptFilter::None || (byteStride != 2 && byteStride != 4)) return false;
+		return DecodeIndexBuffer(destination.data(), count, byteStride, source);
+	case MeshoptMode::Indices:
+		if (filter != MeshoptFilter::None || (byteStride != 2 && byteStride != 4)) return false;
+		return DecodeIndexSequence(destination.data(), count, byteStride, source);
+	}
+
+	// Filters only apply to attributes, in place on the decoded vertices
+	switch (filter)
+	{
+	case MeshoptFilter::None:
+		return true;
+	case MeshoptFilter::Octahedral:
+		if (byteStride == 4)
+		{
+			DecodeOctahedral((std::int8_t*)destination.data(), count);
+			return true;
+		}
+		if (byteStride == 8)
+		{
+#ifdef MESHOPT_SSE2
+			DecodeOctahedral16SSE((std::int16_t*)destination.data(), count);
+#else
+			DecodeOctahedral((std::int16_t*)destination.data(), count);
+#endif
+			return true;
+		}
+		return false;
+	case MeshoptFilter::Quaternion:
+		if (byteStride != 8) return false;
+		DecodeQuaternion((std::int16_t*)destination.data(), count);
+		return true;
+	case MeshoptFilter::Exponential:
+		if (byteStride % 4 != 0) return false;
+		DecodeExponential((std::uint32_t*)destination.data(), count * byteStride / 4);
+		return true;
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// EXT_meshopt_compression buffer view decoding, following the bitstream described in the extension's spec
+enum class MeshoptMode
+{
+	Attributes, // vertex codec, any stride that's a multiple of 4
+	Triangles,  // index codec, 2 or 4 byte triangle list indices
+	Indices,    // index sequence codec, 2 or 4 byte indices in any order
+};
+
+enum class MeshoptFilter
+{
+	None,
+	Octahedral,  // 4 snorm8 or snorm16 components, xyz is a unit vector
+	Quaternion,  // 4 snorm16 components, a unit quaternion
+	Exponential, // 32 bit floats stored as a 24 bit mantissa and an 8 bit exponent
+};
+
+// Parses the extension's mode and filter strings, returns false for unknown ones
+bool ParseMeshoptMode(const std::string& name, MeshoptMode& mode);
+bool ParseMeshoptFilter(const std::string& name, MeshoptFilter& filter);
+
+// Decodes count elements of byteStride bytes each from source into destination, which must be count * byteStride bytes,
+// then applies the filter. Returns false if source is malformed or the mode, filter and stride don't go together.
+bool DecodeMeshoptBufferView(std::span<std::uint8_t> destination, std::size_t count, std::size_t byteStride, MeshoptMode mode, MeshoptFilter filter,
+	std::span<const std::uint8_t> source);
\ No newline at end of file
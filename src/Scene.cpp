@@ -7,7 +7,7 @@
 
 // TODO: move rendering stuff to its own class, otherwise buffers will be needlessly duplicated for each scene
 
-Scene::Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW, int fbH, GLuint fbo,
+Scene::Scene(const tinygltf::Scene& scene, const GLTFAsset& asset, GLTFResources&& loadedResources, int fbW, int fbH, GLuint fbo,
 	GLuint fullscreenQuadVAO,
 	GLuint colorTexture,
 	GLuint highlightFBO,
@@ -15,12 +15,13 @@ Scene::Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW
 	GLuint lightsUBO,
 	GLuint skyboxVAO,
 	GLuint environmentMap,
-	GLuint irradianceMap, 
 	GLuint prefilterMap,
-	GLuint brdfLUT)
-	:resources(model), fbo(fbo), fullscreenQuadVAO(fullscreenQuadVAO), colorTexture(colorTexture), highlightFBO(highlightFBO), depthStencilRBO(depthStencilRBO), fbW(fbW), fbH(fbH), lightsUBO(lightsUBO), skyboxVAO(skyboxVAO), environmentMap(environmentMap), irradianceMap(irradianceMap), prefilterMap(prefilterMap),
+	GLuint brdfLUT,
+	const AnimationCompression& animationCompression)
+	:resources(std::move(loadedResources)), fbo(fbo), fullscreenQuadVAO(fullscreenQuadVAO), colorTexture(colorTexture), highlightFBO(highlightFBO), depthStencilRBO(depthStencilRBO), fbW(fbW), fbH(fbH), lightsUBO(lightsUBO), skyboxVAO(skyboxVAO), environmentMap(environmentMap), prefilterMap(prefilterMap),
 	 brdfLUT(brdfLUT)
 {
+	const tinygltf::Model& model = asset.model;
 	assert(model.scenes.size() == 1); // for now
 
 	int defaultEntityNameSuffix = 0;
@@ -45,12 +46,13 @@ Scene::Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW
 		if (node.mesh >= 0)
 		{
 			entity.meshIdx = node.mesh;
-			Mesh& entityMesh = resources.meshes[entity.meshIdx];
-			// TODO: add support for more than 2 morph targets
-			bool hasMorphTargets = entityMesh.HasMorphTargets();
-			if (hasMorphTargets)
+			// Starts out at the node's default weights, or the mesh's if the node has none
+			const Mesh& entityMesh = resources.meshes[entity.meshIdx];
+			const std::vector<double>& defaultWeights = node.weights.empty() ? model.meshes[node.mesh].weights : node.weights;
+			entity.morphTargetWeights.resize(entityMesh.MorphTargetCount(), 0.0f);
+			for (int i = 0; i < entity.morphTargetWeights.size() && i < defaultWeights.size(); i++)
 			{
-				entity.morphTargetWeights.resize(2);
+				entity.morphTargetWeights[i] = (float)defaultWeights[i];
 			}
 		}
 
@@ -88,15 +90,14 @@ Scene::Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW
 		auto& skeleton = skeletons.back();
 		int numJoints = skin.joints.size();
 
-		std::vector<std::uint8_t> inverseBindMatricesBytes = GetAccessorBytes(model.accessors[skin.inverseBindMatrices], model);
-		assert(inverseBindMatricesBytes.size() == sizeof(glm::mat4) * numJoints);
-		std::span<glm::mat4> inverseBindMatrices((glm::mat4*)(inverseBindMatricesBytes.data()), numJoints);
+		const AccessorView inverseBindMatrices(model.accessors[skin.inverseBindMatrices], asset);
+		assert(inverseBindMatrices.count == numJoints);
 
 		for (int i = 0; i < numJoints; i++)
 		{
 			skeleton.joints.emplace_back();
 			auto& joint = skeleton.joints.back();
-			joint.localToJoint = glm::mat4x3(inverseBindMatrices[i]);
+			joint.localToJoint = glm::mat4x3(inverseBindMatrices.Get<glm::mat4>(i));
 			joint.entityIndex = skin.joints[i];
 			int parentEntityIndex = entities[joint.entityIndex].parent;
 			if (parentEntityIndex < 0)
@@ -128,103 +129,42 @@ Scene::Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW
 	// Animations
 	for (const auto& gltfAnimation : model.animations)
 	{
-		animations.emplace_back();
-		Animation& animation = animations.back();
-
-		double animationDurationSeconds = GetAnimationDurationSeconds(gltfAnimation, model);
-		animation.durationSeconds = (float)animationDurationSeconds;
-
-		if (gltfAnimation.name.empty())
+		Animation animation = LoadAnimation(gltfAnimation, asset);
+		if (animation.name.empty())
 		{
 			animation.name = "Anim " + std::to_string(defaultAnimationNameSuffix++);
 		}
-		else
-		{
-			animation.name = gltfAnimation.name;
-		}
-			
-		for (const auto& channel : gltfAnimation.channels)
-		{
-			Entity* sceneEntity = &entities[channel.target_node];
-			
-			// Entity might already have another animated channel in this animation, check if so
-			auto entityAnimationIter = std::find_if(animation.entityAnimations.begin(), animation.entityAnimations.end(),
-				[&channel](const EntityAnimation& entityAnimation)
-				{
-					return entityAnimation.entityIdx == channel.target_node;
-				});
-			EntityAnimation* entityAnimation;
-			if (entityAnimationIter != animation.entityAnimations.end())
-			{
-				entityAnimation = &(*entityAnimationIter);
-			}
-			else
-			{
-				animation.entityAnimations.emplace_back();
-				entityAnimation = &animation.entityAnimations.back();
-			}
-				
-			entityAnimation->entityIdx = channel.target_node;
-
-			const auto& sampler = gltfAnimation.samplers[channel.sampler];
-			InterpolationType method = InterpolationType::LINEAR;
-			if (sampler.interpolation == "STEP") method = InterpolationType::STEP;
-			else if (sampler.interpolation == "CUBICSPLINE") method = InterpolationType::CUBICSPLINE;
-			assert(channel.target_path != "weights" || method == InterpolationType::LINEAR && "Non-linear interpolation not supported for weights currently");
-			const auto& keyframeTimesAccessor = model.accessors[sampler.input];
-			const auto& keyframeValuesAccessor = model.accessors[sampler.output];
-			if (channel.target_path == "translation")
-			{
-				auto translationsBytes = GetAccessorBytes(keyframeValuesAccessor, model);
-				std::span<glm::vec3> translations((glm::vec3*)translationsBytes.data(), keyframeValuesAccessor.count);
-
-				auto timesBytes = GetAccessorBytes(keyframeTimesAccessor, model);
-				std::span<float> times((float*)timesBytes.data(), keyframeTimesAccessor.count);
-
-				entityAnimation->translations.values.assign(translations.begin(), translations.end());
-				entityAnimation->translations.times.assign(times.begin(), times.end());
-				entityAnimation->translations.method = method;
-			}
-			else if (channel.target_path == "scale")
-			{
-				auto scalesBytes = GetAccessorBytes(keyframeValuesAccessor, model);
-				std::span<glm::vec3> scales((glm::vec3*)scalesBytes.data(), keyframeValuesAccessor.count);
-
-				auto timesBytes = GetAccessorBytes(keyframeTimesAccessor, model);
-				std::span<float> times((float*)timesBytes.data(), keyframeTimesAccessor.count);
-
-				entityAnimation->scales.values.assign(scales.begin(), scales.end());
-				entityAnimation->scales.times.assign(times.begin(), times.end());
-				entityAnimation->scales.method = method;
-			}
-			else if (channel.target_path == "rotation")
-			{
-				auto rotationsBytes = GetAccessorBytes(keyframeValuesAccessor, model);
-				std::span<glm::quat> rotations((glm::quat*)rotationsBytes.data(), keyframeValuesAccessor.count);
 
-				auto timesBytes = GetAccessorBytes(keyframeTimesAccessor, model);
-				std::span<float> times((float*)timesBytes.data(), keyframeTimesAccessor.count);
-
-				entityAnimation->rotations.values.assign(rotations.begin(), rotations.end());
-				entityAnimation->rotations.times.assign(times.begin(), times.end());
-				entityAnimation->rotations.method = method;
-			}
-			else
-			{
-				auto weightsBytes = GetAccessorBytes(keyframeValuesAccessor, model);
-				std::span<float> weights((float*)weightsBytes.data(), keyframeValuesAccessor.count);
-
-				auto timesBytes = GetAccessorBytes(keyframeTimesAccessor, model);
-				std::span<float> times((float*)timesBytes.data(), keyframeTimesAccessor.count);
+		animations.push_back(CompileAnimationClip(animation, entities, animationCompression));
+	}
 
-				entityAnimation->weights.values.assign(weights.begin(), weights.end());
-				entityAnimation->weights.times.assign(times.begin(), times.end());
-				entityAnimation->weights.method = method;
-			}
+	// Every entity's weights are uploaded together once a frame, each entity's shaders find them at its offset
+	morphWeightOffsets.resize(entities.size(), -1);
+	for (int i = 0; i < entities.size(); i++)
+	{
+		if (!entities[i].morphTargetWeights.empty())
+		{
+			morphWeightOffsets[i] = (int)morphWeights.size();
+			morphWeights.resize(morphWeights.size() + entities[i].morphTargetWeights.size());
 		}
 	}
+	if (!morphWeights.empty())
+	{
+		morphWeightsBuffer = GLBuffer::Create();
+		glBindBuffer(GL_TEXTURE_BUFFER, morphWeightsBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, morphWeights.size() * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+		morphWeightsTexture = GLTexture::Create();
+		glBindTexture(GL_TEXTURE_BUFFER, morphWeightsTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, morphWeightsBuffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
 
 	animationEnabled.resize(animations.size(), true);
+	for (const AnimationClip& clip : animations)
+	{
+		animationCursors.emplace_back(clip.CursorCount());
+	}
 
 	controllableCamera.name = "Controllable Camera";
 	int defaultCameraNameSuffix = 0;
@@ -365,16 +305,10 @@ Scene::Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW
 		dirLightEntity.lightIdx = 2;
 	}
 
-	depthMapFBOs.resize(lights.size());
-	depthMaps.resize(lights.size());
-	if (lights.size() > 0)
-	{
-		glGenFramebuffers(lights.size(), &depthMapFBOs.front());
-		glGenTextures(lights.size(), &depthMaps.front());
-	}
-
 	for (int i = 0; i < lights.size(); i++)
 	{
+		depthMapFBOs.push_back(GLFramebuffer::Create());
+		depthMaps.push_back(GLTexture::Create());
 		GenerateShadowMap(i);
 	}
 
@@ -390,11 +324,10 @@ Scene::Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW
 		angle += angleDelta;
 	}
 
-	glGenVertexArrays(1, &circleVAO);
+	circleVAO = GLVertexArray::Create();
 	glBindVertexArray(circleVAO);
 	
-	GLuint circleVBO;
-	glGenBuffers(1, &circleVBO);
+	circleVBO = GLBuffer::Create();
 	glBindBuffer(GL_ARRAY_BUFFER, circleVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(circleVertices[0]) * circleVertices.size(), &circleVertices.front(), GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
@@ -402,20 +335,19 @@ Scene::Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW
 
 
 	glm::vec3 lineVertices[2] = { glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
-	glGenVertexArrays(1, &lineVAO);
+	lineVAO = GLVertexArray::Create();
 	glBindVertexArray(lineVAO);
 	
-	GLuint lineVBO;
-	glGenBuffers(1, &lineVBO);
+	lineVBO = GLBuffer::Create();
 	glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
 	glBufferData(GL_ARRAY_BUFFER, 24, &lineVertices[0], GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
-	glGenVertexArrays(1, &frustumVAO);
+	frustumVAO = GLVertexArray::Create();
 	glBindVertexArray(frustumVAO);
 
-	glGenBuffers(1, &frustumVBO);
+	frustumVBO = GLBuffer::Create();
 	glBindBuffer(GL_ARRAY_BUFFER, frustumVBO);
 	// 24 vertices for 12 lines, 4 on the near plane, 4 on the far plane, and 4 connecting the 2
 	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * 24, nullptr, GL_STATIC_DRAW);
@@ -507,11 +439,6 @@ void Scene::Render(int windowWidth, int windowHeight)
 					shader.SetMat3("normalMatrixVS", glm::value_ptr(normalMatrix));
 				}
 
-				glActiveTexture(GL_TEXTURE0 + textureUnit);
-				glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-				shader.SetInt("irradianceMap", textureUnit);
-				textureUnit++;
-
 				glActiveTexture(GL_TEXTURE0 + textureUnit);
 				glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
 				shader.SetInt("prefilterMap", textureUnit);
@@ -613,11 +540,9 @@ void Scene::Render(int windowWidth, int windowHeight)
 				auto skinningMatrices = ComputeSkinningMatrices(skeletons[entity.skeletonIdx], entities);
 				shader.SetMat4("skinningMatrices", glm::value_ptr(skinningMatrices.front()), (int)skinningMatrices.size());
 			}
-			bool hasMorphTargets = HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET0_POSITION);
-			if (hasMorphTargets)
+			if (submesh.morphTargetCount > 0)
 			{
-				shader.SetFloat("morph1Weight", entity.morphTargetWeights[0]);
-				shader.SetFloat("morph2Weight", entity.morphTargetWeights[1]);
+				textureUnit = SetMorphTargetUniforms(shader, submesh, i, textureUnit);
 			}
 			if (submesh.materialIndex >= 0)
 			{
@@ -663,15 +588,7 @@ void Scene::Render(int windowWidth, int windowHeight)
 					textureUnit++;
 				}
 			}
-			glBindVertexArray(submesh.VAO);
-			if (submesh.hasIndexBuffer)
-			{
-				glDrawElements(GL_TRIANGLES, submesh.countVerticesOrIndices, GL_UNSIGNED_INT, nullptr);
-			}
-			else
-			{
-				glDrawArrays(GL_TRIANGLES, 0, submesh.countVerticesOrIndices);
-			}
+			submesh.Draw();
 		}
 	}
 
@@ -794,21 +711,11 @@ void Scene::RenderShadowMaps()
 						auto skinningMatrices = ComputeSkinningMatrices(skeletons[entity.skeletonIdx], entities);
 						depthShader.SetMat4("skinningMatrices", glm::value_ptr(skinningMatrices.front()), (int)skinningMatrices.size());
 					}
-					bool hasMorphTargets = HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET0_POSITION);
-					if (hasMorphTargets)
-					{
-						depthShader.SetFloat("morph1Weight", entity.morphTargetWeights[0]);
-						depthShader.SetFloat("morph2Weight", entity.morphTargetWeights[1]);
-					}
-					glBindVertexArray(submesh.VAO);
-					if (submesh.hasIndexBuffer)
-					{
-						glDrawElements(GL_TRIANGLES, submesh.countVerticesOrIndices, GL_UNSIGNED_INT, nullptr);
-					}
-					else
+					if (submesh.morphTargetCount > 0)
 					{
-						glDrawArrays(GL_TRIANGLES, 0, submesh.countVerticesOrIndices);
+						SetMorphTargetUniforms(depthShader, submesh, entityIdx, 0);
 					}
+					submesh.Draw();
 				}
 			}
 		}
@@ -836,18 +743,10 @@ void Scene::UpdateAndRender(const Input& input)
 			const auto& anim = animations[i];
 
 			float normalizedTime = std::fmod(time, anim.durationSeconds);
-
-			for (const auto& entityAnim : anim.entityAnimations)
-			{
-				Entity& entity = entities[entityAnim.entityIdx];
-
-				if (entityAnim.translations.values.size() > 0) entity.transform.translation = SampleAt(entityAnim.translations, normalizedTime);
-				if (entityAnim.scales.values.size() > 0) entity.transform.scale = SampleAt(entityAnim.scales, normalizedTime);
-				if (entityAnim.rotations.values.size() > 0) entity.transform.rotation = SampleAt(entityAnim.rotations, normalizedTime);
-				if (entityAnim.weights.values.size() > 0) entity.morphTargetWeights = SampleWeightsAt(entityAnim.weights, normalizedTime);
-			}
+			SampleAnimationClip(anim, normalizedTime, animationCursors[i], entities);
 		}
 	}
+	UploadMorphWeights();
 
 	RenderUI();
 	UpdateGlobalTransforms();
@@ -885,7 +784,7 @@ void Scene::RenderUI()
 	ImGui::SliderFloat("Exposure", &exposure, 0.0f, 10.0f);
 	static std::vector<std::string> backgrounds = {
 		"Environment map",
-		"Irradiance map",
+		"Irradiance (SH)",
 		"Prefilter map"
 	};
 	const int num_models = (int)backgrounds.size();
@@ -945,8 +844,7 @@ void Scene::RenderUI()
 					// Old texture must be deleted and regenerated before binding it to a new texture type.
 					if (oldType == Light::Point || light.type == Light::Point)
 					{
-						glDeleteTextures(1, &depthMaps[selectedEntity.lightIdx]);
-						glGenTextures(1, &depthMaps[selectedEntity.lightIdx]);
+						depthMaps[selectedEntity.lightIdx] = GLTexture::Create();
 						GenerateShadowMap(selectedEntity.lightIdx);
 					}
 				}
@@ -1253,8 +1151,7 @@ void Scene::RenderSelectedEntityVisuals(const glm::mat4& viewProj)
 			glBindTexture(GL_TEXTURE_CUBE_MAP, depthMaps[entity.lightIdx]);
 			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_NONE); // Treat as normal texture so we can visualize it
 			
-			GLuint debugRenderFaceTextureView;
-			glGenTextures(1, &debugRenderFaceTextureView);
+			const GLTexture debugRenderFaceTextureView = GLTexture::Create();
 			glTextureView(debugRenderFaceTextureView, GL_TEXTURE_2D, depthMaps[entity.lightIdx], GL_DEPTH_COMPONENT24, 0, 1, light.debugShadowMapRenderFace, 1);
 			glBindTexture(GL_TEXTURE_2D, debugRenderFaceTextureView);
 			perspectiveDepthCubeMapShader.use();
@@ -1444,6 +1341,7 @@ void Scene::RenderSkybox(const glm::mat4& view, const glm::mat4& proj)
 	skyboxShader.SetMat4("projection", glm::value_ptr(proj));
 	skyboxShader.SetMat4("rotView", glm::value_ptr(rotView));
 	glActiveTexture(GL_TEXTURE0);
+	skyboxShader.SetBool("showIrradiance", selectedBackgroundIdx == 1);
 	if (selectedBackgroundIdx == 0)
 	{
 		skyboxShader.SetFloat("levelOfDetail", 0.0f);
@@ -1451,8 +1349,9 @@ void Scene::RenderSkybox(const glm::mat4& view, const glm::mat4& proj)
 	}
 	else if (selectedBackgroundIdx == 1)
 	{
+		// Evaluated from the SH, the texture is only bound so the sampler isn't left dangling
 		skyboxShader.SetFloat("levelOfDetail", 0.0f);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
 	}
 	else
 	{
@@ -1466,6 +1365,50 @@ void Scene::RenderSkybox(const glm::mat4& view, const glm::mat4& proj)
 	glEnable(GL_CULL_FACE);
 }
 
+void Scene::UploadMorphWeights()
+{
+	if (morphWeights.empty())
+	{
+		return;
+	}
+
+	for (int i = 0; i < entities.size(); i++)
+	{
+		if (morphWeightOffsets[i] >= 0)
+		{
+			std::copy(entities[i].morphTargetWeights.begin(), entities[i].morphTargetWeights.end(), morphWeights.begin() + morphWeightOffsets[i]);
+		}
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, morphWeightsBuffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, morphWeights.size() * sizeof(float), morphWeights.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+int Scene::SetMorphTargetUniforms(Shader& shader, const Submesh& submesh, int entityIdx, int textureUnit)
+{
+	assert(morphWeightOffsets[entityIdx] >= 0);
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, submesh.morphDeltaTexture);
+	shader.SetInt("morphTargetDeltas", textureUnit);
+	textureUnit++;
+
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, submesh.morphIndexTexture);
+	shader.SetInt("morphTargetIndices", textureUnit);
+	textureUnit++;
+
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, morphWeightsTexture);
+	shader.SetInt("morphWeights", textureUnit);
+	textureUnit++;
+
+	shader.SetInt("morphDenseTargetCount", submesh.morphDenseTargetCount);
+	shader.SetInt("morphVertexCount", submesh.morphVertexCount);
+	shader.SetInt("morphDeltaStride", submesh.morphDeltaStride);
+	shader.SetInt("morphWeightOffset", morphWeightOffsets[entityIdx]);
+	return textureUnit;
+}
+
 void Scene::HighlightEntityHierarchy(int entityIdx, const glm::mat4& viewProj)
 {
 	const Entity& entity = entities[entityIdx];
@@ -1484,21 +1427,11 @@ void Scene::HighlightEntityHierarchy(int entityIdx, const glm::mat4& viewProj)
 				auto skinningMatrices = ComputeSkinningMatrices(skeletons[entity.skeletonIdx], entities);
 				highlightShader.SetMat4("skinningMatrices", glm::value_ptr(skinningMatrices.front()), (int)skinningMatrices.size());
 			}
-			bool hasMorphTargets = HasFlag(submesh.flags, VertexAttribute::MORPH_TARGET0_POSITION);
-			if (hasMorphTargets)
-			{
-				highlightShader.SetFloat("morph1Weight", entity.morphTargetWeights[0]);
-				highlightShader.SetFloat("morph2Weight", entity.morphTargetWeights[1]);
-			}
-			glBindVertexArray(submesh.VAO);
-			if (submesh.hasIndexBuffer)
+			if (submesh.morphTargetCount > 0)
 			{
-				glDrawElements(GL_TRIANGLES, submesh.countVerticesOrIndices, GL_UNSIGNED_INT, nullptr);
-			}
-			else
-			{
-				glDrawArrays(GL_TRIANGLES, 0, submesh.countVerticesOrIndices);
+				SetMorphTargetUniforms(highlightShader, submesh, entityIdx, 0);
 			}
+			submesh.Draw();
 		}
 	}
 
@@ -1610,3 +1543,42 @@ void Scene::GenerateShadowMap(int lightIdx)
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 }
+
+
+template<typename T>
+static std::size_t VectorBytes(const std::vector<T>& vector)
+{
+	return vector.capacity() * sizeof(T);
+}
+
+SceneMemoryUsage Scene::MemoryUsage() const
+{
+	SceneMemoryUsage usage;
+	usage.gpuBytes = resources.GPUBytes();
+	for (const Light& light : lights)
+	{
+		// Depth textures are 24 bit, which drivers store in 32
+		const std::size_t shadowMapBytes = (std::size_t)shadowMapWidth * shadowMapHeight * 4;
+		usage.gpuBytes += light.type == Light::Point ? 6 * shadowMapBytes : shadowMapBytes;
+	}
+	usage.gpuBytes += sizeof(glm::vec3) * (numCircleVertices + 2 + 24); // circle, line and frustum visuals
+
+	usage.cpuBytes = sizeof(Scene);
+	for (const AnimationClip& clip : animations)
+	{
+		usage.cpuBytes += clip.Bytes();
+	}
+	usage.cpuBytes += VectorBytes(entities);
+	for (const Entity& entity : entities)
+	{
+		usage.cpuBytes += entity.name.capacity() + VectorBytes(entity.children) + VectorBytes(entity.morphTargetWeights);
+	}
+	usage.cpuBytes += VectorBytes(skeletons);
+	for (const Skeleton& skeleton : skeletons)
+	{
+		usage.cpuBytes += VectorBytes(skeleton.joints);
+	}
+	usage.cpuBytes += VectorBytes(globalTransforms) + VectorBytes(cameras) + VectorBytes(lights) + VectorBytes(animationEnabled) +
+		VectorBytes(resources.meshes) + VectorBytes(resources.textures) + VectorBytes(resources.materials);
+	return usage;
+}
\ No newline at end of file
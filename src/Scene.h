@@ -1,20 +1,29 @@
 #pragma once
 
-#include "Animation.h"
+#include "AnimationClip.h"
 #include "Camera.h"
 #include "Entity.h"
+#include "GLHandle.h"
 #include "GLTFResources.h"
 #include "Input.h"
 #include "Light.h"
 #include "Shader.h"
 #include "Skeleton.h"
 #include "tiny_gltf/tiny_gltf.h"
+#include <cstddef>
 #include <vector>
 
+struct SceneMemoryUsage
+{
+	std::size_t cpuBytes = 0;
+	std::size_t gpuBytes = 0;
+};
+
+// Owns every GL object it creates, they're released when it's destroyed. Holds a pointer into itself, so it can't be moved.
 class Scene
 {
 public:
-	Scene(const tinygltf::Scene& scene, const tinygltf::Model& model, int fbW, int fbH, GLuint fbo,
+	Scene(const tinygltf::Scene& scene, const GLTFAsset& asset, GLTFResources&& loadedResources, int fbW, int fbH, GLuint fbo,
 		GLuint fullscreenQuadVAO,
 		GLuint colorTexture,
 		GLuint highlightFBO,
@@ -22,11 +31,15 @@ public:
 		GLuint lightsUBO,
 		GLuint skyboxVAO,
 		GLuint environmentMap,
-		GLuint irradianceMap,
 		GLuint prefilterMap,
-		GLuint brdfLUT
+		GLuint brdfLUT,
+		const AnimationCompression& animationCompression = {}
 		);
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
 	void UpdateAndRender(const Input& input);
+	// Roughly what this scene holds on to. GL objects passed in to the constructor are shared and not counted.
+	SceneMemoryUsage MemoryUsage() const;
 	float time = 0.0f; // TODO: remove
 	float exposure = 1.0f;
 private:
@@ -46,15 +59,23 @@ private:
 	void ConfigureCamera(const BBox& bbox);
 	void RenderSkybox(const glm::mat4& view, const glm::mat4& proj);
 	void HighlightEntityHierarchy(int entityIdx, const glm::mat4& mvp);
-	std::vector<Animation> animations;
+	void UploadMorphWeights();
+	// Binds the submesh's deltas, their indices and the weights at textureUnit and the 2 after it, returns the next free unit
+	int SetMorphTargetUniforms(Shader& shader, const Submesh& submesh, int entityIdx, int textureUnit);
+	std::vector<AnimationClip> animations;
 	std::vector<Entity> entities;
 	std::vector<glm::mat4> globalTransforms;
 	std::vector<Skeleton> skeletons;
 	std::vector<Camera> cameras;
 	std::vector<Light> lights;
-	std::vector<GLuint> depthMapFBOs; // TODO: sync these to lights in a smarter way. Switching light type poses problems for how it's currently being done
-	std::vector<GLuint> depthMaps;
+	std::vector<GLFramebuffer> depthMapFBOs; // TODO: sync these to lights in a smarter way. Switching light type poses problems for how it's currently being done
+	std::vector<GLTexture> depthMaps;
 	std::vector<std::uint8_t> animationEnabled; // avoiding vector<bool> to allow imgui to have bool references to elements 
+	std::vector<std::vector<KeyframeCursor>> animationCursors; // parallel to animations, CursorCount() each
+	std::vector<float> morphWeights; // every entity's morphTargetWeights back to back, as uploaded to morphWeightsBuffer
+	std::vector<int> morphWeightOffsets; // parallel to entities, -1 for entities without morph targets
+	GLBuffer morphWeightsBuffer;
+	GLTexture morphWeightsTexture; // GL_R32F buffer texture view of morphWeightsBuffer
 	Camera controllableCamera;
 	Camera* currentCamera = &controllableCamera;
 	GLTFResources resources;
@@ -77,16 +98,17 @@ private:
 	GLuint highlightFBO;
 	GLuint depthStencilRBO;
 	GLuint lightsUBO;
-	GLuint circleVAO; // TODO: find a better place for visual vertex buffers
+	GLVertexArray circleVAO; // TODO: find a better place for visual vertex buffers
+	GLBuffer circleVBO;
 	const int numCircleVertices = 200;
-	GLuint lineVAO;
-	GLuint frustumVAO;
-	GLuint frustumVBO;
+	GLVertexArray lineVAO;
+	GLBuffer lineVBO;
+	GLVertexArray frustumVAO;
+	GLBuffer frustumVBO;
 	int fbW, fbH;
 	bool firstFrame = true;
 	GLuint skyboxVAO;
 	GLuint environmentMap;
-	GLuint irradianceMap;
 	GLuint prefilterMap;
 	GLuint brdfLUT;
 	int selectedBackgroundIdx = 0;
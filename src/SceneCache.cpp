@@ -0,0 +1,82 @@
+#include "SceneCache.h"
+
+#include <cassert>
+#include <iostream>
+#include <utility>
+
+SceneCache::SceneCache(std::size_t cpuBudgetBytes, std::size_t gpuBudgetBytes)
+	:cpuBudgetBytes(cpuBudgetBytes), gpuBudgetBytes(gpuBudgetBytes)
+{
+}
+
+Scene* SceneCache::Find(const std::string& name)
+{
+	auto iter = lookup.find(name);
+	if (iter == lookup.end())
+	{
+		return nullptr;
+	}
+	entries.splice(entries.begin(), entries, iter->second);
+	return entries.front().scene.get();
+}
+
+Scene* SceneCache::Insert(const std::string& name, std::unique_ptr<Scene> scene)
+{
+	assert(scene);
+	auto iter = lookup.find(name);
+	if (iter != lookup.end())
+	{
+		entries.erase(iter->second);
+		lookup.erase(iter);
+	}
+
+	const SceneMemoryUsage usage = scene->MemoryUsage();
+	entries.push_front({ name, std::move(scene), usage });
+	lookup[name] = entries.begin();
+	EvictOverBudget();
+	return entries.front().scene.get();
+}
+
+void SceneCache::SetBudget(std::size_t cpuBudgetBytes, std::size_t gpuBudgetBytes)
+{
+	this->cpuBudgetBytes = cpuBudgetBytes;
+	this->gpuBudgetBytes = gpuBudgetBytes;
+	EvictOverBudget();
+}
+
+void SceneCache::Clear()
+{
+	lookup.clear();
+	entries.clear();
+}
+
+SceneMemoryUsage SceneCache::TotalUsage() const
+{
+	SceneMemoryUsage total;
+	for (const Entry& entry : entries)
+	{
+		total.cpuBytes += entry.usage.cpuBytes;
+		total.gpuBytes += entry.usage.gpuBytes;
+	}
+	return total;
+}
+
+void SceneCache::EvictOverBudget()
+{
+	// Scenes change size a little while shown (shadow maps follow light types), so refresh before deciding
+	for (Entry& entry : entries)
+	{
+		entry.usage = entry.scene->MemoryUsage();
+	}
+
+	SceneMemoryUsage total = TotalUsage();
+	while (entries.size() > 1 && (total.cpuBytes > cpuBudgetBytes || total.gpuBytes > gpuBudgetBytes))
+	{
+		const Entry& evicted = entries.back();
+		std::cout << "Evicting " << evicted.name << " from the scene cache (" << (evicted.usage.cpuBytes >> 20) << " MB CPU, " << (evicted.usage.gpuBytes >> 20) << " MB GPU)\n";
+		total.cpuBytes -= evicted.usage.cpuBytes;
+		total.gpuBytes -= evicted.usage.gpuBytes;
+		lookup.erase(evicted.name);
+		entries.pop_back();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include "Scene.h"
+#include <string>
+#include <unordered_map>
+
+// Keeps loaded scenes around so switching back to one is instant, up to a CPU and a GPU byte budget. Once either is
+// exceeded, the least recently used scenes are destroyed, which releases all their GL objects. The most recently used
+// scene is never evicted, even if it's over budget by itself, since it's the one being displayed.
+class SceneCache
+{
+public:
+	struct Entry
+	{
+		std::string name;
+		std::unique_ptr<Scene> scene;
+		SceneMemoryUsage usage;
+	};
+
+	SceneCache(std::size_t cpuBudgetBytes, std::size_t gpuBudgetBytes);
+	SceneCache(const SceneCache&) = delete;
+	SceneCache& operator=(const SceneCache&) = delete;
+
+	// Returns nullptr if name isn't cached. Otherwise it becomes the most recently used.
+	Scene* Find(const std::string& name);
+	// Replaces any scene with the same name, then evicts until back under budget
+	Scene* Insert(const std::string& name, std::unique_ptr<Scene> scene);
+	void SetBudget(std::size_t cpuBudgetBytes, std::size_t gpuBudgetBytes);
+	// Destroys every scene, must happen before the GL context goes away
+	void Clear();
+
+	// Most recently used first
+	const std::list<Entry>& Entries() const { return entries; }
+	SceneMemoryUsage TotalUsage() const;
+	std::size_t CPUBudget() const { return cpuBudgetBytes; }
+	std::size_t GPUBudget() const { return gpuBudgetBytes; }
+private:
+	void EvictOverBudget();
+
+	std::list<Entry> entries;
+	std::unordered_map<std::string, std::list<Entry>::iterator> lookup;
+	std::size_t cpuBudgetBytes;
+	std::size_t gpuBudgetBytes;
+};
\ No newline at end of file
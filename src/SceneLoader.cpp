@@ -0,0 +1,188 @@
+#include "SceneLoader.h"
+
+#include <cassert>
+#include <cstdio>
+#include <utility>
+
+std::vector<std::pair<std::thread, std::shared_ptr<std::atomic<bool>>>> SceneLoader::cancelledLoads;
+
+SceneLoader::SceneLoader(const std::string& path, const MeshBuildOptions& meshOptions, std::size_t uploadBudgetBytesPerFrame)
+	:job(std::make_shared<Job>()), threadFinished(std::make_shared<std::atomic<bool>>(false)), uploadBudgetBytesPerFrame(uploadBudgetBytesPerFrame)
+{
+	job->path = path;
+	job->meshOptions = meshOptions;
+	// The thread keeps its own reference, so if the load is cancelled the job is freed, and the asset's decodes waited
+	// for, on the background thread rather than this one
+	loadThread = std::thread([job = job, finished = threadFinished]() mutable
+	{
+		LoadInBackground(*job);
+		job.reset();
+		*finished = true;
+	});
+}
+
+SceneLoader::~SceneLoader()
+{
+	Cancel();
+}
+
+void SceneLoader::LoadInBackground(Job& job)
+{
+	GLTFAsset& asset = job.asset;
+	std::string warn;
+	const bool loaded = LoadGLTFAsset(job.path, asset, &job.error, &warn);
+	if (!warn.empty())
+	{
+		printf("Warn: %s\n", warn.c_str());
+	}
+
+	if (loaded)
+	{
+		int count = asset.model.textures.size();
+		for (const tinygltf::Mesh& mesh : asset.model.meshes)
+		{
+			count += mesh.primitives.size();
+		}
+		job.itemCount = count;
+		job.parsed = true;
+
+		if (!job.cancelled)
+		{
+			job.resourceData = BuildGLTFResourceData(asset, &job.itemsBuilt, &job.cancelled, job.meshOptions);
+		}
+	}
+
+	// Textures are uploaded from Update, which must never block on a decode. Once cancelled there's nothing left to
+	// upload, the asset's destructor still waits for the remaining decodes before its files go away.
+	for (const std::shared_future<DecodedImage>& decode : asset.imageDecodes)
+	{
+		if (job.cancelled) break;
+		decode.wait();
+	}
+
+	job.failed = !loaded;
+	job.cpuDone = true;
+}
+
+void SceneLoader::JoinFinishedCancelledLoads()
+{
+	std::erase_if(cancelledLoads, [](auto& load)
+	{
+		if (!*load.second) return false;
+		load.first.join(); // the thread is only returning at this point
+		return true;
+	});
+}
+
+void SceneLoader::WaitForCancelledLoads()
+{
+	for (auto& load : cancelledLoads)
+	{
+		load.first.join();
+	}
+	cancelledLoads.clear();
+}
+
+void SceneLoader::Update()
+{
+	JoinFinishedCancelledLoads();
+
+	if (state == State::Loading && job->cpuDone)
+	{
+		loadThread.join();
+		if (job->failed)
+		{
+			error = job->error;
+			state = State::Failed;
+			return;
+		}
+
+		for (int i = 0; i < job->asset.imageDecodes.size(); i++)
+		{
+			const DecodedImage& decoded = job->asset.WaitForImage(i);
+			if (!decoded.error.empty())
+			{
+				error = decoded.error;
+				state = State::Failed;
+				return;
+			}
+		}
+
+		// Only creates the GL objects, their contents are queued on the uploader
+		uploader.emplace(uploadBudgetBytesPerFrame);
+		resources.emplace(job->asset, job->resourceData, &*uploader);
+		uploadBytesTotal = uploader->BytesPending();
+		state = State::Uploading;
+	}
+
+	if (state == State::Uploading)
+	{
+		uploader->Flush();
+		if (uploader->IsIdle())
+		{
+			job->resourceData = {};
+			uploader.reset();
+			state = State::Ready;
+		}
+	}
+}
+
+void SceneLoader::Cancel()
+{
+	if (state == State::Ready || state == State::Failed || state == State::Cancelled)
+	{
+		if (loadThread.joinable()) loadThread.join();
+		return;
+	}
+
+	// Can't interrupt the glTF parse itself, but mesh building and the wait for image decodes stop early. The thread
+	// isn't waited for, it's joined once it's done.
+	job->cancelled = true;
+	if (loadThread.joinable())
+	{
+		if (job->cpuDone)
+		{
+			loadThread.join();
+		}
+		else
+		{
+			cancelledLoads.emplace_back(std::move(loadThread), threadFinished);
+		}
+	}
+	job.reset();
+	if (uploader)
+	{
+		uploader->Clear();
+		uploader.reset();
+	}
+	resources.reset(); // deletes whatever GL objects were already created
+	state = State::Cancelled;
+}
+
+float SceneLoader::Progress() const
+{
+	// Parsing is 10%, building meshes and compressing textures 40% and uploading the other half
+	switch (state)
+	{
+	case State::Loading:
+	{
+		if (!job->parsed) return 0.0f;
+		const int count = job->itemCount;
+		return 0.1f + (count > 0 ? 0.4f * job->itemsBuilt / count : 0.4f);
+	}
+	case State::Uploading:
+		return 0.5f + (uploadBytesTotal > 0 ? 0.5f * (float)(uploadBytesTotal - uploader->BytesPending()) / uploadBytesTotal : 0.5f);
+	case State::Ready:
+		return 1.0f;
+	default:
+		return 0.0f;
+	}
+}
+
+GLTFResources SceneLoader::TakeResources()
+{
+	assert(state == State::Ready);
+	GLTFResources taken = std::move(*resources);
+	resources.reset();
+	return taken;
+}
\ No newline at end of file
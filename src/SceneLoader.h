@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include "GLTFAsset.h"
+#include "GLTFResources.h"
+#include <optional>
+#include "StagingUploader.h"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads a glTF file without stalling the frame loop. Parsing, image decoding, mesh building and texture compression run on a background
+// thread, then the results are streamed to the GPU a budgeted number of bytes per frame, so whatever scene is currently
+// shown keeps rendering until this one is ready. Must be created, updated and destroyed on the GL context thread.
+class SceneLoader
+{
+public:
+	enum class State
+	{
+		Loading,   // parsing and CPU processing in the background
+		Uploading, // streaming to the GPU from Update
+		Ready,     // Asset and TakeResources can be used to create the Scene
+		Failed,
+		Cancelled
+	};
+
+	explicit SceneLoader(const std::string& path, const MeshBuildOptions& meshOptions = {}, std::size_t uploadBudgetBytesPerFrame = 8 << 20);
+	~SceneLoader(); // Cancels if not done, without waiting for the background thread
+	SceneLoader(const SceneLoader&) = delete;
+	SceneLoader& operator=(const SceneLoader&) = delete;
+
+	// Call once per frame, does this frame's share of GPU uploads
+	void Update();
+	// Returns right away. The background work stops at the next point it can, a glTF parse in progress can't be
+	// interrupted, and its thread is joined by a later Update or WaitForCancelledLoads once it's done.
+	void Cancel();
+	// Blocks until the threads of every cancelled load have finished, call before shutting down
+	static void WaitForCancelledLoads();
+
+	State GetState() const { return state; }
+	float Progress() const; // in [0, 1]
+	const std::string& Error() const { return error; }
+
+	// Only valid once Ready
+	const GLTFAsset& Asset() const { return job->asset; }
+	GLTFResources TakeResources();
+private:
+	// Everything the background thread touches. Shared with the thread, so a cancelled load can be let go of without
+	// waiting for it, the thread frees it when it's done.
+	struct Job
+	{
+		std::string path;
+		MeshBuildOptions meshOptions;
+		std::atomic<bool> cpuDone = false;
+		std::atomic<bool> cancelled = false;
+		std::atomic<bool> parsed = false;
+		std::atomic<int> itemCount = 0; // primitives and textures
+		std::atomic<int> itemsBuilt = 0;
+		bool failed = false; // only read once cpuDone
+		std::string error;
+
+		GLTFAsset asset;
+		GLTFResourceData resourceData;
+	};
+	static void LoadInBackground(Job& job);
+	// Joins the threads of cancelled loads that have finished
+	static void JoinFinishedCancelledLoads();
+
+	// Threads of cancelled loads and whether each has finished. Only touched on the GL context thread.
+	static std::vector<std::pair<std::thread, std::shared_ptr<std::atomic<bool>>>> cancelledLoads;
+
+	std::shared_ptr<Job> job;
+	std::shared_ptr<std::atomic<bool>> threadFinished;
+	std::atomic<State> state = State::Loading;
+	std::string error;
+
+	std::optional<GLTFResources> resources;
+	std::optional<StagingUploader> uploader;
+	std::size_t uploadBudgetBytesPerFrame;
+	std::size_t uploadBytesTotal = 0;
+	std::thread loadThread;
+};
@@ -26,10 +26,13 @@ Shader::Shader(const char * vertexPath, const char * fragmentPath, const char *
 		std::cout << define << '\n';
 	}
 
-	const char* vShaderSources[4] = { version.c_str(), definesString.c_str(), defaultDefinesString.c_str(),  vShaderCode};
+	// Every vertex shader gets the morph target lookup, it compiles to nothing without HAS_MORPH_TARGETS
+	static const std::string morphTargetsSource = get_file_contents("Shaders/morphTargets.glsl");
+
+	const char* vShaderSources[5] = { version.c_str(), definesString.c_str(), defaultDefinesString.c_str(), morphTargetsSource.c_str(), vShaderCode};
 	const char* fShaderSources[4] = { version.c_str(), definesString.c_str(), defaultDefinesString.c_str(), fShaderCode};
 
-	glShaderSource(vertexShader, 4, vShaderSources, NULL);
+	glShaderSource(vertexShader, 5, vShaderSources, NULL);
 	glShaderSource(fragmentShader, 4, fShaderSources, NULL);
 
 	glCompileShader(vertexShader);
@@ -55,7 +58,7 @@ Shader::Shader(const char * vertexPath, const char * fragmentPath, const char *
 		//std::cout << "Fragment shader source:\n" << version + defaultDefinesString + definesString + fShaderCode;
 	}
 
-	id = glCreateProgram();
+	id = GLProgram::Create();
 	glAttachShader(id, vertexShader);
 	glAttachShader(id, fragmentShader);
 
@@ -2,6 +2,7 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include "GLHandle.h"
 
 #include <fstream>
 #include <iostream>
@@ -14,7 +15,7 @@
 class Shader
 {
 public:
-	unsigned int id;
+	GLProgram id; // deleted with the shader, so shaders can only be moved
 	static constexpr int maxPointLights = 5;
 	static constexpr int maxSpotLights = 5;
 	static constexpr int maxDirLights = 5;
@@ -0,0 +1,82 @@
+#include "SphericalHarmonics.h"
+
+#include "Cubemap.h"
+#include "ThreadPool.h"
+#include <vector>
+
+IrradianceSH ComputeIrradianceSH(const float* rgb, int resolution)
+{
+	// Each face is projected on its own task, then the faces are summed
+	double faceSums[6][9][3] = {};
+	double faceSolidAngles[6] = {};
+	ThreadPool::Get().ParallelFor(6, [&](int face)
+	{
+		for (int y = 0; y < resolution; y++)
+		{
+			for (int x = 0; x < resolution; x++)
+			{
+				const glm::vec3 d = CubemapTexelDirection(face, x, y, resolution);
+				const float solidAngle = CubemapTexelSolidAngle(x, y, resolution);
+				const float basis[9] = {
+					0.282095f,
+					0.488603f * d.y,
+					0.488603f * d.z,
+					0.488603f * d.x,
+					1.092548f * d.x * d.y,
+					1.092548f * d.y * d.z,
+					0.315392f * (3.0f * d.z * d.z - 1.0f),
+					1.092548f * d.x * d.z,
+					0.546274f * (d.x * d.x - d.y * d.y),
+				};
+				const float* texel = rgb + (((std::size_t)face * resolution + y) * resolution + x) * 3;
+				for (int i = 0; i < 9; i++)
+				{
+					for (int c = 0; c < 3; c++) faceSums[face][i][c] += texel[c] * basis[i] * solidAngle;
+				}
+				faceSolidAngles[face] += solidAngle;
+			}
+		}
+	});
+
+	double totalSolidAngle = 0.0;
+	for (double solidAngle : faceSolidAngles) totalSolidAngle += solidAngle;
+	const double normalization = 4.0 * 3.14159265358979 / totalSolidAngle;
+
+	// Cosine lobe convolution (pi, 2pi/3, pi/4 per band) divided by pi, times the basis constant the shader leaves out
+	const double factors[9] = {
+		0.282095,
+		2.0 / 3.0 * 0.488603,
+		2.0 / 3.0 * 0.488603,
+		2.0 / 3.0 * 0.488603,
+		0.25 * 1.092548,
+		0.25 * 1.092548,
+		0.25 * 0.315392,
+		0.25 * 1.092548,
+		0.25 * 0.546274,
+	};
+
+	IrradianceSH sh = {};
+	for (int i = 0; i < 9; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			double sum = 0.0;
+			for (int face = 0; face < 6; face++) sum += faceSums[face][i][c];
+			sh.coefficients[i][c] = (float)(sum * normalization * factors[i]);
+		}
+	}
+	return sh;
+}
+
+IrradianceSH ComputeIrradianceSH(GLuint cubemap, int level, int levelResolution)
+{
+	std::vector<float> rgb((std::size_t)6 * levelResolution * levelResolution * 3);
+	const std::size_t faceFloats = (std::size_t)levelResolution * levelResolution * 3;
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	for (int face = 0; face < 6; face++)
+	{
+		glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, GL_FLOAT, rgb.data() + face * faceFloats);
+	}
+	return ComputeIrradianceSH(rgb.data(), levelResolution);
+}
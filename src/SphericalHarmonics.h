@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// L2 spherical harmonics of an environment's irradiance, laid out like the IrradianceSH uniform block (std140, so every
+// RGB coefficient takes a vec4). The basis constants and cosine lobe convolution are already folded in and the result is
+// divided by pi, so the shaders only evaluate the 9 polynomials and multiply by the albedo.
+struct IrradianceSH
+{
+	float coefficients[9][4];
+};
+
+// rgb holds 6 faces of resolution x resolution RGB texels in GL_TEXTURE_CUBE_MAP_POSITIVE_X order
+IrradianceSH ComputeIrradianceSH(const float* rgb, int resolution);
+// Reads one mip of a cubemap back from the GPU and projects it. Small mips are plenty, L2 can't hold any more detail.
+IrradianceSH ComputeIrradianceSH(GLuint cubemap, int level, int levelResolution);
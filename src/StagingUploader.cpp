@@ -0,0 +1,195 @@
+#include "StagingUploader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+StagingUploader::StagingUploader(std::size_t budgetBytesPerFlush, std::size_t stagingBufferSize, int numStagingBuffers)
+	:stagingBufferSize(stagingBufferSize), budgetBytesPerFlush(budgetBytesPerFlush)
+{
+	assert(numStagingBuffers > 0);
+	stagingBuffers.resize(numStagingBuffers);
+	fences.resize(numStagingBuffers, nullptr);
+	glGenBuffers(numStagingBuffers, stagingBuffers.data());
+	for (GLuint stagingBuffer : stagingBuffers)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+		glBufferData(GL_COPY_READ_BUFFER, stagingBufferSize, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+StagingUploader::~StagingUploader()
+{
+	for (GLsync fence : fences)
+	{
+		if (fence) glDeleteSync(fence);
+	}
+	glDeleteBuffers((GLsizei)stagingBuffers.size(), stagingBuffers.data());
+}
+
+void StagingUploader::UploadBuffer(GLuint buffer, std::span<const std::uint8_t> source, std::size_t offset)
+{
+	if (source.empty()) return;
+
+	Job& job = jobs.emplace_back();
+	job.target = buffer;
+	job.isTexture = false;
+	job.source = source;
+	job.bufferOffset = offset;
+	bytesPending += source.size();
+}
+
+static GLenum GetBindTarget(GLenum imageTarget)
+{
+	return imageTarget == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+}
+
+void StagingUploader::UploadTexture2D(GLuint texture, int width, int height, GLenum format, GLenum type, int bytesPerPixel, std::span<const std::uint8_t> source, bool generateMipmaps,
+	int level, GLenum imageTarget)
+{
+	Job& job = jobs.emplace_back();
+	job.target = texture;
+	job.isTexture = true;
+	job.source = source;
+	job.level = level;
+	job.imageTarget = imageTarget;
+	job.width = width;
+	job.height = height;
+	job.format = format;
+	job.type = type;
+	job.rowBytes = width * bytesPerPixel;
+	job.rowHeight = 1;
+	job.compressed = false;
+	job.generateMipmaps = generateMipmaps;
+	assert(job.rowBytes <= stagingBufferSize && "Texture row doesn't fit in a staging buffer");
+	assert(source.size() == (std::size_t)job.rowBytes * height);
+	bytesPending += source.size();
+}
+
+void StagingUploader::UploadCompressedTexture2D(GLuint texture, int level, int width, int height, GLenum internalFormat, std::span<const std::uint8_t> source,
+	GLenum imageTarget)
+{
+	const int blockRows = (height + 3) / 4;
+	Job& job = jobs.emplace_back();
+	job.target = texture;
+	job.isTexture = true;
+	job.source = source;
+	job.level = level;
+	job.imageTarget = imageTarget;
+	job.width = width;
+	job.height = height;
+	job.format = internalFormat;
+	job.type = GL_NONE;
+	job.rowBytes = (int)(source.size() / blockRows);
+	job.rowHeight = 4;
+	job.compressed = true;
+	job.generateMipmaps = false;
+	assert(job.rowBytes <= stagingBufferSize && "Texture row doesn't fit in a staging buffer");
+	assert(source.size() == (std::size_t)job.rowBytes * blockRows);
+	bytesPending += source.size();
+}
+
+void StagingUploader::OnUploaded(std::function<void()> callback)
+{
+	Job& job = jobs.emplace_back();
+	job.target = 0;
+	job.isTexture = false;
+	job.callback = std::move(callback);
+}
+
+std::uint8_t* StagingUploader::MapStagingBuffer(GLenum target, std::size_t size)
+{
+	GLsync& fence = fences[nextStagingBuffer];
+	if (fence)
+	{
+		// Normally signaled long ago, the ring is sized to cover a couple of frames
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	glBindBuffer(target, stagingBuffers[nextStagingBuffer]);
+	return (std::uint8_t*)glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+std::size_t StagingUploader::Flush()
+{
+	std::size_t budgetLeft = budgetBytesPerFlush;
+	std::size_t bytesUploaded = 0;
+	while (!jobs.empty() && budgetLeft > 0)
+	{
+		Job& job = jobs.front();
+		if (job.callback)
+		{
+			job.callback();
+			jobs.pop_front();
+			continue;
+		}
+
+		const std::size_t bytesLeft = job.source.size() - job.bytesDone;
+		std::size_t chunkSize = std::min({ bytesLeft, budgetLeft, stagingBufferSize });
+
+		if (job.isTexture)
+		{
+			// Whole rows only, always at least one so a small budget can't stall the upload
+			const int rowStart = (int)(job.bytesDone / job.rowBytes);
+			const int numRows = std::max((int)(chunkSize / job.rowBytes), 1);
+			chunkSize = (std::size_t)numRows * job.rowBytes;
+
+			std::uint8_t* staging = MapStagingBuffer(GL_PIXEL_UNPACK_BUFFER, chunkSize);
+			std::memcpy(staging, job.source.data() + job.bytesDone, chunkSize);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+			const int y = rowStart * job.rowHeight;
+			const int height = std::min(numRows * job.rowHeight, job.height - y);
+			glBindTexture(GetBindTarget(job.imageTarget), job.target);
+			if (job.compressed)
+			{
+				glCompressedTexSubImage2D(job.imageTarget, job.level, 0, y, job.width, height, job.format, (GLsizei)chunkSize, nullptr);
+			}
+			else
+			{
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				glTexSubImage2D(job.imageTarget, job.level, 0, y, job.width, height, job.format, job.type, nullptr);
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			}
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		else
+		{
+			std::uint8_t* staging = MapStagingBuffer(GL_COPY_READ_BUFFER, chunkSize);
+			std::memcpy(staging, job.source.data() + job.bytesDone, chunkSize);
+			glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+			glBindBuffer(GL_COPY_WRITE_BUFFER, job.target);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, job.bufferOffset + job.bytesDone, chunkSize);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+
+		fences[nextStagingBuffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		nextStagingBuffer = (nextStagingBuffer + 1) % (int)stagingBuffers.size();
+
+		job.bytesDone += chunkSize;
+		bytesPending -= chunkSize;
+		bytesUploaded += chunkSize;
+		budgetLeft -= std::min(chunkSize, budgetLeft);
+
+		if (job.bytesDone == job.source.size())
+		{
+			if (job.isTexture && job.generateMipmaps)
+			{
+				glBindTexture(GetBindTarget(job.imageTarget), job.target);
+				glGenerateMipmap(GetBindTarget(job.imageTarget));
+			}
+			jobs.pop_front();
+		}
+	}
+	return bytesUploaded;
+}
+
+void StagingUploader::Clear()
+{
+	jobs.clear();
+	bytesPending = 0;
+}
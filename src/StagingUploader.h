@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <glad/glad.h>
+#include <span>
+#include <vector>
+
+// Streams buffer and texture contents to the GPU through a small ring of reused pixel buffer objects, at most a fixed
+// number of bytes per Flush, so big uploads can be spread over several frames instead of stalling one.
+// Sources are not copied: they must stay alive until the uploader is idle.
+class StagingUploader
+{
+public:
+	StagingUploader(std::size_t budgetBytesPerFlush, std::size_t stagingBufferSize = 4 << 20, int numStagingBuffers = 4);
+	~StagingUploader();
+	StagingUploader(const StagingUploader&) = delete;
+	StagingUploader& operator=(const StagingUploader&) = delete;
+
+	// buffer must already have storage for source.size() bytes starting at offset
+	void UploadBuffer(GLuint buffer, std::span<const std::uint8_t> source, std::size_t offset = 0);
+	// Fills one mip of a texture whose storage is already allocated, generating the remaining mips once it's complete if asked to.
+	// imageTarget is GL_TEXTURE_2D or one of the GL_TEXTURE_CUBE_MAP_* faces.
+	void UploadTexture2D(GLuint texture, int width, int height, GLenum format, GLenum type, int bytesPerPixel, std::span<const std::uint8_t> source, bool generateMipmaps,
+		int level = 0, GLenum imageTarget = GL_TEXTURE_2D);
+	// Fills one mip of a block compressed texture whose storage is already allocated
+	void UploadCompressedTexture2D(GLuint texture, int level, int width, int height, GLenum internalFormat, std::span<const std::uint8_t> source,
+		GLenum imageTarget = GL_TEXTURE_2D);
+	// Calls callback from Flush once everything queued before it has been uploaded
+	void OnUploaded(std::function<void()> callback);
+
+	// Uploads up to the budget, returns the number of bytes uploaded
+	std::size_t Flush();
+	// Drops all uploads that haven't happened yet
+	void Clear();
+	bool IsIdle() const { return jobs.empty(); }
+	std::size_t BytesPending() const { return bytesPending; }
+private:
+	struct Job
+	{
+		GLuint target; // buffer or texture name
+		bool isTexture;
+		std::function<void()> callback; // set on callback jobs, which upload nothing
+		std::span<const std::uint8_t> source;
+		std::size_t bytesDone = 0;
+		std::size_t bufferOffset = 0; // buffers only, where source goes
+		// Textures only. Uploads happen in whole rows, which are 4 pixels high for compressed textures.
+		int level;
+		GLenum imageTarget;
+		int width, height;
+		GLenum format, type; // format is the internal format for compressed textures
+		int rowBytes;
+		int rowHeight;
+		bool compressed;
+		bool generateMipmaps;
+	};
+
+	// Returns a staging buffer that the GPU is done reading from, bound to target and mapped for writing
+	std::uint8_t* MapStagingBuffer(GLenum target, std::size_t size);
+
+	std::deque<Job> jobs;
+	std::vector<GLuint> stagingBuffers;
+	std::vector<GLsync> fences; // parallel to stagingBuffers, set once the copy out of it was issued
+	int nextStagingBuffer = 0;
+	std::size_t stagingBufferSize;
+	std::size_t budgetBytesPerFlush;
+	std::size_t bytesPending = 0;
+};
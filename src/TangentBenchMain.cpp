@@ -0,0 +1,163 @@
+// gltf-tangent-bench: times MikkTSpace against the fast tangent generator on every primitive of a glTF file that has
+// normals and texture coordinates, and reports how far apart their tangents end up.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <glad/glad.h>
+#include "GLTFAsset.h"
+#include "GLTFHelpers.h"
+#include <iostream>
+#include "Mesh.h"
+#include <string>
+#include <vector>
+
+struct BenchPrimitive
+{
+	std::vector<std::uint8_t> vertexBuffer;
+	std::vector<std::uint32_t> indexBuffer;
+	bool indexed;
+};
+
+// Same float layout BuildSubmeshData uses when it generates tangents for an unquantized primitive
+static VertexLayout GetBenchLayout()
+{
+	VertexLayout layout;
+	layout[VertexAttribute::POSITION] = { .componentType = GL_FLOAT, .componentCount = 3 };
+	layout[VertexAttribute::TEXCOORD] = { .componentType = GL_FLOAT, .componentCount = 2 };
+	layout[VertexAttribute::NORMAL] = { .componentType = GL_FLOAT, .componentCount = 3 };
+	layout[VertexAttribute::TANGENT] = { .componentType = GL_FLOAT, .componentCount = 4 };
+	ComputeOffsets(layout);
+	return layout;
+}
+
+static bool ReadBenchPrimitive(const tinygltf::Primitive& primitive, const GLTFAsset& asset, const VertexLayout& layout, BenchPrimitive& bench)
+{
+	const auto position = primitive.attributes.find("POSITION");
+	const auto normal = primitive.attributes.find("NORMAL");
+	const auto texCoord = primitive.attributes.find("TEXCOORD_0");
+	if (primitive.mode != TINYGLTF_MODE_TRIANGLES || position == primitive.attributes.end() || normal == primitive.attributes.end() ||
+		texCoord == primitive.attributes.end())
+	{
+		return false;
+	}
+
+	const std::pair<VertexAttribute, int> sources[] = {
+		{ VertexAttribute::POSITION, position->second }, { VertexAttribute::NORMAL, normal->second }, { VertexAttribute::TEXCOORD, texCoord->second } };
+	const int vertexCount = (int)asset.model.accessors[position->second].count;
+	bench.vertexBuffer.assign((std::size_t)vertexCount * layout.stride, 0);
+	for (const auto& [attribute, accessorIdx] : sources)
+	{
+		const tinygltf::Accessor& accessor = asset.model.accessors[accessorIdx];
+		const VertexAttributeFormat format{ .componentType = (std::uint32_t)accessor.componentType,
+			.componentCount = (std::uint8_t)tinygltf::GetNumComponentsInType(accessor.type),
+			.normalized = (std::uint8_t)(accessor.normalized && accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) };
+		const AccessorView view(accessor, asset);
+		for (int i = 0; i < std::min(view.count, vertexCount); i++)
+		{
+			WriteAttribute(bench.vertexBuffer.data() + (std::size_t)i * layout.stride, layout[attribute], ReadAttribute(view[i], format));
+		}
+	}
+
+	bench.indexed = primitive.indices >= 0;
+	if (bench.indexed)
+	{
+		const tinygltf::Accessor& accessor = asset.model.accessors[primitive.indices];
+		const AccessorView view(accessor, asset);
+		bench.indexBuffer.resize(view.count);
+		for (int i = 0; i < view.count; i++)
+		{
+			std::uint32_t index = 0;
+			std::memcpy(&index, view[i], view.elementSize); // little endian, so narrower indices land in the low bytes
+			bench.indexBuffer[i] = index;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: gltf-tangent-bench <model.gltf|.glb> [iterations]\n";
+		return 1;
+	}
+	const int iterations = argc > 2 ? std::max(1, std::stoi(argv[2])) : 5;
+
+	GLTFAsset asset;
+	std::string err, warn;
+	if (!LoadGLTFAsset(argv[1], asset, &err, &warn))
+	{
+		std::cout << "Failed to load " << argv[1] << ": " << err << '\n';
+		return 1;
+	}
+
+	const VertexLayout layout = GetBenchLayout();
+	std::vector<BenchPrimitive> primitives;
+	std::size_t vertexCount = 0;
+	for (const tinygltf::Mesh& mesh : asset.model.meshes)
+	{
+		for (const tinygltf::Primitive& primitive : mesh.primitives)
+		{
+			BenchPrimitive bench;
+			if (ReadBenchPrimitive(primitive, asset, layout, bench))
+			{
+				vertexCount += bench.vertexBuffer.size() / layout.stride;
+				primitives.push_back(std::move(bench));
+			}
+		}
+	}
+	if (primitives.empty())
+	{
+		std::cout << "No triangle primitives with normals and texture coordinates\n";
+		return 1;
+	}
+
+	// Fastest of several runs, each generating every primitive's tangents. No tangent cache, so MikkTSpace always runs.
+	std::vector<std::vector<std::uint8_t>> results[2];
+	float bestSeconds[2];
+	for (int generatorIdx = 0; generatorIdx < 2; generatorIdx++)
+	{
+		const TangentGenerator generator = generatorIdx == 0 ? TangentGenerator::MikkTSpace : TangentGenerator::Fast;
+		bestSeconds[generatorIdx] = INFINITY;
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			std::vector<std::vector<std::uint8_t>> vertexBuffers;
+			for (const BenchPrimitive& bench : primitives) vertexBuffers.push_back(bench.vertexBuffer);
+
+			const auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < primitives.size(); i++)
+			{
+				GenerateTangents(vertexBuffers[i], primitives[i].indexed ? &primitives[i].indexBuffer : nullptr, layout, generator);
+			}
+			const std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+			bestSeconds[generatorIdx] = std::min(bestSeconds[generatorIdx], elapsed.count());
+			results[generatorIdx] = std::move(vertexBuffers);
+		}
+	}
+
+	// Angle between the two tangents of each vertex, and how many vertices disagree on handedness
+	double angleSum = 0.0;
+	float maxAngle = 0.0f;
+	std::size_t flippedCount = 0;
+	for (int i = 0; i < primitives.size(); i++)
+	{
+		for (std::size_t offset = 0; offset < results[0][i].size(); offset += layout.stride)
+		{
+			const glm::vec4 mikkt = ReadAttribute(results[0][i].data() + offset, layout[VertexAttribute::TANGENT]);
+			const glm::vec4 fast = ReadAttribute(results[1][i].data() + offset, layout[VertexAttribute::TANGENT]);
+			const float angle = std::acos(std::clamp(mikkt.x * fast.x + mikkt.y * fast.y + mikkt.z * fast.z, -1.0f, 1.0f));
+			angleSum += angle;
+			maxAngle = std::max(maxAngle, angle);
+			if (mikkt.w != fast.w) flippedCount++;
+		}
+	}
+
+	const float degrees = 180.0f / 3.14159265f;
+	std::cout << primitives.size() << " primitives, " << vertexCount << " vertices, best of " << iterations << '\n';
+	std::cout << "MikkTSpace: " << bestSeconds[0] * 1000.0f << "ms\n";
+	std::cout << "Fast:       " << bestSeconds[1] * 1000.0f << "ms (" << bestSeconds[0] / bestSeconds[1] << "x)\n";
+	std::cout << "Tangent angle difference: mean " << angleSum / vertexCount * degrees << " deg, max " << maxAngle * degrees << " deg, "
+		<< flippedCount << " vertices with flipped handedness\n";
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "TangentCache.h"
+
+#include <cstring>
+#include "MappedFile.h"
+#include <type_traits>
+#include <utility>
+
+static constexpr std::uint32_t cacheMagic = 'G' | 'V' << 8 | 'T' << 16 | 'C' << 24; // "GVTC" at the start of the file
+static constexpr std::uint32_t cacheVersion = 1;
+
+struct CacheHeader
+{
+	std::uint32_t magic = cacheMagic;
+	std::uint32_t version = cacheVersion;
+	std::uint64_t entryCount;
+};
+
+// Each entry is followed by vertexCount xyzw tangents
+struct CacheEntry
+{
+	std::uint64_t key;
+	std::uint64_t vertexCount;
+};
+static_assert(std::is_trivially_copyable_v<CacheHeader> && std::is_trivially_copyable_v<CacheEntry>);
+
+TangentCache::TangentCache(std::string path)
+	:path(std::move(path))
+{
+	const MappedFile file(this->path);
+	if (!file.IsOpen() || file.Size() < sizeof(CacheHeader))
+	{
+		return;
+	}
+
+	CacheHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if (header.magic != cacheMagic || header.version != cacheVersion)
+	{
+		return;
+	}
+
+	std::size_t offset = sizeof(CacheHeader);
+	for (std::uint64_t i = 0; i < header.entryCount; i++)
+	{
+		CacheEntry cached;
+		if (file.Size() - offset < sizeof(cached))
+		{
+			break;
+		}
+		std::memcpy(&cached, file.Data() + offset, sizeof(cached));
+		offset += sizeof(cached);
+
+		if (cached.vertexCount > (file.Size() - offset) / sizeof(glm::vec4))
+		{
+			break;
+		}
+		Entry& entry = entries[cached.key];
+		entry.tangents.resize(cached.vertexCount);
+		std::memcpy(entry.tangents.data(), file.Data() + offset, cached.vertexCount * sizeof(glm::vec4));
+		offset += cached.vertexCount * sizeof(glm::vec4);
+	}
+}
+
+bool TangentCache::Find(std::uint64_t key, std::size_t vertexCount, std::vector<glm::vec4>& tangents)
+{
+	std::lock_guard lock(mutex);
+	auto it = entries.find(key);
+	if (it == entries.end() || it->second.tangents.size() != vertexCount)
+	{
+		return false;
+	}
+	it->second.used = true;
+	tangents = it->second.tangents;
+	return true;
+}
+
+void TangentCache::Insert(std::uint64_t key, std::vector<glm::vec4> tangents)
+{
+	std::lock_guard lock(mutex);
+	entries[key] = Entry{ std::move(tangents), true };
+	dirty = true;
+}
+
+bool TangentCache::Save()
+{
+	std::lock_guard lock(mutex);
+	if (!dirty)
+	{
+		return true;
+	}
+
+	CacheHeader header;
+	header.entryCount = 0;
+	std::size_t size = sizeof(header);
+	for (const auto& [key, entry] : entries)
+	{
+		if (!entry.used) continue;
+		header.entryCount++;
+		size += sizeof(CacheEntry) + entry.tangents.size() * sizeof(glm::vec4);
+	}
+
+	std::vector<std::uint8_t> bytes(size);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::size_t offset = sizeof(header);
+	for (const auto& [key, entry] : entries)
+	{
+		if (!entry.used) continue;
+		const CacheEntry cached{ key, entry.tangents.size() };
+		std::memcpy(bytes.data() + offset, &cached, sizeof(cached));
+		offset += sizeof(cached);
+		if (!entry.tangents.empty())
+		{
+			std::memcpy(bytes.data() + offset, entry.tangents.data(), entry.tangents.size() * sizeof(glm::vec4));
+		}
+		offset += entry.tangents.size() * sizeof(glm::vec4);
+	}
+
+	if (!WriteFileAtomically(path, bytes))
+	{
+		return false;
+	}
+	dirty = false;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/vec4.hpp>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// .gvtangents files keep the MikkTSpace tangents generated for an asset's primitives, keyed by a hash of the positions,
+// normals, texture coordinates and indices they were generated from. Unlike the .gvcache they don't depend on the
+// mesh build options or on anything else in the asset, so rebuilding geometry never has to run MikkTSpace again for a
+// primitive whose inputs didn't change. Find and Insert can be called from several threads at once.
+class TangentCache
+{
+public:
+	// Starts empty if path doesn't exist or isn't a valid tangent cache
+	explicit TangentCache(std::string path);
+
+	// Copies the tangents stored under key into tangents if there are vertexCount of them
+	bool Find(std::uint64_t key, std::size_t vertexCount, std::vector<glm::vec4>& tangents);
+	void Insert(std::uint64_t key, std::vector<glm::vec4> tangents);
+
+	// Writes back only the entries that were found or inserted since loading, so tangents of primitives that no longer
+	// exist get dropped. Does nothing if nothing was inserted.
+	bool Save();
+private:
+	struct Entry
+	{
+		std::vector<glm::vec4> tangents;
+		bool used = false;
+	};
+
+	std::string path;
+	std::mutex mutex;
+	std::unordered_map<std::uint64_t, Entry> entries;
+	bool dirty = false;
+};
\ No newline at end of file
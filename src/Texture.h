@@ -1,12 +1,16 @@
 #pragma once
 
+#include <cstddef>
 #include <glad/glad.h>
+#include "GLHandle.h"
 
 struct Texture
 {
-	GLuint id;
+	GLTexture id;
+	std::size_t gpuBytes = 0; // every mip level
 
-	// Used as default textures in order to treat materials consistently, whether they have actual textures or not
+	// Used as default textures in order to treat materials consistently, whether they have actual textures or not.
+	// Each call creates a new texture owned by the caller.
 	static Texture White1x1TextureRGBA();
 	static Texture Max1x1TextureRed();
 	static Texture DepthCubemap1x1();
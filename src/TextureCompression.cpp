@@ -0,0 +1,720 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include "Hash.h"
+#include <iostream>
+#include "ThreadPool.h"
+
+static constexpr std::uint32_t textureCacheMagic = 'B' | 'T' << 8 | 'E' << 16 | 'X' << 24; // "BTEX" at the start of the file
+static constexpr std::uint32_t textureCacheVersion = 1;
+
+struct TextureCacheHeader
+{
+	std::uint32_t magic = textureCacheMagic;
+	std::uint32_t version = textureCacheVersion;
+	std::uint32_t format;
+	std::uint32_t width;
+	std::uint32_t height;
+	std::uint32_t mipCount;
+};
+
+GLenum GetGLInternalFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case BlockFormat::BC7_SRGB: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+	case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+	case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+	default:
+		assert(false && "Not a block compressed format");
+		return GL_NONE;
+	}
+}
+
+static int GetBlockSizeBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC4 ? 8 : 16;
+}
+
+std::size_t GetCompressedMipSize(BlockFormat format, int width, int height)
+{
+	return (std::size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockSizeBytes(format);
+}
+
+static int GetMipCount(int width, int height)
+{
+	return 1 + (int)std::log2(std::max(width, height));
+}
+
+static const std::array<float, 256>& SRGBToLinearTable()
+{
+	static const std::array<float, 256> table = []()
+	{
+		std::array<float, 256> values;
+		for (int i = 0; i < 256; i++)
+		{
+			const float c = i / 255.0f;
+			values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		return values;
+	}();
+	return table;
+}
+
+static std::uint8_t LinearToSRGB(float c)
+{
+	c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	return (std::uint8_t)std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f);
+}
+
+// 2x2 box filter. Color is averaged in linear space and normals are renormalized, anything else is averaged as is.
+static std::vector<std::uint8_t> Downsample(const std::vector<std::uint8_t>& pixels, int width, int height, BlockFormat format)
+{
+	const int mipWidth = std::max(width / 2, 1);
+	const int mipHeight = std::max(height / 2, 1);
+	std::vector<std::uint8_t> mip((std::size_t)mipWidth * mipHeight * 4);
+	const auto& toLinear = SRGBToLinearTable();
+
+	for (int y = 0; y < mipHeight; y++)
+	{
+		for (int x = 0; x < mipWidth; x++)
+		{
+			const int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+			const int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			const std::uint8_t* texels[4] = {
+				&pixels[((std::size_t)y0 * width + x0) * 4], &pixels[((std::size_t)y0 * width + x1) * 4],
+				&pixels[((std::size_t)y1 * width + x0) * 4], &pixels[((std::size_t)y1 * width + x1) * 4]
+			};
+			std::uint8_t* out = &mip[((std::size_t)y * mipWidth + x) * 4];
+
+			float sum[4] = {};
+			for (const std::uint8_t* texel : texels)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					if (format == BlockFormat::BC7_SRGB && c < 3) sum[c] += toLinear[texel[c]];
+					else if (format == BlockFormat::BC5 && c < 3) sum[c] += texel[c] / 255.0f * 2.0f - 1.0f;
+					else sum[c] += texel[c];
+				}
+			}
+
+			if (format == BlockFormat::BC7_SRGB)
+			{
+				for (int c = 0; c < 3; c++) out[c] = LinearToSRGB(sum[c] / 4.0f);
+			}
+			else if (format == BlockFormat::BC5)
+			{
+				const float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+				for (int c = 0; c < 3; c++)
+				{
+					const float n = length > 0.0f ? sum[c] / length : (c == 2 ? 1.0f : 0.0f);
+					out[c] = (std::uint8_t)std::clamp((n * 0.5f + 0.5f) * 255.0f + 0.5f, 0.0f, 255.0f);
+				}
+			}
+			else
+			{
+				for (int c = 0; c < 3; c++) out[c] = (std::uint8_t)((sum[c] + 2.0f) / 4.0f);
+			}
+			out[3] = (std::uint8_t)((sum[3] + 2.0f) / 4.0f);
+		}
+	}
+	return mip;
+}
+
+void CompressBC4Block(const std::uint8_t values[16], std::uint8_t* block)
+{
+	const auto [minIter, maxIter] = std::minmax_element(values, values + 16);
+	const int minValue = *minIter;
+	const int maxValue = *maxIter;
+
+	// endpoint0 > endpoint1 selects the 8 value palette
+	block[0] = (std::uint8_t)maxValue;
+	block[1] = (std::uint8_t)minValue;
+	std::uint64_t indices = 0;
+	if (maxValue > minValue)
+	{
+		int palette[8] = { maxValue, minValue };
+		for (int i = 2; i < 8; i++)
+		{
+			palette[i] = ((8 - i) * maxValue + (i - 1) * minValue + 3) / 7;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestError = 256;
+			for (int j = 0; j < 8; j++)
+			{
+				const int error = std::abs(palette[j] - values[i]);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = j;
+				}
+			}
+			indices |= (std::uint64_t)bestIndex << (3 * i);
+		}
+	}
+
+	for (int i = 0; i < 6; i++)
+	{
+		block[2 + i] = (std::uint8_t)(indices >> (8 * i));
+	}
+}
+
+static constexpr int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Mode 6 endpoints are 7 bits per channel plus a p-bit shared by the endpoint's channels
+struct BC7Endpoint
+{
+	int quantized[4];
+	int pBit;
+	int Value(int channel) const { return (quantized[channel] << 1) | pBit; }
+};
+
+static BC7Endpoint QuantizeBC7Endpoint(const float color[4])
+{
+	BC7Endpoint best;
+	float bestError = FLT_MAX;
+	for (int pBit = 0; pBit < 2; pBit++)
+	{
+		BC7Endpoint endpoint;
+		endpoint.pBit = pBit;
+		float error = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			endpoint.quantized[c] = std::clamp((int)std::lround((color[c] - pBit) / 2.0f), 0, 127);
+			const float difference = endpoint.Value(c) - color[c];
+			error += difference * difference;
+		}
+		if (error < bestError)
+		{
+			bestError = error;
+			best = endpoint;
+		}
+	}
+	return best;
+}
+
+// Picks the closest palette entry for every texel, returns the total squared error
+static int FindBC7Indices(const std::uint8_t texels[64], const BC7Endpoint& e0, const BC7Endpoint& e1, int indices[16])
+{
+	int palette[16][4];
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			palette[i][c] = ((64 - bc7Weights4[i]) * e0.Value(c) + bc7Weights4[i] * e1.Value(c) + 32) >> 6;
+		}
+	}
+
+	int totalError = 0;
+	for (int t = 0; t < 16; t++)
+	{
+		int bestError = INT_MAX;
+		for (int i = 0; i < 16; i++)
+		{
+			int error = 0;
+			for (int c = 0; c < 4; c++)
+			{
+				const int difference = palette[i][c] - texels[t * 4 + c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[t] = i;
+			}
+		}
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+void CompressBC7Block(const std::uint8_t texels[64], std::uint8_t* block)
+{
+	// Endpoints start at the extremes of the texels along their principal axis
+	float mean[4] = {};
+	for (int t = 0; t < 16; t++)
+	{
+		for (int c = 0; c < 4; c++) mean[c] += texels[t * 4 + c] / 16.0f;
+	}
+
+	float covariance[4][4] = {};
+	for (int t = 0; t < 16; t++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				covariance[i][j] += (texels[t * 4 + i] - mean[i]) * (texels[t * 4 + j] - mean[j]);
+			}
+		}
+	}
+
+	float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = {};
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++) next[i] += covariance[i][j] * axis[j];
+		}
+		const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+		if (length < 1e-6f)
+		{
+			break;
+		}
+		for (int i = 0; i < 4; i++) axis[i] = next[i] / length;
+	}
+
+	float minProjection = FLT_MAX, maxProjection = -FLT_MAX;
+	for (int t = 0; t < 16; t++)
+	{
+		float projection = 0.0f;
+		for (int c = 0; c < 4; c++) projection += (texels[t * 4 + c] - mean[c]) * axis[c];
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	float color0[4], color1[4];
+	for (int c = 0; c < 4; c++)
+	{
+		color0[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+		color1[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+	}
+
+	BC7Endpoint e0 = QuantizeBC7Endpoint(color0);
+	BC7Endpoint e1 = QuantizeBC7Endpoint(color1);
+	int indices[16];
+	int error = FindBC7Indices(texels, e0, e1, indices);
+
+	// Least squares refit of the endpoints to the chosen indices
+	for (int iteration = 0; iteration < 2 && error > 0; iteration++)
+	{
+		float a00 = 0.0f, a01 = 0.0f, a11 = 0.0f;
+		float b0[4] = {}, b1[4] = {};
+		for (int t = 0; t < 16; t++)
+		{
+			const float w = bc7Weights4[indices[t]] / 64.0f;
+			a00 += (1.0f - w) * (1.0f - w);
+			a01 += (1.0f - w) * w;
+			a11 += w * w;
+			for (int c = 0; c < 4; c++)
+			{
+				b0[c] += (1.0f - w) * texels[t * 4 + c];
+				b1[c] += w * texels[t * 4 + c];
+			}
+		}
+		const float determinant = a00 * a11 - a01 * a01;
+		if (std::abs(determinant) < 1e-6f)
+		{
+			break;
+		}
+
+		for (int c = 0; c < 4; c++)
+		{
+			color0[c] = std::clamp((a11 * b0[c] - a01 * b1[c]) / determinant, 0.0f, 255.0f);
+			color1[c] = std::clamp((a00 * b1[c] - a01 * b0[c]) / determinant, 0.0f, 255.0f);
+		}
+		const BC7Endpoint refit0 = QuantizeBC7Endpoint(color0);
+		const BC7Endpoint refit1 = QuantizeBC7Endpoint(color1);
+		int refitIndices[16];
+		const int refitError = FindBC7Indices(texels, refit0, refit1, refitIndices);
+		if (refitError >= error)
+		{
+			break;
+		}
+		e0 = refit0;
+		e1 = refit1;
+		error = refitError;
+		std::copy(refitIndices, refitIndices + 16, indices);
+	}
+
+	// The anchor (first) index is stored without its top bit, so it has to be < 8
+	if (indices[0] >= 8)
+	{
+		std::swap(e0, e1);
+		for (int& index : indices) index = 15 - index;
+	}
+
+	std::memset(block, 0, 16);
+	int bit = 0;
+	auto writeBits = [&](std::uint32_t value, int count)
+	{
+		for (int i = 0; i < count; i++, bit++)
+		{
+			if ((value >> i) & 1) block[bit >> 3] |= 1 << (bit & 7);
+		}
+	};
+
+	writeBits(1 << 6, 7); // mode 6
+	for (int c = 0; c < 4; c++)
+	{
+		writeBits(e0.quantized[c], 7);
+		writeBits(e1.quantized[c], 7);
+	}
+	writeBits(e0.pBit, 1);
+	writeBits(e1.pBit, 1);
+	writeBits(indices[0], 3);
+	for (int t = 1; t < 16; t++)
+	{
+		writeBits(indices[t], 4);
+	}
+}
+
+// Unsigned half float bits, saturating at the largest finite half
+static int FloatToHalfBits(float value)
+{
+	if (!(value > 0.0f)) return 0; // also catches NaN
+	if (value >= 65504.0f) return 0x7BFF;
+	if (value < 6.103515625e-5f) return (int)std::lround(value * 16777216.0f); // denormal, steps of 2^-24
+
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	bits += 0x0FFF + ((bits >> 13) & 1); // round to nearest even
+	return std::min((int)(((bits >> 23) - 112) << 10 | ((bits >> 13) & 0x3FF)), 0x7BFF);
+}
+
+// Mode 11 endpoints are 10 bits, expanded to 16 before interpolating
+static int UnquantizeBC6HEndpoint(int value)
+{
+	if (value == 0) return 0;
+	if (value == 1023) return 0xFFFF;
+	return ((value << 16) + 0x8000) >> 10;
+}
+
+static int QuantizeBC6HEndpoint(float unquantized)
+{
+	return std::clamp((int)std::lround((unquantized - 32.0f) / 64.0f), 0, 1023);
+}
+
+// texels are half float bits, error is measured on those, which is roughly relative error
+static float FindBC6HIndices(const float texels[48], const int e0[3], const int e1[3], int indices[16])
+{
+	float palette[16][3];
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			const int interpolated = ((64 - bc7Weights4[i]) * UnquantizeBC6HEndpoint(e0[c]) + bc7Weights4[i] * UnquantizeBC6HEndpoint(e1[c]) + 32) >> 6;
+			palette[i][c] = (float)((interpolated * 31) >> 6);
+		}
+	}
+
+	float totalError = 0.0f;
+	for (int t = 0; t < 16; t++)
+	{
+		float bestError = FLT_MAX;
+		for (int i = 0; i < 16; i++)
+		{
+			float error = 0.0f;
+			for (int c = 0; c < 3; c++)
+			{
+				const float difference = palette[i][c] - texels[t * 3 + c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[t] = i;
+			}
+		}
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+void CompressBC6HBlock(const float texels[48], std::uint8_t* block)
+{
+	// Endpoints are fit in the space the decoder interpolates in, half bits scaled by 64/31
+	float halfBits[48], unquantized[48];
+	for (int i = 0; i < 48; i++)
+	{
+		halfBits[i] = (float)FloatToHalfBits(texels[i]);
+		unquantized[i] = halfBits[i] * (64.0f / 31.0f);
+	}
+
+	float mean[3] = {};
+	for (int t = 0; t < 16; t++)
+	{
+		for (int c = 0; c < 3; c++) mean[c] += unquantized[t * 3 + c] / 16.0f;
+	}
+
+	float covariance[3][3] = {};
+	for (int t = 0; t < 16; t++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				covariance[i][j] += (unquantized[t * 3 + i] - mean[i]) * (unquantized[t * 3 + j] - mean[j]);
+			}
+		}
+	}
+
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[3] = {};
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++) next[i] += covariance[i][j] * axis[j];
+		}
+		const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if (length < 1e-6f)
+		{
+			break;
+		}
+		for (int i = 0; i < 3; i++) axis[i] = next[i] / length;
+	}
+
+	float minProjection = FLT_MAX, maxProjection = -FLT_MAX;
+	for (int t = 0; t < 16; t++)
+	{
+		float projection = 0.0f;
+		for (int c = 0; c < 3; c++) projection += (unquantized[t * 3 + c] - mean[c]) * axis[c];
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	int e0[3], e1[3];
+	for (int c = 0; c < 3; c++)
+	{
+		e0[c] = QuantizeBC6HEndpoint(mean[c] + axis[c] * minProjection);
+		e1[c] = QuantizeBC6HEndpoint(mean[c] + axis[c] * maxProjection);
+	}
+	int indices[16];
+	float error = FindBC6HIndices(halfBits, e0, e1, indices);
+
+	// Least squares refit of the endpoints to the chosen indices
+	for (int iteration = 0; iteration < 2 && error > 0.0f; iteration++)
+	{
+		float a00 = 0.0f, a01 = 0.0f, a11 = 0.0f;
+		float b0[3] = {}, b1[3] = {};
+		for (int t = 0; t < 16; t++)
+		{
+			const float w = bc7Weights4[indices[t]] / 64.0f;
+			a00 += (1.0f - w) * (1.0f - w);
+			a01 += (1.0f - w) * w;
+			a11 += w * w;
+			for (int c = 0; c < 3; c++)
+			{
+				b0[c] += (1.0f - w) * unquantized[t * 3 + c];
+				b1[c] += w * unquantized[t * 3 + c];
+			}
+		}
+		const float determinant = a00 * a11 - a01 * a01;
+		if (std::abs(determinant) < 1e-6f)
+		{
+			break;
+		}
+
+		int refit0[3], refit1[3];
+		for (int c = 0; c < 3; c++)
+		{
+			refit0[c] = QuantizeBC6HEndpoint((a11 * b0[c] - a01 * b1[c]) / determinant);
+			refit1[c] = QuantizeBC6HEndpoint((a00 * b1[c] - a01 * b0[c]) / determinant);
+		}
+		int refitIndices[16];
+		const float refitError = FindBC6HIndices(halfBits, refit0, refit1, refitIndices);
+		if (refitError >= error)
+		{
+			break;
+		}
+		std::copy(refit0, refit0 + 3, e0);
+		std::copy(refit1, refit1 + 3, e1);
+		error = refitError;
+		std::copy(refitIndices, refitIndices + 16, indices);
+	}
+
+	// Same anchor rule as BC7, the weights are symmetric so swapping is lossless
+	if (indices[0] >= 8)
+	{
+		std::swap(e0, e1);
+		for (int& index : indices) index = 15 - index;
+	}
+
+	std::memset(block, 0, 16);
+	int bit = 0;
+	auto writeBits = [&](std::uint32_t value, int count)
+	{
+		for (int i = 0; i < count; i++, bit++)
+		{
+			if ((value >> i) & 1) block[bit >> 3] |= 1 << (bit & 7);
+		}
+	};
+
+	writeBits(0x03, 5); // mode 11
+	for (int c = 0; c < 3; c++) writeBits(e0[c], 10);
+	for (int c = 0; c < 3; c++) writeBits(e1[c], 10);
+	writeBits(indices[0], 3);
+	for (int t = 1; t < 16; t++)
+	{
+		writeBits(indices[t], 4);
+	}
+}
+
+// Compresses one mip, a row of blocks per task
+static void CompressMip(const std::vector<std::uint8_t>& pixels, int width, int height, BlockFormat format, std::uint8_t* out)
+{
+	const int blocksX = (width + 3) / 4;
+	const int blocksY = (height + 3) / 4;
+	const int blockSize = GetBlockSizeBytes(format);
+
+	ThreadPool::Get().ParallelFor(blocksY, [&](int blockY)
+	{
+		for (int blockX = 0; blockX < blocksX; blockX++)
+		{
+			// Edge blocks of non multiple of 4 sizes repeat the last row/column
+			std::uint8_t texels[64];
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					const int sourceX = std::min(blockX * 4 + x, width - 1);
+					const int sourceY = std::min(blockY * 4 + y, height - 1);
+					std::memcpy(&texels[(y * 4 + x) * 4], &pixels[((std::size_t)sourceY * width + sourceX) * 4], 4);
+				}
+			}
+
+			std::uint8_t* block = out + ((std::size_t)blockY * blocksX + blockX) * blockSize;
+			if (format == BlockFormat::BC4 || format == BlockFormat::BC5)
+			{
+				std::uint8_t channel[16];
+				for (int i = 0; i < 16; i++) channel[i] = texels[i * 4];
+				CompressBC4Block(channel, block);
+				if (format == BlockFormat::BC5)
+				{
+					for (int i = 0; i < 16; i++) channel[i] = texels[i * 4 + 1];
+					CompressBC4Block(channel, block + 8);
+				}
+			}
+			else
+			{
+				CompressBC7Block(texels, block);
+			}
+		}
+	});
+}
+
+static void SetMipSpans(CompressedTexture& texture, const std::uint8_t* data, int mipCount)
+{
+	texture.mips.clear();
+	int width = texture.width;
+	int height = texture.height;
+	for (int i = 0; i < mipCount; i++)
+	{
+		const std::size_t size = GetCompressedMipSize(texture.format, width, height);
+		texture.mips.emplace_back(data, size);
+		data += size;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+}
+
+static std::size_t GetCompressedChainSize(BlockFormat format, int width, int height)
+{
+	std::size_t size = 0;
+	for (int i = 0; i < GetMipCount(width, height); i++)
+	{
+		size += GetCompressedMipSize(format, std::max(width >> i, 1), std::max(height >> i, 1));
+	}
+	return size;
+}
+
+static bool ReadTextureCache(const std::string& path, CompressedTexture& texture)
+{
+	texture.file = MappedFile(path);
+	if (!texture.file.IsOpen() || texture.file.Size() < sizeof(TextureCacheHeader))
+	{
+		texture.file = MappedFile();
+		return false;
+	}
+
+	TextureCacheHeader header;
+	std::memcpy(&header, texture.file.Data(), sizeof(header));
+	if (header.magic != textureCacheMagic || header.version != textureCacheVersion || header.format != (std::uint32_t)texture.format ||
+		header.width != texture.width || header.height != texture.height || header.mipCount != GetMipCount(texture.width, texture.height) ||
+		texture.file.Size() != sizeof(header) + GetCompressedChainSize(texture.format, texture.width, texture.height))
+	{
+		texture.file = MappedFile();
+		return false;
+	}
+
+	SetMipSpans(texture, texture.file.Data() + sizeof(header), header.mipCount);
+	return true;
+}
+
+static bool WriteTextureCache(const std::string& path, const CompressedTexture& texture)
+{
+	TextureCacheHeader header;
+	header.format = (std::uint32_t)texture.format;
+	header.width = texture.width;
+	header.height = texture.height;
+	header.mipCount = (std::uint32_t)texture.mips.size();
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+	std::vector<std::uint8_t> bytes(sizeof(header) + texture.ownedData.size());
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::memcpy(bytes.data() + sizeof(header), texture.ownedData.data(), texture.ownedData.size());
+	return WriteFileAtomically(path, bytes);
+}
+
+bool CompressTexture(const tinygltf::Image& image, BlockFormat format, const std::string& cacheDir, CompressedTexture& texture)
+{
+	assert(format != BlockFormat::None);
+	if (image.component != 4 || image.bits != 8 || image.width <= 0 || image.height <= 0)
+	{
+		return false;
+	}
+
+	texture.format = format;
+	texture.width = image.width;
+	texture.height = image.height;
+
+	char hashHex[17];
+	std::snprintf(hashHex, sizeof(hashHex), "%016llx", (unsigned long long)HashBytes(image.image));
+	const std::string cachePath = (std::filesystem::path(cacheDir) / (std::string(hashHex) + "-" + std::to_string((int)format) + ".btex")).string();
+	if (ReadTextureCache(cachePath, texture))
+	{
+		return true;
+	}
+
+	const int mipCount = GetMipCount(image.width, image.height);
+	texture.ownedData.resize(GetCompressedChainSize(format, image.width, image.height));
+
+	std::vector<std::uint8_t> mipPixels = image.image;
+	int width = image.width;
+	int height = image.height;
+	std::size_t offset = 0;
+	for (int i = 0; i < mipCount; i++)
+	{
+		CompressMip(mipPixels, width, height, format, texture.ownedData.data() + offset);
+		offset += GetCompressedMipSize(format, width, height);
+		if (i + 1 < mipCount)
+		{
+			mipPixels = Downsample(mipPixels, width, height, format);
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+	}
+	SetMipSpans(texture, texture.ownedData.data(), mipCount);
+
+	if (!WriteTextureCache(cachePath, texture))
+	{
+		std::cout << "Failed to write texture cache " << cachePath << '\n';
+	}
+	return true;
+}
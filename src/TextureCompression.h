@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include "MappedFile.h"
+#include <span>
+#include <string>
+#include <tiny_gltf/tiny_gltf.h>
+#include <vector>
+
+enum class BlockFormat : std::uint32_t
+{
+	None,     // left uncompressed
+	BC7,      // linear RGBA (metallic/roughness)
+	BC7_SRGB, // color (base color, emissive)
+	BC5,      // two channel normal maps, z is reconstructed in the shader
+	BC4,      // single channel (occlusion)
+};
+
+// Block compressed texture with its full mip chain, either read from the texture cache or just compressed
+struct CompressedTexture
+{
+	BlockFormat format = BlockFormat::None;
+	int width = 0;
+	int height = 0;
+	std::vector<std::span<const std::uint8_t>> mips; // point into file or ownedData
+	MappedFile file;
+	std::vector<std::uint8_t> ownedData;
+};
+
+GLenum GetGLInternalFormat(BlockFormat format);
+std::size_t GetCompressedMipSize(BlockFormat format, int width, int height);
+
+// Generates mips for 8 bit RGBA pixels and block compresses them on the thread pool. Results are cached in cacheDir, keyed
+// by a hash of the pixels, so each image is only ever compressed once.
+bool CompressTexture(const tinygltf::Image& image, BlockFormat format, const std::string& cacheDir, CompressedTexture& texture);
+
+// 16 RGBA texels in, one 16 byte BC7 (mode 6) block out
+void CompressBC7Block(const std::uint8_t texels[64], std::uint8_t* block);
+// 16 linear RGB texels in, one 16 byte unsigned BC6H (mode 11) block out
+void CompressBC6HBlock(const float texels[48], std::uint8_t* block);
+// 16 single channel values in, one 8 byte BC4 block out
+void CompressBC4Block(const std::uint8_t values[16], std::uint8_t* block);
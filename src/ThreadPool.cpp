@@ -0,0 +1,103 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+	numThreads = std::max(numThreads, 1u);
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	tasksAvailable.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool pool(std::thread::hardware_concurrency());
+	return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	tasksAvailable.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock lock(mutex);
+			tasksAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+			{
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& task)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	struct State
+	{
+		std::atomic<int> next = 0;
+		std::atomic<int> finished = 0;
+		std::mutex mutex;
+		std::condition_variable allFinished;
+	};
+	auto state = std::make_shared<State>();
+
+	// Helpers that only get to run after every index was claimed return without touching task, which may be gone by then
+	auto work = [state, &task, count]()
+	{
+		int processed = 0;
+		for (int i = state->next++; i < count; i = state->next++)
+		{
+			task(i);
+			processed++;
+		}
+		if (processed > 0 && state->finished.fetch_add(processed) + processed == count)
+		{
+			std::lock_guard lock(state->mutex);
+			state->allFinished.notify_all();
+		}
+	};
+
+	const int numHelpers = std::min(count - 1, NumThreads());
+	for (int i = 0; i < numHelpers; i++)
+	{
+		Enqueue(work);
+	}
+	work();
+
+	std::unique_lock lock(state->mutex);
+	state->allFinished.wait(lock, [&]() { return state->finished == count; });
+}
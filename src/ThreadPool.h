@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed size pool of worker threads for CPU side loading work (mesh building, image decoding, ...). GL calls must never be
+// made from a task: workers produce plain data that the context thread uploads afterwards.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned int numThreads);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Shared pool sized to the number of hardware threads
+	static ThreadPool& Get();
+
+	template<typename F>
+	auto Submit(F&& task) -> std::future<std::invoke_result_t<F>>
+	{
+		using Result = std::invoke_result_t<F>;
+		auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> future = packagedTask->get_future();
+		Enqueue([packagedTask]() { (*packagedTask)(); });
+		return future;
+	}
+
+	// Calls task(i) for every i in [0, count) and returns once all of them have finished. The calling thread takes part,
+	// so this is safe to call from inside another task even when every worker is busy.
+	void ParallelFor(int count, const std::function<void(int)>& task);
+
+	int NumThreads() const { return (int)workers.size(); }
+private:
+	void Enqueue(std::function<void()> task);
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable tasksAvailable;
+	bool stopping = false;
+};
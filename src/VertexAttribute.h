@@ -11,14 +11,14 @@ enum class VertexAttribute : std::uint32_t
     NORMAL = 1 << 2,
     WEIGHTS = 1 << 3,
     JOINTS = 1 << 4,
-    MORPH_TARGET0_POSITION = 1 << 5,
-    MORPH_TARGET1_POSITION = 1 << 6,
-    MORPH_TARGET0_NORMAL = 1 << 7,
-    MORPH_TARGET1_NORMAL = 1 << 8,
-    TANGENT = 1 << 9,
-    MORPH_TARGET0_TANGENT = 1 << 10,
-    MORPH_TARGET1_TANGENT = 1 << 11,
-    COLOR = 1 << 12,
+    // Index of the vertex's deltas in its primitive's morph target buffer texture, set for primitives with morph targets.
+    // The deltas themselves aren't attributes, so any number of targets fits.
+    MORPH_VERTEX = 1 << 5,
+    TANGENT = 1 << 6,
+    COLOR = 1 << 7,
+    // Not an attribute but a layout variant: octahedral normals and tangents, half float texcoords and morph deltas.
+    // Shaders get COMPACT_VERTICES defined.
+    COMPACT = 1 << 8,
 };
 
 inline constexpr VertexAttribute operator | (VertexAttribute lhs, VertexAttribute rhs)
@@ -0,0 +1,116 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+#include <limits>
+
+int GetComponentSizeBytes(std::uint32_t componentType)
+{
+	switch (componentType)
+	{
+	case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+	case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return 2;
+	case GL_INT: case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+	}
+	assert(false && "Unsupported vertex component type");
+	return 0;
+}
+
+int GetAttributeSizeBytes(const VertexAttributeFormat& format)
+{
+	const int size = GetComponentSizeBytes(format.componentType) * format.componentCount;
+	return (size + 3) & ~3;
+}
+
+void ComputeOffsets(VertexLayout& layout)
+{
+	int offset = 0;
+	for (VertexAttributeFormat& format : layout.attributes)
+	{
+		if (format.componentType != 0)
+		{
+			format.offset = (std::uint8_t)offset;
+			offset += GetAttributeSizeBytes(format);
+		}
+	}
+	assert(offset < 256 && "Vertex too big for 8 bit attribute offsets");
+	layout.stride = offset;
+}
+
+template<typename T>
+static float ReadComponent(const std::uint8_t* component, bool normalized)
+{
+	T value;
+	std::memcpy(&value, component, sizeof(value));
+	if (!normalized || std::is_same_v<T, float>)
+	{
+		return (float)value;
+	}
+	// GL 4.2+ conversion, the most negative signed value also maps to -1
+	return std::max((float)value / (float)std::numeric_limits<T>::max(), -1.0f);
+}
+
+template<typename T>
+static void WriteComponent(std::uint8_t* component, float value, bool normalized)
+{
+	T converted;
+	if constexpr (std::is_same_v<T, float>)
+	{
+		converted = value;
+	}
+	else
+	{
+		if (normalized)
+		{
+			value = std::clamp(value, std::is_signed_v<T> ? -1.0f : 0.0f, 1.0f) * std::numeric_limits<T>::max();
+		}
+		converted = (T)std::clamp(std::round(value), (float)std::numeric_limits<T>::lowest(), (float)std::numeric_limits<T>::max());
+	}
+	std::memcpy(component, &converted, sizeof(converted));
+}
+
+glm::vec4 ReadAttribute(const std::uint8_t* vertex, const VertexAttributeFormat& format)
+{
+	glm::vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+	const std::uint8_t* component = vertex + format.offset;
+	const int componentSize = GetComponentSizeBytes(format.componentType);
+	for (int i = 0; i < format.componentCount; i++, component += componentSize)
+	{
+		switch (format.componentType)
+		{
+		case GL_BYTE: value[i] = ReadComponent<std::int8_t>(component, format.normalized); break;
+		case GL_UNSIGNED_BYTE: value[i] = ReadComponent<std::uint8_t>(component, format.normalized); break;
+		case GL_SHORT: value[i] = ReadComponent<std::int16_t>(component, format.normalized); break;
+		case GL_UNSIGNED_SHORT: value[i] = ReadComponent<std::uint16_t>(component, format.normalized); break;
+		case GL_INT: value[i] = ReadComponent<std::int32_t>(component, format.normalized); break;
+		case GL_UNSIGNED_INT: value[i] = ReadComponent<std::uint32_t>(component, format.normalized); break;
+		case GL_FLOAT: value[i] = ReadComponent<float>(component, false); break;
+		case GL_HALF_FLOAT: value[i] = glm::unpackHalf1x16(ReadComponent<std::uint16_t>(component, false)); break;
+		}
+	}
+	return value;
+}
+
+void WriteAttribute(std::uint8_t* vertex, const VertexAttributeFormat& format, const glm::vec4& value)
+{
+	std::uint8_t* component = vertex + format.offset;
+	const int componentSize = GetComponentSizeBytes(format.componentType);
+	for (int i = 0; i < format.componentCount; i++, component += componentSize)
+	{
+		switch (format.componentType)
+		{
+		case GL_BYTE: WriteComponent<std::int8_t>(component, value[i], format.normalized); break;
+		case GL_UNSIGNED_BYTE: WriteComponent<std::uint8_t>(component, value[i], format.normalized); break;
+		case GL_SHORT: WriteComponent<std::int16_t>(component, value[i], format.normalized); break;
+		case GL_UNSIGNED_SHORT: WriteComponent<std::uint16_t>(component, value[i], format.normalized); break;
+		case GL_INT: WriteComponent<std::int32_t>(component, value[i], format.normalized); break;
+		case GL_UNSIGNED_INT: WriteComponent<std::uint32_t>(component, value[i], format.normalized); break;
+		case GL_FLOAT: WriteComponent<float>(component, value[i], false); break;
+		case GL_HALF_FLOAT: WriteComponent<std::uint16_t>(component, glm::packHalf1x16(value[i]), false); break;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <glm/vec4.hpp>
+#include <type_traits>
+#include "VertexAttribute.h"
+
+constexpr int vertexAttributeCount = 8;
+
+// Attributes are single bits in the order they're interleaved, so the bit index doubles as the shader location
+inline int GetAttributeLocation(VertexAttribute attribute)
+{
+	return std::countr_zero((std::underlying_type_t<VertexAttribute>)attribute);
+}
+
+// How one attribute is stored in an interleaved vertex. Quantized glTF attributes (KHR_mesh_quantization) keep their
+// component type, GL converts them back to floats when the vertex is fetched.
+struct VertexAttributeFormat
+{
+	std::uint32_t componentType = 0; // GL_FLOAT, GL_HALF_FLOAT, GL_SHORT etc., 0 if the vertex doesn't have the attribute
+	std::uint8_t componentCount = 0;
+	std::uint8_t normalized = 0; // integers map to [0, 1] or [-1, 1] instead of their value
+	std::uint8_t integer = 0; // read as integers by the shader, glVertexAttribIPointer
+	std::uint8_t offset = 0;
+};
+
+struct VertexLayout
+{
+	std::array<VertexAttributeFormat, vertexAttributeCount> attributes{};
+	std::uint32_t stride = 0;
+
+	VertexAttributeFormat& operator[](VertexAttribute attribute) { return attributes[GetAttributeLocation(attribute)]; }
+	const VertexAttributeFormat& operator[](VertexAttribute attribute) const { return attributes[GetAttributeLocation(attribute)]; }
+};
+static_assert(std::is_trivially_copyable_v<VertexLayout>);
+
+int GetComponentSizeBytes(std::uint32_t componentType);
+// Padded to 4 bytes so every attribute in the vertex stays aligned
+int GetAttributeSizeBytes(const VertexAttributeFormat& format);
+// Sets every present attribute's offset, in attribute order, and the stride
+void ComputeOffsets(VertexLayout& layout);
+
+// Decodes an attribute to floats the way GL does when fetching it. Missing components read as 0, except w which is 1.
+glm::vec4 ReadAttribute(const std::uint8_t* vertex, const VertexAttributeFormat& format);
+// Encodes value in the attribute's format, rounding and clamping normalized integers
+void WriteAttribute(std::uint8_t* vertex, const VertexAttributeFormat& format, const glm::vec4& value);
\ No newline at end of file
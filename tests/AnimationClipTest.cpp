@@ -0,0 +1,106 @@
+#include <algorithm>
+#include "AnimationClip.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static int failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		std::printf("FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+// Angle between two rotations, from the chord between the quaternions like the compressor measures it
+static double RotationError(const glm::quat& a, const glm::quat& b)
+{
+	const double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z + (double)a.w * b.w;
+	const double sign = dot < 0.0 ? -1.0 : 1.0;
+	const double chord = std::sqrt((a.x - sign * b.x) * (a.x - sign * b.x) + (a.y - sign * b.y) * (a.y - sign * b.y) +
+		(a.z - sign * b.z) * (a.z - sign * b.z) + (a.w - sign * b.w) * (a.w - sign * b.w));
+	return 4.0 * std::asin(std::min(chord * 0.5, 1.0));
+}
+
+// Long, nearly linear ramps with a wobble just under the tolerance, so most keyframes get dropped right up to the error
+// bound and the wide ranges make every quantization step count
+static Animation MakeAnimation(int keyframeCount)
+{
+	EntityAnimation channels{};
+	channels.entityIdx = 0;
+	channels.translations.method = InterpolationType::LINEAR;
+	channels.rotations.method = InterpolationType::LINEAR;
+	channels.scales.method = InterpolationType::LINEAR;
+	for (int keyframe = 0; keyframe < keyframeCount; keyframe++)
+	{
+		const float time = keyframe / 30.0f;
+		const float u = (float)keyframe / (keyframeCount - 1);
+		const float wobble = std::sin(keyframe * 0.9f);
+		channels.translations.times.push_back(time);
+		channels.translations.values.push_back(glm::vec3(40.0f * u + 0.0008f * wobble, -25.0f * u, 10.0f * u * u));
+		channels.scales.times.push_back(time);
+		channels.scales.values.push_back(glm::vec3(1.0f + 30.0f * u + 0.008f * wobble, 1.0f, 1.0f + 2.0f * u));
+
+		// About an axis that isn't a coordinate axis, so every component varies
+		const float halfAngle = 0.5f * (3.0f * u + 0.0008f * wobble);
+		const float axisLength = std::sqrt(0.3f * 0.3f + 1.0f + 0.2f * 0.2f);
+		const float s = std::sin(halfAngle) / axisLength;
+		channels.rotations.times.push_back(time);
+		channels.rotations.values.push_back(glm::quat(std::cos(halfAngle), 0.3f * s, s, 0.2f * s));
+	}
+
+	Animation animation{};
+	animation.entityAnimations.push_back(channels);
+	animation.durationSeconds = channels.translations.times.back();
+	return animation;
+}
+
+int main()
+{
+	constexpr int keyframeCount = 600;
+	const Animation animation = MakeAnimation(keyframeCount);
+	const EntityAnimation& source = animation.entityAnimations[0];
+
+	// A single joint without children, so ChannelTolerance gives the positional error for translations, and the
+	// positional error over the minimum reach of 0.1 for scales and, capped by the angular error, rotations
+	std::vector<Entity> entities(1);
+	AnimationCompression compression;
+	compression.enabled = true;
+	const double translationTolerance = compression.positionalError;
+	const double scaleTolerance = compression.positionalError / 0.1;
+	const double rotationTolerance = std::min(compression.angularError, compression.positionalError / 0.1f);
+
+	const AnimationClip clip = CompileAnimationClip(animation, entities, compression);
+	std::size_t keptKeyframes = 0;
+	for (const AnimationClip::ChannelGroup& group : clip.groups) keptKeyframes += clip.timeTracks[group.timeTrack].size();
+	Check(keptKeyframes < 3 * keyframeCount / 2, "compression drops most keyframes");
+
+	// Sampled at every source keyframe, where the source is exact and the compressed clip is furthest from it
+	std::vector<KeyframeCursor> cursors(clip.CursorCount());
+	double translationError = 0.0, scaleError = 0.0, rotationError = 0.0;
+	for (int keyframe = 0; keyframe < keyframeCount; keyframe++)
+	{
+		SampleAnimationClip(clip, source.translations.times[keyframe], cursors, entities);
+		const Transform& sampled = entities[0].transform;
+		const glm::vec3 translation = sampled.translation - source.translations.values[keyframe];
+		const glm::vec3 scale = sampled.scale - source.scales.values[keyframe];
+		translationError = std::max(translationError, std::sqrt((double)translation.x * translation.x + (double)translation.y * translation.y +
+			(double)translation.z * translation.z));
+		scaleError = std::max({ scaleError, (double)std::abs(scale.x), (double)std::abs(scale.y), (double)std::abs(scale.z) });
+		rotationError = std::max(rotationError, RotationError(sampled.rotation, source.rotations.values[keyframe]));
+	}
+	std::printf("Max error: translation %g of %g, scale %g of %g, rotation %g of %g\n", translationError, translationTolerance,
+		scaleError, scaleTolerance, rotationError, rotationTolerance);
+
+	// A little slack for float rounding in the samplers, far below a quantization step
+	constexpr double slack = 1e-6;
+	Check(translationError <= translationTolerance + slack, "translation error within tolerance");
+	Check(scaleError <= scaleTolerance + slack, "scale error within tolerance");
+	Check(rotationError <= rotationTolerance + slack, "rotation error within tolerance");
+
+	if (failures == 0) std::printf("All animation clip tests passed\n");
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "MeshoptDecoder.h"
+#include <vector>
+
+// meshopt_encodeIndexSequence output for these indices, with its default version 1 header. The jumps to 100, 70000 and
+// back make the encoder switch baselines.
+static const std::uint32_t indices[] = { 0, 1, 2, 2, 1, 3, 100, 101, 102, 4, 5, 6, 70000, 70001, 69999, 7 };
+static const std::uint8_t encoded[] = {
+	0xD1, 0x00, 0x04, 0x04, 0x00, 0x02, 0x08, 0x91, 0x03, 0x05, 0x05, 0x04, 0x04, 0x04, 0xA9, 0x88,
+	0x11, 0x05, 0x07, 0x04, 0x00, 0x00, 0x00, 0x00,
+};
+static constexpr std::size_t indexCount = sizeof(indices) / sizeof(indices[0]);
+
+static int failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		std::printf("FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+static bool DecodeSequence(std::vector<std::uint8_t> source, std::vector<std::uint32_t>& decoded)
+{
+	decoded.assign(indexCount, 0);
+	return DecodeMeshoptBufferView({ (std::uint8_t*)decoded.data(), indexCount * 4 }, indexCount, 4, MeshoptMode::Indices,
+		MeshoptFilter::None, source);
+}
+
+int main()
+{
+	const std::vector<std::uint8_t> source(std::begin(encoded), std::end(encoded));
+	std::vector<std::uint32_t> decoded;
+	Check(DecodeSequence(source, decoded), "version 1 sequence decodes");
+	Check(std::memcmp(decoded.data(), indices, sizeof(indices)) == 0, "version 1 sequence matches the encoded indices");
+
+	// Version 0 streams only differ in how the encoder picked baselines
+	std::vector<std::uint8_t> version0 = source;
+	version0[0] = 0xD0;
+	Check(DecodeSequence(version0, decoded), "version 0 sequence decodes");
+	Check(std::memcmp(decoded.data(), indices, sizeof(indices)) == 0, "version 0 sequence matches the encoded indices");
+
+	std::vector<std::uint8_t> version2 = source;
+	version2[0] = 0xD2;
+	Check(!DecodeSequence(version2, decoded), "unknown version is rejected");
+	std::vector<std::uint8_t> triangles = source;
+	triangles[0] = 0xE1;
+	Check(!DecodeSequence(triangles, decoded), "index buffer header is rejected");
+
+	if (failures == 0) std::printf("All meshopt decoder tests passed\n");
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file